@@ -0,0 +1,64 @@
+// Copyright 2017-2018 by Martin Moene
+//
+// https://github.com/martinmoene/optional-fun-lite
+//
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+// Sum and count present values: per element via map_or(), via sum_present() and
+// count_present() over a vector of optionals and over values with a validity bitmap.
+
+#include "bench.hpp"
+#include "nonstd/optional-fun.hpp"
+
+#include <cstdio>
+
+using namespace nonstd;
+
+namespace {
+
+int identity( int x ) { return x; }
+
+template< typename F >
+double run( std::size_t n, F f )
+{
+    return bench::ns_per_element( n, 15, [&]{ bench::keep( f() ); } );
+}
+
+} // anonymous namespace
+
+int main()
+{
+    std::size_t const n = 1 << 20;
+
+    std::printf( "sum and count of present values, ns per element, %zu elements\n\n", n );
+    std::printf( "present%%  map_or  sum:vector  sum:bitmap  count:vector  count:bitmap\n" );
+
+    for ( double presence : { 0.0, 0.05, 0.50, 0.95, 1.0 } )
+    {
+        auto const v = bench::make_optionals<int>( n, presence );
+
+        std::vector<int>          values( n );
+        std::vector<std::uint8_t> validity( ( n + 7 ) / 8 );
+
+        for ( std::size_t i = 0; i != n; ++i )
+        {
+            values[i] = v[i].value_or( 0 );
+            if ( v[i] )
+                validity[ i / 8 ] = static_cast<std::uint8_t>( validity[ i / 8 ] | ( 1u << ( i % 8 ) ) );
+        }
+
+        nullable_view<int> const view( values.data(), validity.data(), n );
+
+        std::printf( "%7.0f  %6.2f  %10.2f  %10.2f  %12.2f  %12.2f\n"
+            , 100 * presence
+            , run( n, [&]{ int sum = 0; for ( auto const & o : v ) sum += o | map_or( identity, 0 ); return sum; } )
+            , run( n, [&]{ return v    | sum_present();   } )
+            , run( n, [&]{ return view | sum_present();   } )
+            , run( n, [&]{ return v    | count_present(); } )
+            , run( n, [&]{ return view | count_present(); } )
+        );
+    }
+}
+
+// end of file
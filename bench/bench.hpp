@@ -0,0 +1,77 @@
+// Copyright 2017-2018 by Martin Moene
+//
+// https://github.com/martinmoene/optional-fun-lite
+//
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+
+#ifndef BENCH_OPTIONAL_FUN_LITE_HPP_INCLUDED
+#define BENCH_OPTIONAL_FUN_LITE_HPP_INCLUDED
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <random>
+#include <vector>
+
+namespace bench {
+
+// keep the compiler from optimizing away a result:
+
+template< typename T >
+inline void keep( T const & value )
+{
+#if defined(__GNUC__) || defined(__clang__)
+    asm volatile( "" : : "r,m"( value ) : "memory" );
+#else
+    static volatile char sink;
+    sink = *reinterpret_cast<char const volatile *>( &value );
+#endif
+}
+
+// optionals with given fraction present, fixed seed for reproducibility:
+
+template< typename T >
+std::vector< std::optional<T> > make_optionals( std::size_t n, double presence, unsigned seed = 42 )
+{
+    std::mt19937 gen( seed );
+    std::bernoulli_distribution present( presence );
+    std::uniform_int_distribution<int> value( 1, 100 );
+
+    std::vector< std::optional<T> > result( n );
+
+    for ( auto & o : result )
+    {
+        if ( present( gen ) )
+            o = static_cast<T>( value( gen ) );
+    }
+    return result;
+}
+
+// best time in nanoseconds per element of `reps` runs of f() over n elements:
+
+template< typename F >
+double ns_per_element( std::size_t n, int reps, F f )
+{
+    double best = 1e300;
+
+    for ( int r = 0; r < reps; ++r )
+    {
+        auto const start = std::chrono::steady_clock::now();
+        f();
+        auto const stop  = std::chrono::steady_clock::now();
+
+        best = (std::min)( best, std::chrono::duration<double, std::nano>( stop - start ).count() );
+    }
+    return best / static_cast<double>( n );
+}
+
+} // namespace bench
+
+#endif // BENCH_OPTIONAL_FUN_LITE_HPP_INCLUDED
+
+// end of file
@@ -0,0 +1,81 @@
+// Copyright 2017-2018 by Martin Moene
+//
+// https://github.com/martinmoene/optional-fun-lite
+//
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+// Merge three sources, the first present value wins: per element via coalesce()
+// on optionals against coalesce_columns() on values with validity bitmaps.
+
+#include "bench.hpp"
+#include "nonstd/optional-fun.hpp"
+
+#include <cstdio>
+
+using namespace nonstd;
+
+namespace {
+
+struct column
+{
+    std::vector< optional<int> > optionals;
+    std::vector<int>             values;
+    std::vector<std::uint8_t>    validity;
+
+    column( std::size_t n, double presence, unsigned seed )
+    : optionals( bench::make_optionals<int>( n, presence, seed ) )
+    , values( n )
+    , validity( ( n + 7 ) / 8 )
+    {
+        for ( std::size_t i = 0; i != n; ++i )
+        {
+            values[i] = optionals[i].value_or( 0 );
+            if ( optionals[i] )
+                validity[ i / 8 ] = static_cast<std::uint8_t>( validity[ i / 8 ] | ( 1u << ( i % 8 ) ) );
+        }
+    }
+
+    nullable_view<int> view() const { return nullable_view<int>( values.data(), validity.data(), values.size() ); }
+};
+
+template< typename F >
+double run( std::size_t n, F f )
+{
+    return bench::ns_per_element( n, 15, [&]{ bench::keep( f() ); } );
+}
+
+} // anonymous namespace
+
+int main()
+{
+    std::size_t const n = 1 << 20;
+
+    std::printf( "coalesce three sources, ns per element, %zu elements\n\n", n );
+    std::printf( "present%%  coalesce  coalesce_columns\n" );
+
+    std::vector< optional<int> > out( n );
+    std::vector<int>             values( n );
+    std::vector<std::uint8_t>    validity( ( n + 7 ) / 8 );
+
+    for ( double presence : { 0.05, 0.50, 0.95 } )
+    {
+        column const a( n, presence, 1 ), b( n, presence, 2 ), c( n, presence, 3 );
+
+        std::printf( "%7.0f  %8.2f  %16.2f\n"
+            , 100 * presence
+            , run( n, [&]
+            {
+                for ( std::size_t i = 0; i != n; ++i )
+                    out[i] = coalesce( a.optionals[i], b.optionals[i], c.optionals[i] );
+                return out[n / 2];
+            })
+            , run( n, [&]
+            {
+                return coalesce_columns( values.data(), validity.data(), a.view(), b.view(), c.view() )[n / 2];
+            })
+        );
+    }
+}
+
+// end of file
@@ -0,0 +1,98 @@
+// Copyright 2017-2018 by Martin Moene
+//
+// https://github.com/martinmoene/optional-fun-lite
+//
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+// Sweep the fraction of present optionals and compare the encoded size and
+// the encode and decode time of the optional codec to a flag byte plus value.
+
+#include "bench.hpp"
+#include "nonstd/optional-fun-codec.hpp"
+
+#include <cstdio>
+#include <cstring>
+
+using namespace nonstd;
+
+namespace {
+
+// a flag byte per element, followed by the value if present:
+
+std::vector<std::uint8_t> encode_flagged( std::vector< optional<int> > const & v )
+{
+    std::vector<std::uint8_t> result;
+    result.reserve( v.size() * ( 1 + sizeof( int ) ) );
+
+    for ( auto const & o : v )
+    {
+        result.push_back( o.has_value() );
+        if ( o.has_value() )
+        {
+            std::uint8_t bytes[ sizeof( int ) ];
+            std::memcpy( bytes, &*o, sizeof( int ) );
+            result.insert( result.end(), bytes, bytes + sizeof( int ) );
+        }
+    }
+    return result;
+}
+
+template< typename Out >
+void decode_flagged( std::vector<std::uint8_t> const & bytes, Out out )
+{
+    for ( std::size_t i = 0; i < bytes.size(); )
+    {
+        if ( bytes[ i++ ] )
+        {
+            int x;
+            std::memcpy( &x, &bytes[i], sizeof( int ) );
+            i += sizeof( int );
+            out( optional<int>( x ) );
+        }
+        else
+        {
+            out( optional<int>() );
+        }
+    }
+}
+
+} // anonymous namespace
+
+int main()
+{
+    std::size_t const n = 1 << 20;
+
+    std::printf( "optional<int> codec against a flag byte plus value, %zu elements\n\n", n );
+    std::printf( "present%%  bits/element: flagged  codec   encode ns/element: flagged  codec   decode ns/element: flagged  codec\n" );
+
+    for ( double presence : { 0.0, 0.01, 0.1, 0.5, 0.9, 1.0 } )
+    {
+        auto const v = bench::make_optionals<int>( n, presence );
+
+        std::vector<std::uint8_t> flagged;
+        std::vector<std::uint8_t> coded;
+        long sum = 0;
+
+        double const enc_flagged = bench::ns_per_element( n, 5, [&] { flagged = encode_flagged( v ); } );
+        double const enc_codec   = bench::ns_per_element( n, 5, [&] { coded   = encode_optionals( v ); } );
+
+        double const dec_flagged = bench::ns_per_element( n, 5, [&]
+        {
+            decode_flagged( flagged, [&]( optional<int> const & o ) { sum += o.value_or( 0 ); } );
+        });
+        double const dec_codec = bench::ns_per_element( n, 5, [&]
+        {
+            optional_decoder<int> decoder;
+            decoder.feed( coded.data(), coded.size(), [&]( optional<int> const & o ) { sum += o.value_or( 0 ); } );
+        });
+        bench::keep( sum );
+
+        std::printf( "%7.0f  %21.2f  %5.2f  %26.2f  %5.2f  %26.2f  %5.2f\n"
+            , 100 * presence
+            , 8.0 * double( flagged.size() ) / double( n ), 8.0 * double( coded.size() ) / double( n )
+            , enc_flagged, enc_codec, dec_flagged, dec_codec );
+    }
+}
+
+// end of file
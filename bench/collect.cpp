@@ -0,0 +1,71 @@
+// Copyright 2017-2018 by Martin Moene
+//
+// https://github.com/martinmoene/optional-fun-lite
+//
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+// Turn many short ranges of optionals into optional containers: a loop with
+// push_back() against collect() into a std::vector and into a small_vector.
+
+#include "bench.hpp"
+#include "nonstd/optional-fun.hpp"
+
+#include <cstdio>
+
+using namespace nonstd;
+
+namespace {
+
+optional< std::vector<int> > by_hand( std::vector< optional<int> > const & r )
+{
+    std::vector<int> result;
+    for ( auto const & o : r )
+    {
+        if ( ! o )
+            return nullopt;
+        result.push_back( *o );
+    }
+    return result;
+}
+
+template< typename F >
+double run( std::vector< std::vector< optional<int> > > const & batches, std::size_t n, F f )
+{
+    return bench::ns_per_element( n, 15, [&]
+    {
+        std::size_t total = 0;
+        for ( auto const & b : batches )
+        {
+            auto const r = f( b );
+            total += r ? r->size() : 0;
+        }
+        bench::keep( total );
+    });
+}
+
+} // anonymous namespace
+
+int main()
+{
+    std::size_t const batches = 1 << 14;
+
+    std::printf( "collect ranges of optionals, all present, ns per element, %zu ranges\n\n", batches );
+    std::printf( "length  push_back  collect:vector  collect:small_vector<8>\n" );
+
+    for ( std::size_t length : { 4, 8, 32, 256 } )
+    {
+        std::vector< std::vector< optional<int> > > const input( batches, bench::make_optionals<int>( length, 1.0 ) );
+
+        std::size_t const n = batches * length;
+
+        std::printf( "%6zu  %9.2f  %14.2f  %23.2f\n"
+            , length
+            , run( input, n, []( auto const & r ) { return by_hand( r ); } )
+            , run( input, n, []( auto const & r ) { return r | collect(); } )
+            , run( input, n, []( auto const & r ) { return r | collect< small_vector<int, 8> >(); } )
+        );
+    }
+}
+
+// end of file
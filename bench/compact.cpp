@@ -0,0 +1,80 @@
+// Copyright 2017-2018 by Martin Moene
+//
+// https://github.com/martinmoene/optional-fun-lite
+//
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+// Compact present values and their indices: a branchy loop against compact_values()
+// over a vector of optionals and over values with a validity bitmap. Build with
+// -mavx2 or -mavx512f to time the SIMD paths (bench-compact-avx2, bench-compact-avx512).
+
+#include "bench.hpp"
+#include "nonstd/optional-fun.hpp"
+
+#include <cstdio>
+
+using namespace nonstd;
+
+namespace {
+
+std::size_t by_hand( std::vector< optional<int> > const & v, int * out, std::uint32_t * idx )
+{
+    std::size_t k = 0;
+    for ( std::size_t i = 0; i != v.size(); ++i )
+    {
+        if ( v[i] )
+        {
+            out[k] = *v[i];
+            idx[k] = static_cast<std::uint32_t>( i );
+            ++k;
+        }
+    }
+    return k;
+}
+
+template< typename F >
+double run( std::size_t n, F f )
+{
+    return bench::ns_per_element( n, 15, [&]{ bench::keep( f() ); } );
+}
+
+} // anonymous namespace
+
+int main()
+{
+    std::size_t const n = 1 << 20;
+
+    std::printf( "compact present values and indices, ns per element, %zu elements, avx2: %d, avx512f: %d\n\n"
+        , n, optfun_HAVE_AVX2, optfun_HAVE_AVX512F );
+    std::printf( "present%%  branchy  compact:vector  compact:bitmap\n" );
+
+    std::vector<int>           out( n );
+    std::vector<std::uint32_t> idx( n );
+
+    for ( double presence : { 0.05, 0.25, 0.50, 0.75, 0.95 } )
+    {
+        auto const v = bench::make_optionals<int>( n, presence );
+
+        std::vector<int>          values( n );
+        std::vector<std::uint8_t> validity( ( n + 7 ) / 8 );
+
+        for ( std::size_t i = 0; i != n; ++i )
+        {
+            values[i] = v[i].value_or( 0 );
+            if ( v[i] )
+                validity[ i / 8 ] = static_cast<std::uint8_t>( validity[ i / 8 ] | ( 1u << ( i % 8 ) ) );
+        }
+
+        nullable_view<int> const view( values.data(), validity.data(), n );
+
+        std::printf( "%7.0f  %7.2f  %14.2f  %14.2f\n"
+            , 100 * presence
+            , run( n, [&]{ return by_hand( v, out.data(), idx.data() ); } )
+            , run( n, [&]{ return compact_values( v,    out.data(), idx.data() ); } )
+            , run( n, [&]{ return compact_values( view, out.data(), idx.data() ); } )
+        );
+    }
+}
+
+// end of file
@@ -0,0 +1,72 @@
+// Copyright 2017-2018 by Martin Moene
+//
+// https://github.com/martinmoene/optional-fun-lite
+//
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+// Time a three-stage pipeline against the equivalent hand-written loop in an
+// unoptimized build, to see what the proxy, worker and pipe layers cost at -O0 and -Og.
+// Compare the bench-debug-* programs built with and without optfun_CONFIG_FORCE_INLINE.
+
+#include "bench.hpp"
+#include "nonstd/optional-fun.hpp"
+
+#include <cstdio>
+
+using namespace nonstd;
+
+namespace {
+
+int           twice( int x ) { return 2 * x + 1; }
+optional<int> small( int x ) { return x < 150 ? optional<int>( x ) : optional<int>(); }
+
+double run_pipe( std::vector< optional<int> > const & v )
+{
+    return bench::ns_per_element( v.size(), 7, [&]
+    {
+        long sum = 0;
+        for ( auto const & o : v )
+        {
+            sum += o | map( twice ) | and_then( small ) | map_or( twice, 0 );
+        }
+        bench::keep( sum );
+    });
+}
+
+double run_hand( std::vector< optional<int> > const & v )
+{
+    return bench::ns_per_element( v.size(), 7, [&]
+    {
+        long sum = 0;
+        for ( auto const & o : v )
+        {
+            if ( o.has_value() )
+            {
+                optional<int> const s = small( twice( *o ) );
+                if ( s.has_value() )
+                    sum += twice( *s );
+            }
+        }
+        bench::keep( sum );
+    });
+}
+
+} // anonymous namespace
+
+int main()
+{
+    std::size_t const n = 1 << 20;
+
+    auto const v = bench::make_optionals<int>( n, 0.75 );
+
+    double const pipe = run_pipe( v );
+    double const hand = run_hand( v );
+
+    std::printf( "o | map(f) | and_then(g) | map_or(f, 0), ns per element, %zu elements, force inline: %d\n\n"
+        , n, optfun_CONFIG_FORCE_INLINE );
+    std::printf( "pipe  hand  ratio\n" );
+    std::printf( "%4.2f  %4.2f  %5.2f\n", pipe, hand, pipe / hand );
+}
+
+// end of file
@@ -0,0 +1,65 @@
+// Copyright 2017-2018 by Martin Moene
+//
+// https://github.com/martinmoene/optional-fun-lite
+//
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+// A low-cardinality column of optional strings: compare the size and the map()
+// time of a dictionary_column to a std::vector of optional<std::string>, with
+// map() hashing each string.
+
+#include "bench.hpp"
+#include "nonstd/optional-fun-dictionary.hpp"
+
+#include <cstdio>
+#include <functional>
+#include <string>
+
+using namespace nonstd;
+
+int main()
+{
+    std::size_t const n        = 1 << 22;
+    std::size_t const distinct = 1000;
+
+    auto const present = bench::make_optionals<int>( n, 0.9 );
+
+    std::vector< optional<std::string> > strings( n );
+
+    for ( std::size_t i = 0; i != n; ++i )
+    {
+        if ( present[i] )
+            strings[i] = "product-category-" + std::to_string( ( i * 7919 ) % distinct );
+    }
+
+    dictionary_column const column( strings );
+
+    auto const hash = map( []( std::string_view s ) { return std::hash<std::string_view>()( s ); } );
+
+    double const t_strings = bench::ns_per_element( n, 5, [&]
+    {
+        std::vector< optional<std::size_t> > out;
+        out.reserve( n );
+        for ( auto const & o : strings )
+            out.push_back( o | map( []( std::string const & s ) { return std::hash<std::string_view>()( s ); } ) );
+        bench::keep( out.data() );
+    });
+
+    double const t_column = bench::ns_per_element( n, 5, [&] { bench::keep( ( column | hash ).data() ); } );
+
+    std::size_t bytes_strings = n * sizeof( optional<std::string> );
+
+    for ( auto const & o : strings )
+    {
+        if ( o && o->size() > 15 )
+            bytes_strings += o->capacity() + 1;
+    }
+
+    std::printf( "%zu optional strings, %zu distinct, 90%% present\n\n", n, distinct );
+    std::printf( "                     bytes/element  ns/element map(hash)\n" );
+    std::printf( "vector of strings    %13.2f  %20.2f\n", double( bytes_strings ) / double( n ), t_strings );
+    std::printf( "dictionary_column    %13.2f  %20.2f\n", double( column.memory_bytes() ) / double( n ), t_column );
+}
+
+// end of file
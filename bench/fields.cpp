@@ -0,0 +1,80 @@
+// Copyright 2017-2018 by Martin Moene
+//
+// https://github.com/martinmoene/optional-fun-lite
+//
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+// Records of 24 optional fields: compare the size of optional_fields to a
+// struct of optional members, and the time to select the records that have
+// four given fields present.
+
+#include "bench.hpp"
+#include "nonstd/optional-fun-fields.hpp"
+
+#include <cstdio>
+
+using namespace nonstd;
+
+namespace {
+
+struct members
+{
+    optional<double> f0;  optional<int>  f1;  optional<bool> f2;  optional<double> f3;
+    optional<int>    f4;  optional<bool> f5;  optional<double> f6; optional<int>    f7;
+    optional<bool>   f8;  optional<double> f9; optional<int>  f10; optional<bool>   f11;
+    optional<double> f12; optional<int>  f13; optional<bool> f14; optional<double> f15;
+    optional<int>    f16; optional<bool> f17; optional<double> f18; optional<int>  f19;
+    optional<bool>   f20; optional<double> f21; optional<int> f22; optional<bool>  f23;
+};
+
+using fields = optional_fields<
+    double, int, bool, double, int, bool, double, int,
+    bool, double, int, bool, double, int, bool, double,
+    int, bool, double, int, bool, double, int, bool >;
+
+} // anonymous namespace
+
+int main()
+{
+    std::size_t const n = 1 << 20;
+
+    auto const present = bench::make_optionals<int>( n * 4, 0.8 );
+
+    std::vector<members> a( n );
+    std::vector<fields>  b( n );
+
+    for ( std::size_t i = 0; i != n; ++i )
+    {
+        if ( present[4 * i + 0] ) { a[i].f0  = 1.0; b[i].emplace<0>( 1.0 ); }
+        if ( present[4 * i + 1] ) { a[i].f7  = 2;   b[i].emplace<7>( 2 ); }
+        if ( present[4 * i + 2] ) { a[i].f11 = true; b[i].emplace<11>( true ); }
+        if ( present[4 * i + 3] ) { a[i].f21 = 3.0; b[i].emplace<21>( 3.0 ); }
+    }
+
+    std::size_t count_a = 0;
+    std::size_t count_b = 0;
+
+    double const t_a = bench::ns_per_element( n, 5, [&]
+    {
+        count_a = 0;
+        for ( auto const & r : a )
+            count_a += r.f0.has_value() && r.f7.has_value() && r.f11.has_value() && r.f21.has_value();
+        bench::keep( count_a );
+    });
+
+    double const t_b = bench::ns_per_element( n, 5, [&]
+    {
+        count_b = 0;
+        for ( auto const & r : b )
+            count_b += r.all_of( fields::mask<0, 7, 11, 21> );
+        bench::keep( count_b );
+    });
+
+    std::printf( "%zu records of 24 optional fields, select those with 4 given fields present\n\n", n );
+    std::printf( "                   bytes/record  ns/record\n" );
+    std::printf( "optional members   %12zu  %9.2f\n", sizeof( members ), t_a );
+    std::printf( "optional_fields    %12zu  %9.2f  %s\n", sizeof( fields ), t_b, count_a == count_b ? "" : "(counts differ)" );
+}
+
+// end of file
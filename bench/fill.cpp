@@ -0,0 +1,72 @@
+// Copyright 2017-2018 by Martin Moene
+//
+// https://github.com/martinmoene/optional-fun-lite
+//
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+// Forward fill: a per-element loop with or_(last) against fill_forward() over a
+// vector of optionals and fill_column() over values with a validity bitmap.
+
+#include "bench.hpp"
+#include "nonstd/optional-fun.hpp"
+
+#include <cstdio>
+
+using namespace nonstd;
+
+namespace {
+
+template< typename F >
+double run( std::size_t n, F f )
+{
+    return bench::ns_per_element( n, 15, [&]{ bench::keep( f() ); } );
+}
+
+} // anonymous namespace
+
+int main()
+{
+    std::size_t const n = 1 << 20;
+
+    std::printf( "forward fill, ns per element, %zu elements\n\n", n );
+    std::printf( "present%%  or_(last)  fill_forward  fill_column\n" );
+
+    std::vector< optional<int> > out( n );
+    std::vector<int>             values( n );
+    std::vector<std::uint8_t>    validity( ( n + 7 ) / 8 );
+
+    for ( double presence : { 0.05, 0.50, 0.95 } )
+    {
+        auto const v = bench::make_optionals<int>( n, presence );
+
+        std::vector<int>          x( n );
+        std::vector<std::uint8_t> bits( ( n + 7 ) / 8 );
+
+        for ( std::size_t i = 0; i != n; ++i )
+        {
+            x[i] = v[i].value_or( 0 );
+            if ( v[i] )
+                bits[ i / 8 ] = static_cast<std::uint8_t>( bits[ i / 8 ] | ( 1u << ( i % 8 ) ) );
+        }
+
+        nullable_view<int> const view( x.data(), bits.data(), n );
+
+        std::printf( "%7.0f  %9.2f  %12.2f  %11.2f\n"
+            , 100 * presence
+            , run( n, [&]
+            {
+                optional<int> last;
+                for ( std::size_t i = 0; i != n; ++i )
+                {
+                    out[i] = last = v[i] ? v[i] : ( last ? optional<int>( last | or_( 0 ) ) : last );
+                }
+                return out[n / 2];
+            })
+            , run( n, [&]{ return ( v | fill_forward() )[n / 2]; } )
+            , run( n, [&]{ return fill_column( values.data(), validity.data(), view, fill_forward() )[n / 2]; } )
+        );
+    }
+}
+
+// end of file
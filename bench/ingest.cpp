@@ -0,0 +1,385 @@
+// Copyright 2017-2018 by Martin Moene
+//
+// https://github.com/martinmoene/optional-fun-lite
+//
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+// Ingest a CSV file of sales: map it, split each row into fields, validate and
+// transform the fields via chains of parse<T>(), map(), and_then(), or_else()
+// and map_or(), and aggregate the revenue per country and the rows per hour.
+// Compare to the same validation written by hand, and report rows/s, bytes/s,
+// allocations and the time per chain.
+//
+// Usage: bench-ingest [MiB], the size of the generated file bench-ingest.csv,
+// 256 MiB by default; it is generated again if its size differs.
+
+#include "bench.hpp"
+#include "nonstd/optional-fun-mmap.hpp"
+#include "nonstd/optional-fun-parse.hpp"
+
+#include <array>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <string>
+#include <string_view>
+#include <system_error>
+
+#if optfun_CONFIG_INSTRUMENT
+# include <iostream>
+#endif
+
+using namespace nonstd;
+
+// count the allocations of the passes:
+
+namespace {
+
+std::size_t allocations = 0;
+
+} // anonymous namespace
+
+void * operator new( std::size_t size )
+{
+    ++allocations;
+
+    if ( void * p = std::malloc( size != 0 ? size : 1 ) )
+        return p;
+
+    throw std::bad_alloc();
+}
+
+void operator delete( void * p ) noexcept
+{
+    std::free( p );
+}
+
+void operator delete( void * p, std::size_t ) noexcept
+{
+    std::free( p );
+}
+
+namespace {
+
+char const * const path = "bench-ingest.csv";
+
+using time_point = std::chrono::system_clock::time_point;
+
+// id,time,country,amount,quantity,discount; every field but the id may be empty:
+
+enum column { id_field, time_field, country_field, amount_field, quantity_field, discount_field, columns };
+
+using fields = std::array< optional<std::string_view>, columns >;
+
+char const countries[][3] = { "NL", "DE", "FR", "BE", "GB", "IE", "ES", "PT", "IT", "AT", "CH", "DK", "SE", "NO", "FI", "PL" };
+
+std::size_t const country_count = sizeof( countries ) / sizeof( countries[0] );
+
+struct totals
+{
+    std::array< double, country_count > revenue{};
+    std::array< std::size_t, 24 >       rows_per_hour{};
+    std::size_t                         rejected = 0;
+
+    friend bool operator==( totals const & a, totals const & b )
+    {
+        return a.revenue == b.revenue && a.rows_per_hour == b.rows_per_hour && a.rejected == b.rejected;
+    }
+};
+
+// synthetic sales, about 2% of the optional fields empty and 0.5% malformed:
+
+std::size_t generate( std::size_t bytes )
+{
+    std::FILE * file = std::fopen( path, "wb" );
+
+    if ( file == nullptr )
+        return 0;
+
+    std::uint64_t state = 0x9e3779b97f4a7c15u;
+
+    auto next = [&]( std::uint64_t n )
+    {
+        state ^= state << 13; state ^= state >> 7; state ^= state << 17;
+        return state % n;
+    };
+
+    std::string chunk;
+    std::size_t written = 0;
+    std::size_t rows    = 0;
+    char line[128];
+
+    while ( written < bytes )
+    {
+        auto const empty     = [&] { return next( 50 ) == 0; };
+        auto const malformed = [&] { return next( 200 ) == 0; };
+
+        char when[32], amount[16], quantity[8], discount[8];
+
+        std::snprintf( when, sizeof( when ), "2024-%02u-%02uT%02u:%02u:%02u.%03uZ"
+            , unsigned( 1 + next( 12 ) ), unsigned( 1 + next( 28 ) ), unsigned( next( 24 ) ), unsigned( next( 60 ) ), unsigned( next( 60 ) ), unsigned( next( 1000 ) ) );
+        std::snprintf( amount,   sizeof( amount ),   "%u.%02u", unsigned( next( 1000 ) ), unsigned( next( 100 ) ) );
+        std::snprintf( quantity, sizeof( quantity ), "%u", unsigned( 1 + next( 12 ) ) );
+        std::snprintf( discount, sizeof( discount ), "0.%u", unsigned( next( 5 ) ) );
+
+        int const size = std::snprintf( line, sizeof( line ), "%zu,%s,%s,%s,%s,%s\n"
+            , rows
+            , empty() ? "" : malformed() ? "2024-02-30T10:00:00Z" : when
+            , empty() ? "" : malformed() ? "N?" : countries[ next( country_count ) ]
+            , empty() ? "" : malformed() ? "12.3.4" : amount
+            , empty() ? "" : malformed() ? "-1" : quantity
+            , next( 4 ) != 0 ? "" : malformed() ? "1.5" : discount );
+
+        chunk.append( line, static_cast<std::size_t>( size ) );
+        written += static_cast<std::size_t>( size );
+        ++rows;
+
+        if ( chunk.size() >= ( 1u << 20 ) || written >= bytes )
+        {
+            std::fwrite( chunk.data(), 1, chunk.size(), file );
+            chunk.clear();
+        }
+    }
+
+    std::fclose( file );
+    return written;
+}
+
+// the fields of the row at p, advancing p past it; an empty field is empty:
+
+bool split( char const *& p, char const * end, fields & f )
+{
+    if ( p == end )
+        return false;
+
+    char const * eol = static_cast<char const *>( std::memchr( p, '\n', static_cast<std::size_t>( end - p ) ) );
+    eol = eol != nullptr ? eol : end;
+
+    for ( std::size_t i = 0; i != columns; ++i )
+    {
+        char const * const stop = i + 1 != columns ? static_cast<char const *>( std::memchr( p, ',', static_cast<std::size_t>( eol - p ) ) ) : eol;
+        char const * const last = stop != nullptr ? stop : eol;
+
+        f[i] = last != p ? optional<std::string_view>( std::string_view( p, static_cast<std::size_t>( last - p ) ) ) : optional<std::string_view>();
+        p = last != eol ? last + 1 : eol;
+    }
+
+    p = eol != end ? eol + 1 : end;
+    return true;
+}
+
+// the same validation and transformation, via the adaptors:
+
+int hour_of_day( time_point t )
+{
+    auto const s = std::chrono::duration_cast<std::chrono::seconds>( t.time_since_epoch() ).count();
+    return static_cast<int>( ( s / 3600 ) % 24 );
+}
+
+optional<std::size_t> country_index( std::string_view s )
+{
+    for ( std::size_t i = 0; i != country_count; ++i )
+    {
+        if ( s == countries[i] )
+            return i;
+    }
+    return nullopt;
+}
+
+auto const id_of       = parse<long long>().named( "id" );
+auto const hour_of     = parse<time_point>().named( "time" ) | map( hour_of_day ).named( "hour" );
+auto const country_of  = and_then( country_index ).named( "country" );
+auto const amount_of   = parse<double>().named( "amount" ) | filter( []( double x ) { return x >= 0; } ).named( "amount>=0" );
+auto const quantity_of = parse<int>().named( "quantity" ) | filter( []( int q ) { return q > 0; } ).named( "quantity>0" )
+                         | or_else( [] { return optional<int>( 1 ); } ).named( "quantity=1" );
+auto const factor_of   = parse<double>().named( "discount" ) | filter( []( double d ) { return d >= 0 && d < 1; } ).named( "discount<1" )
+                         | map_or( []( double d ) { return 1 - d; }, 1.0 ).named( "factor" );
+
+void chains( fields const & f, totals & t )
+{
+    auto const   row    = f[id_field]       | id_of;
+    auto const   hour   = f[time_field]     | hour_of;
+    auto const   where  = f[country_field]  | country_of;
+    auto const   amount = f[amount_field]   | amount_of;
+    auto const   qty    = f[quantity_field] | quantity_of;
+    double const factor = f[discount_field] | factor_of;
+
+    if ( row && hour && where && amount && qty )
+    {
+        t.revenue[ *where ] += *amount * *qty * factor;
+        t.rows_per_hour[ static_cast<std::size_t>( *hour ) ] += 1;
+    }
+    else
+    {
+        t.rejected += 1;
+    }
+}
+
+// by hand, with std::from_chars:
+
+template< typename T >
+bool from_chars( optional<std::string_view> const & s, T & value )
+{
+    if ( ! s )
+        return false;
+
+    char const * const last = s->data() + s->size();
+    auto const result = std::from_chars( s->data(), last, value );
+    return result.ec == std::errc() && result.ptr == last;
+}
+
+void hand_written( fields const & f, totals & t )
+{
+    long long row = 0;
+    double amount = 0, discount = 0;
+    int quantity = 0;
+    std::size_t where = country_count;
+
+    if ( f[country_field] )
+    {
+        for ( std::size_t i = 0; i != country_count; ++i )
+        {
+            if ( *f[country_field] == countries[i] ) { where = i; break; }
+        }
+    }
+
+    optional<time_point> const when = f[time_field] ? parse_value<time_point>( *f[time_field] ) : optional<time_point>();
+
+    bool const valid_quantity = from_chars( f[quantity_field], quantity ) && quantity > 0;
+    bool const valid_discount = from_chars( f[discount_field], discount ) && discount >= 0 && discount < 1;
+
+    if ( from_chars( f[id_field], row ) && when && where != country_count && from_chars( f[amount_field], amount ) && amount >= 0 )
+    {
+        t.revenue[ where ] += amount * ( valid_quantity ? quantity : 1 ) * ( valid_discount ? 1 - discount : 1.0 );
+        t.rows_per_hour[ static_cast<std::size_t>( hour_of_day( *when ) ) ] += 1;
+    }
+    else
+    {
+        t.rejected += 1;
+    }
+}
+
+struct pass_result
+{
+    double      seconds;
+    std::size_t rows;
+    std::size_t allocations;
+};
+
+// best of reps passes over the mapped file, applying f to each row:
+
+template< typename F >
+pass_result pass( char const * data, std::size_t size, F f, int reps = 3 )
+{
+    pass_result best = { 1e300, 0, 0 };
+
+    for ( int r = 0; r != reps; ++r )
+    {
+        std::size_t const allocations_before = allocations;
+        auto const start = std::chrono::steady_clock::now();
+
+        char const * p = data;
+        char const * const end = data + size;
+        std::size_t rows = 0;
+        fields row;
+
+        while ( split( p, end, row ) )
+        {
+            f( row );
+            ++rows;
+        }
+
+        double const seconds = std::chrono::duration<double>( std::chrono::steady_clock::now() - start ).count();
+
+        if ( seconds < best.seconds )
+            best = { seconds, rows, allocations - allocations_before };
+    }
+    return best;
+}
+
+} // anonymous namespace
+
+int main( int argc, char * argv[] )
+{
+    std::size_t const mib   = argc > 1 ? static_cast<std::size_t>( std::strtoul( argv[1], nullptr, 10 ) ) : 256;
+    std::size_t const bytes = mib << 20;
+
+    std::error_code ec;
+    optfun_lite::detail::file_mapping mapping( path, ec );
+
+    if ( ec || mapping.size() < bytes || mapping.size() > bytes + 160 )
+    {
+        mapping = optfun_lite::detail::file_mapping();
+
+        if ( generate( bytes ) == 0 )
+        {
+            std::printf( "cannot write %s\n", path );
+            return EXIT_FAILURE;
+        }
+        ec.clear();
+        mapping = optfun_lite::detail::file_mapping( path, ec );
+    }
+
+    if ( ec )
+    {
+        std::printf( "cannot map %s: %s\n", path, ec.message().c_str() );
+        return EXIT_FAILURE;
+    }
+
+    char const * const data = reinterpret_cast<char const *>( mapping.data() );
+    std::size_t  const size = mapping.size();
+
+    totals scratch;
+    double sink = 0;
+
+    auto const split_only = pass( data, size, [&]( fields const & f ) { sink += f[amount_field].has_value(); } );
+    auto const hand       = pass( data, size, [&]( fields const & f ) { hand_written( f, scratch ); } );
+    auto const piped      = pass( data, size, [&]( fields const & f ) { chains( f, scratch ); } );
+
+    totals by_hand, by_chains;
+
+    pass( data, size, [&]( fields const & f ) { hand_written( f, by_hand ); }, 1 );
+    pass( data, size, [&]( fields const & f ) { chains( f, by_chains ); }, 1 );
+
+    auto report = [&]( char const * name, pass_result const & r )
+    {
+        std::printf( "%-14s %8.2f %10.1f %10.1f %11zu\n", name, 1e3 * r.seconds
+            , double( r.rows ) / r.seconds / 1e6, double( size ) / r.seconds / double( 1 << 20 ), r.allocations );
+    };
+
+    std::printf( "%s: %zu MiB, %zu rows\n\n", path, size >> 20, split_only.rows );
+    std::printf( "pass                 ms  Mrows/s      MiB/s allocations\n" );
+    report( "split only", split_only );
+    report( "hand-written", hand );
+    report( "pipe chains", piped );
+    std::printf( "\n%s, %zu rows rejected\n\n", by_chains == by_hand ? "same totals" : "totals differ", by_chains.rejected );
+
+    // time per chain, beyond splitting:
+
+    auto chain = [&]( char const * name, column c, auto const & stage )
+    {
+        auto const r = pass( data, size, [&]( fields const & f ) { bench::keep( f[c] | stage ); } );
+        std::printf( "%-10s %6.2f ns/row\n", name, 1e9 * ( r.seconds - split_only.seconds ) / double( r.rows ) );
+    };
+
+    std::printf( "chain      beyond splitting\n" );
+    chain( "id",       id_field,       id_of );
+    chain( "time",     time_field,     hour_of );
+    chain( "country",  country_field,  country_of );
+    chain( "amount",   amount_field,   amount_of );
+    chain( "quantity", quantity_field, quantity_of );
+    chain( "discount", discount_field, factor_of );
+
+#if optfun_CONFIG_INSTRUMENT
+    std::printf( "\nstages, all passes\n" );
+    std::fflush( stdout );
+    instrument::dump( std::cout );
+#endif
+
+    bench::keep( sink );
+}
+
+// end of file
@@ -0,0 +1,73 @@
+// Copyright 2017-2018 by Martin Moene
+//
+// https://github.com/martinmoene/optional-fun-lite
+//
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+// Load a nullable column from disk and sum its present values: deserialized
+// into a std::vector of optionals against mapped in place via map_column().
+
+#include "bench.hpp"
+#include "nonstd/optional-fun-mmap.hpp"
+
+#include <cstdio>
+
+using namespace nonstd;
+
+namespace {
+
+char const * const path = "bench-mmap.col";
+
+std::size_t const n = 1 << 24;
+
+// read the column file's elements one at a time, as a deserializer would:
+
+std::vector< optional<double> > deserialize( mapped_column<double> const & c )
+{
+    std::vector< optional<double> > result;
+    result.reserve( c.size() );
+
+    for ( optional<double> o : c )
+    {
+        result.push_back( o );
+    }
+    return result;
+}
+
+} // anonymous namespace
+
+int main()
+{
+    if ( std::error_code const ec = write_column( path, bench::make_optionals<double>( n, 0.9 ) ) )
+    {
+        std::printf( "cannot write %s: %s\n", path, ec.message().c_str() );
+        return 1;
+    }
+
+    std::error_code ec;
+    double sum_copy = 0;
+    double sum_mapped = 0;
+
+    double const copy = bench::ns_per_element( n, 5, [&]
+    {
+        optional< mapped_column<double> > const c = map_column<double>( path, ec );
+        sum_copy = deserialize( *c ) | sum_present();
+        bench::keep( sum_copy );
+    });
+
+    double const mapped = bench::ns_per_element( n, 5, [&]
+    {
+        optional< mapped_column<double> > const c = map_column<double>( path, ec );
+        sum_mapped = c->view() | sum_present();
+        bench::keep( sum_mapped );
+    });
+
+    std::remove( path );
+
+    std::printf( "load and sum a column of %zu optional<double>, 90%% present, ns per element (file in page cache)\n\n", n );
+    std::printf( "deserialized  mapped\n" );
+    std::printf( "%12.2f  %6.2f  %s\n", copy, mapped, sum_copy == sum_mapped ? "" : "(sums differ)" );
+}
+
+// end of file
@@ -0,0 +1,52 @@
+// Copyright 2017-2018 by Martin Moene
+//
+// https://github.com/martinmoene/optional-fun-lite
+//
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+// Tri-state feature flags: compare the size and the map(), and_() and or_()
+// time of a packed_optional_array<bool> to a std::vector of optional<bool>.
+
+#include "bench.hpp"
+#include "nonstd/optional-fun-packed.hpp"
+
+#include <cstdio>
+
+using namespace nonstd;
+
+int main()
+{
+    std::size_t const n = 1 << 24;
+
+    auto const dense = bench::make_optionals<bool>( n, 0.7 );
+    packed_optional_array<bool> const packed( dense );
+
+    auto const flip = map( []( bool b ) { return ! b; } );
+
+    auto each = [&]( auto const & stage )
+    {
+        return bench::ns_per_element( n, 5, [&]
+        {
+            std::vector< optional<bool> > out;
+            out.reserve( n );
+            for ( auto const & o : dense )
+                out.push_back( optional<bool>( o | stage ) );
+            bench::keep( out.data() );
+        });
+    };
+
+    auto packed_each = [&]( auto const & stage )
+    {
+        return bench::ns_per_element( n, 5, [&] { bench::keep( ( packed | stage ).words().data() ); } );
+    };
+
+    std::printf( "%zu optional<bool>, 70%% present, ns per element\n\n", n );
+    std::printf( "              bytes/element  map(!)  and_(true)  or_(false)\n" );
+    std::printf( "vector        %13.2f  %6.2f  %10.2f  %10.2f\n"
+        , double( sizeof( optional<bool> ) ), each( flip ), each( and_( true ) ), each( or_( false ) ) );
+    std::printf( "packed 2-bit  %13.2f  %6.2f  %10.2f  %10.2f\n"
+        , 8.0 * double( packed.words().size() ) / double( n ), packed_each( flip ), packed_each( and_( true ) ), packed_each( or_( false ) ) );
+}
+
+// end of file
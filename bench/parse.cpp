@@ -0,0 +1,87 @@
+// Copyright 2017-2018 by Martin Moene
+//
+// https://github.com/martinmoene/optional-fun-lite
+//
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+// Text fields to numbers: compare parse<T>() and parse_all<T>() to an and_then()
+// via std::stoi() and std::stod(), which allocate a std::string and throw on
+// malformed input, for fields of which 1% is malformed.
+
+#include "bench.hpp"
+#include "nonstd/optional-fun-parse.hpp"
+
+#include <cstdio>
+#include <stdexcept>
+#include <string>
+
+using namespace nonstd;
+
+namespace {
+
+template< typename T >
+optional<T> stox( std::string_view s )
+{
+    try
+    {
+        std::size_t pos = 0;
+        std::string const text( s );
+        T const value = std::is_integral_v<T> ? static_cast<T>( std::stoi( text, &pos ) ) : static_cast<T>( std::stod( text, &pos ) );
+        return pos == text.size() ? optional<T>( value ) : optional<T>();
+    }
+    catch ( std::exception const & )
+    {
+        return nullopt;
+    }
+}
+
+} // anonymous namespace
+
+int main()
+{
+    std::size_t const n = 1 << 20;
+
+    auto const present = bench::make_optionals<int>( n, 0.9 );
+
+    std::vector<std::string> texts_int( n ), texts_double( n );
+    std::vector< optional<std::string_view> > ints( n ), doubles( n );
+
+    for ( std::size_t i = 0; i != n; ++i )
+    {
+        bool const malformed = i % 100 == 0;
+
+        texts_int[i]    = malformed ? "12x" : std::to_string( present[i].value_or( 1 ) * 1234567 - 50000000 );
+        texts_double[i] = malformed ? "1.5.0" : std::to_string( present[i].value_or( 1 ) * 0.0137 );
+
+        if ( present[i] )
+        {
+            ints[i]    = texts_int[i];
+            doubles[i] = texts_double[i];
+        }
+    }
+
+    auto each = [&]( auto const & column, auto const & stage )
+    {
+        return bench::ns_per_element( n, 5, [&]
+        {
+            std::size_t count = 0;
+            for ( auto const & o : column )
+                count += ( o | stage ).has_value();
+            bench::keep( count );
+        });
+    };
+
+    auto all = [&]( auto const & column, auto const & stage )
+    {
+        return bench::ns_per_element( n, 5, [&] { bench::keep( ( column | stage ).data() ); } );
+    };
+
+    std::printf( "%zu optional text fields, 90%% present, 1%% malformed, ns per field\n\n", n );
+    std::printf( "                           int  double\n" );
+    std::printf( "and_then( stoi, stod )  %6.2f  %6.2f\n", each( ints, and_then( stox<int> ) ), each( doubles, and_then( stox<double> ) ) );
+    std::printf( "parse<T>()              %6.2f  %6.2f\n", each( ints, parse<int>() ), each( doubles, parse<double>() ) );
+    std::printf( "parse_all<T>()          %6.2f  %6.2f\n", all( ints, parse_all<int>() ), all( doubles, parse_all<double>() ) );
+}
+
+// end of file
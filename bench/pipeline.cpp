@@ -0,0 +1,69 @@
+// Copyright 2017-2018 by Martin Moene
+//
+// https://github.com/martinmoene/optional-fun-lite
+//
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+// Evaluate a chain of map | filter | and_then | or_else chosen at runtime:
+// stored as a std::function, as a pipeline per element and per batch via apply(),
+// against the chain composed at compile time.
+
+#include "bench.hpp"
+#include "nonstd/optional-fun.hpp"
+
+#include <cstdio>
+#include <functional>
+
+using namespace nonstd;
+
+namespace {
+
+auto const scale    = []( int x ) { return 3 * x + 1; };
+auto const in_range = []( int x ) { return x < 250; };
+auto const halve    = []( int x ) { return x % 2 ? optional<int>() : optional<int>( x / 2 ); };
+auto const fallback = []() { return -1; };
+
+auto const chain = map( scale ) | filter( in_range ) | and_then( halve ) | or_else( fallback );
+
+template< typename F >
+double run( std::vector< optional<int> > const & v, std::vector< optional<int> > & out, F f )
+{
+    return bench::ns_per_element( v.size(), 15, [&]
+    {
+        f( v, out );
+        bench::keep( out.back() );
+    });
+}
+
+} // anonymous namespace
+
+int main()
+{
+    std::size_t const n = 1 << 20;
+
+    // chosen at runtime, as a rule engine would per tenant:
+
+    std::function< optional<int>( optional<int> const & ) > const function = chain;
+    pipeline<int, int> const p = chain;
+
+    std::printf( "map | filter | and_then | or_else, ns per element, %zu elements, pipeline inline: %s\n\n"
+        , n, p.is_inline() ? "yes" : "no" );
+    std::printf( "present%%  composed  std::function  pipeline  pipeline::apply\n" );
+
+    for ( double presence : { 0.5, 0.9, 1.0 } )
+    {
+        auto const v = bench::make_optionals<int>( n, presence );
+        std::vector< optional<int> > out( n );
+
+        std::printf( "%7.0f  %8.2f  %13.2f  %8.2f  %15.2f\n"
+            , 100 * presence
+            , run( v, out, [&]( auto const & in, auto & o ) { for ( std::size_t i = 0; i != in.size(); ++i ) o[i] = in[i] | chain; } )
+            , run( v, out, [&]( auto const & in, auto & o ) { for ( std::size_t i = 0; i != in.size(); ++i ) o[i] = function( in[i] ); } )
+            , run( v, out, [&]( auto const & in, auto & o ) { for ( std::size_t i = 0; i != in.size(); ++i ) o[i] = in[i] | p; } )
+            , run( v, out, [&]( auto const & in, auto & o ) { p.apply( in, o ); } )
+        );
+    }
+}
+
+// end of file
@@ -0,0 +1,59 @@
+// Copyright 2017-2018 by Martin Moene
+//
+// https://github.com/martinmoene/optional-fun-lite
+//
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+// Sweep the fraction of present optionals and time map_or() with and without presence hint
+// and map_or_branchless().
+
+#include "bench.hpp"
+#include "nonstd/optional-fun.hpp"
+
+#include <cstdio>
+
+using namespace nonstd;
+
+namespace {
+
+int twice( int x ) { return 2 * x + 1; }
+
+template< typename Stage >
+double run( std::vector< optional<int> > const & v, Stage stage )
+{
+    return bench::ns_per_element( v.size(), 15, [&]
+    {
+        long sum = 0;
+        for ( auto const & o : v )
+        {
+            sum += o | stage;
+        }
+        bench::keep( sum );
+    });
+}
+
+} // anonymous namespace
+
+int main()
+{
+    std::size_t const n = 1 << 20;
+
+    std::printf( "map_or(f, 0) and map_or_branchless(f, 0), ns per element, %zu elements\n\n", n );
+    std::printf( "present%%  none  likely  unlikely  branchless\n" );
+
+    for ( double presence : { 0.0, 0.01, 0.05, 0.25, 0.50, 0.75, 0.95, 0.99, 1.0 } )
+    {
+        auto const v = bench::make_optionals<int>( n, presence );
+
+        std::printf( "%7.0f  %5.2f  %6.2f  %8.2f  %10.2f\n"
+            , 100 * presence
+            , run( v, map_or( twice, 0 ) )
+            , run( v, map_or( twice, 0 ).likely() )
+            , run( v, map_or( twice, 0 ).unlikely() )
+            , run( v, map_or_branchless( twice, 0 ) )
+        );
+    }
+}
+
+// end of file
@@ -0,0 +1,132 @@
+// Copyright 2017-2018 by Martin Moene
+//
+// https://github.com/martinmoene/optional-fun-lite
+//
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+// Build a string payload per element in a map/and_then chain on several threads:
+// via the global allocator against a per-thread monotonic arena of with_resource(),
+// with the functions taking a resource_allocator or their payload moved into the arena.
+
+#include "bench.hpp"
+#include "nonstd/optional-fun.hpp"
+
+#include <cstdio>
+#include <string>
+#include <thread>
+
+using namespace nonstd;
+
+namespace {
+
+std::size_t const n     = 1 << 18;  // elements per thread
+std::size_t const batch = 256;      // elements per arena release
+
+char const prefix[] = "customer-record-";
+
+// global allocator:
+
+std::string label( int x )
+{
+    return prefix + std::to_string( x );
+}
+
+optional<std::string> decorate( std::string const & s )
+{
+    return s + "-checked-and-decorated";
+}
+
+// allocator-aware:
+
+std::pmr::string label_in( int x, resource_allocator alloc )
+{
+    std::pmr::string result( prefix, alloc );
+    result += std::to_string( x );
+    return result;
+}
+
+optional<std::pmr::string> decorate_in( std::pmr::string const & s, resource_allocator alloc )
+{
+    std::pmr::string result( s, alloc );
+    result += "-checked-and-decorated";
+    return result;
+}
+
+// payload moved into the arena:
+
+std::pmr::string label_pmr( int x )
+{
+    return std::pmr::string( prefix ) + std::to_string( x ).c_str();
+}
+
+optional<std::pmr::string> decorate_pmr( std::pmr::string const & s )
+{
+    return s + "-checked-and-decorated";
+}
+
+void run_global( std::vector< optional<int> > const & v )
+{
+    for ( auto const & o : v )
+    {
+        optional<std::string> s = o | map( label ) | and_then( decorate );
+        bench::keep( s.has_value() ? s->size() : 0 );
+    }
+}
+
+template< typename F, typename G >
+void run_arena( std::vector< optional<int> > const & v, F f, G g )
+{
+    alignas( std::max_align_t ) static thread_local char buffer[ batch * 128 ];
+
+    for ( std::size_t i = 0; i < v.size(); i += batch )
+    {
+        std::pmr::monotonic_buffer_resource arena( buffer, sizeof buffer );
+
+        for ( std::size_t k = i; k != (std::min)( i + batch, v.size() ); ++k )
+        {
+            optional<std::pmr::string> s = v[k] | with_resource( &arena ) | map( f ) | and_then( g );
+            bench::keep( s.has_value() ? s->size() : 0 );
+        }
+    }
+}
+
+// wall time in nanoseconds per element of a thread, all threads running f:
+
+template< typename F >
+double on_threads( unsigned threads, std::vector< optional<int> > const & v, F f )
+{
+    return bench::ns_per_element( v.size(), 5, [&]
+    {
+        std::vector<std::thread> pool;
+
+        for ( unsigned t = 0; t != threads; ++t )
+            pool.emplace_back( [&]{ f( v ); } );
+
+        for ( auto & thread : pool )
+            thread.join();
+    });
+}
+
+} // anonymous namespace
+
+int main()
+{
+    std::vector< optional<int> > const v = bench::make_optionals<int>( n, 0.9 );
+
+    std::printf( "map | and_then building strings, ns per element of a thread, %zu elements per thread, %u hardware threads\n\n"
+        , n, std::thread::hardware_concurrency() );
+    std::printf( "threads  global  arena(allocator)  arena(moved in)\n" );
+
+    for ( unsigned threads : { 1u, 2u, 4u, 8u, 16u } )
+    {
+        std::printf( "%7u  %6.1f  %16.1f  %15.1f\n"
+            , threads
+            , on_threads( threads, v, run_global )
+            , on_threads( threads, v, []( auto const & w ) { run_arena( w, label_in , decorate_in  ); } )
+            , on_threads( threads, v, []( auto const & w ) { run_arena( w, label_pmr, decorate_pmr ); } )
+        );
+    }
+}
+
+// end of file
@@ -0,0 +1,71 @@
+// Copyright 2017-2018 by Martin Moene
+//
+// https://github.com/martinmoene/optional-fun-lite
+//
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+// Sweep the fraction of present optionals and compare the size, a pass over
+// the present values, map() and random access of a sparse_optional_vector to
+// a std::vector of optionals.
+
+#include "bench.hpp"
+#include "nonstd/optional-fun-sparse.hpp"
+
+#include <cstdio>
+
+using namespace nonstd;
+
+int main()
+{
+    std::size_t const n = 1 << 22;
+
+    std::vector<std::size_t> index( n );
+    {
+        std::mt19937 gen( 7 );
+        std::uniform_int_distribution<std::size_t> pick( 0, n - 1 );
+        for ( auto & i : index )
+            i = pick( gen );
+    }
+
+    std::printf( "optional<double>, %zu elements: std::vector against sparse_optional_vector\n\n", n );
+    std::printf( "present%%  bytes/element: vector  sparse   sum ns/element: vector  sparse   map: vector  sparse   v[i]: vector  sparse\n" );
+
+    for ( double presence : { 0.01, 0.05, 0.2, 0.5, 1.0 } )
+    {
+        auto const dense = bench::make_optionals<double>( n, presence );
+        sparse_optional_vector<double> const sparse( dense );
+
+        auto const twice = []( double x ) { return 2 * x; };
+        double sum = 0;
+
+        double const sum_dense  = bench::ns_per_element( n, 5, [&] { sum += dense | sum_present(); } );
+        double const sum_sparse = bench::ns_per_element( n, 5, [&]
+        {
+            for ( double x : sparse.values() )
+                sum += x;
+        });
+
+        double const map_dense  = bench::ns_per_element( n, 5, [&]
+        {
+            std::vector< optional<double> > out;
+            out.reserve( n );
+            for ( auto const & o : dense )
+                out.push_back( o | map( twice ) );
+            bench::keep( out.data() );
+        });
+        double const map_sparse = bench::ns_per_element( n, 5, [&] { bench::keep( ( sparse | map( twice ) ).count() ); } );
+
+        double const at_dense  = bench::ns_per_element( n, 5, [&] { for ( std::size_t i : index ) sum += dense[i].value_or( 0 ); } );
+        double const at_sparse = bench::ns_per_element( n, 5, [&] { for ( std::size_t i : index ) sum += sparse[i].value_or( 0 ); } );
+
+        bench::keep( sum );
+
+        std::printf( "%7.0f  %20.2f  %6.2f  %22.2f  %6.2f  %11.2f  %6.2f  %12.2f  %6.2f\n"
+            , 100 * presence
+            , double( sizeof( optional<double> ) ), double( sparse.memory_bytes() ) / double( n )
+            , sum_dense, sum_sparse, map_dense, map_sparse, at_dense, at_sparse );
+    }
+}
+
+// end of file
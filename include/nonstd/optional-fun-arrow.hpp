@@ -0,0 +1,349 @@
+//
+// Copyright (c) 2017 Martin Moene
+//
+// https://github.com/martinmoene/optional-fun-lite
+//
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+// optional-fun-arrow: zero-copy export and import of nullable columns
+// via the Arrow C data interface, without depending on an Arrow library.
+
+#pragma once
+
+#ifndef NONSTD_OPTIONAL_FUN_ARROW_LITE_HPP
+#define NONSTD_OPTIONAL_FUN_ARROW_LITE_HPP
+
+#include "optional-fun.hpp"
+
+#if optfun_CPP17_OR_GREATER
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <system_error>
+#include <type_traits>
+#include <utility>
+
+// Arrow C data interface, as specified by https://arrow.apache.org/docs/format/CDataInterface.html;
+// the guard lets these definitions coexist with those of Arrow's own abi.h:
+
+#ifndef ARROW_C_DATA_INTERFACE
+#define ARROW_C_DATA_INTERFACE
+
+#define ARROW_FLAG_DICTIONARY_ORDERED  1
+#define ARROW_FLAG_NULLABLE            2
+#define ARROW_FLAG_MAP_KEYS_SORTED     4
+
+extern "C" {
+
+struct ArrowSchema
+{
+    // array type description:
+    const char * format;
+    const char * name;
+    const char * metadata;
+    int64_t flags;
+    int64_t n_children;
+    struct ArrowSchema ** children;
+    struct ArrowSchema * dictionary;
+
+    // release callback:
+    void (*release)( struct ArrowSchema * );
+
+    // opaque producer-specific data:
+    void * private_data;
+};
+
+struct ArrowArray
+{
+    // array data description:
+    int64_t length;
+    int64_t null_count;
+    int64_t offset;
+    int64_t n_buffers;
+    int64_t n_children;
+    const void ** buffers;
+    struct ArrowArray ** children;
+    struct ArrowArray * dictionary;
+
+    // release callback:
+    void (*release)( struct ArrowArray * );
+
+    // opaque producer-specific data:
+    void * private_data;
+};
+
+} // extern "C"
+
+#endif // ARROW_C_DATA_INTERFACE
+
+//
+// Arrow export and import:
+// - export_arrow(v, array, schema) describes nullable_view v as an Arrow primitive array
+//   without copying: buffer 0 is v's validity bitmap, buffer 1 its values,
+// - an optional owner, like a std::shared_ptr to the container of the buffers, is kept
+//   alive until the consumer releases the array; without one, the buffers must outlive it,
+// - import_arrow<T>(array, schema, ec) takes over an Arrow primitive array of T, leaving
+//   array released, and yields an arrow_column<T>: a nullable_view of its buffers that
+//   releases the array when destroyed, for the adaptors and range stages,
+// - T is an integral type other than bool, or float or double.
+//
+
+namespace nonstd { namespace optfun_lite {
+
+// errors of import_arrow():
+
+enum class arrow_errc
+{
+    released = 1,       // the array or schema has been released
+    format_mismatch,    // the schema's format is not that of T
+    unsupported_layout, // not a primitive array: buffers, children or dictionary
+    unsupported_offset, // offset is not a multiple of 8, the bitmap cannot be viewed in place
+};
+
+namespace detail {
+
+class arrow_category_t : public std::error_category
+{
+public:
+    char const * name() const noexcept override
+    {
+        return "optional-fun arrow";
+    }
+
+    std::string message( int ev ) const override
+    {
+        switch ( static_cast<arrow_errc>( ev ) )
+        {
+            case arrow_errc::released:           return "released Arrow array or schema";
+            case arrow_errc::format_mismatch:    return "Arrow format of another value type";
+            case arrow_errc::unsupported_layout: return "not an Arrow primitive array";
+            case arrow_errc::unsupported_offset: return "Arrow array offset is not a multiple of 8";
+        }
+        return "unknown Arrow import error";
+    }
+};
+
+} // namespace detail
+
+inline std::error_category const & arrow_category() noexcept
+{
+    static detail::arrow_category_t const category;
+    return category;
+}
+
+inline std::error_code make_error_code( arrow_errc e ) noexcept
+{
+    return std::error_code( static_cast<int>( e ), arrow_category() );
+}
+
+}} // namespace nonstd::optfun_lite
+
+namespace std {
+
+template<>
+struct is_error_code_enum< ::nonstd::optfun_lite::arrow_errc > : true_type {};
+
+} // namespace std
+
+namespace nonstd { namespace optfun_lite {
+
+namespace detail {
+
+// Arrow format string of primitive type T:
+
+template< typename T >
+constexpr char const * arrow_format()
+{
+    static_assert( std::is_arithmetic_v<T> && ! std::is_same_v<T, bool>, "Arrow primitive arrays of bool are bit-packed, use an integral type other than bool" );
+
+    if constexpr ( std::is_floating_point_v<T> )
+    {
+        static_assert( sizeof( T ) == 4 || sizeof( T ) == 8, "Arrow floating point is float or double" );
+        return sizeof( T ) == 4 ? "f" : "g";
+    }
+    else if constexpr ( std::is_signed_v<T> )
+    {
+        return sizeof( T ) == 1 ? "c" : sizeof( T ) == 2 ? "s" : sizeof( T ) == 4 ? "i" : "l";
+    }
+    else
+    {
+        return sizeof( T ) == 1 ? "C" : sizeof( T ) == 2 ? "S" : sizeof( T ) == 4 ? "I" : "L";
+    }
+}
+
+struct arrow_export
+{
+    void const *                buffers[2];
+    std::shared_ptr<void const> owner;
+};
+
+extern "C" inline void optfun_release_arrow_array( ArrowArray * array )
+{
+    delete static_cast<arrow_export *>( array->private_data );
+    array->release = nullptr;
+}
+
+extern "C" inline void optfun_release_arrow_schema( ArrowSchema * schema )
+{
+    schema->release = nullptr;
+}
+
+} // namespace detail
+
+// export_arrow(v, array, schema, owner): describe v as an Arrow primitive array, without a copy;
+// the null count is left unknown (-1) if v has a validity bitmap:
+
+template< typename T >
+void export_arrow( nullable_view<T> const & v, ArrowArray * array, ArrowSchema * schema, std::shared_ptr<void const> owner = nullptr )
+{
+    auto * const data = new detail::arrow_export{ { v.validity(), v.values() }, std::move( owner ) };
+
+    array->length       = static_cast<int64_t>( v.size() );
+    array->null_count   = v.validity() == nullptr ? 0 : -1;
+    array->offset       = 0;
+    array->n_buffers    = 2;
+    array->n_children   = 0;
+    array->buffers      = data->buffers;
+    array->children     = nullptr;
+    array->dictionary   = nullptr;
+    array->release      = &detail::optfun_release_arrow_array;
+    array->private_data = data;
+
+    schema->format       = detail::arrow_format<T>();
+    schema->name         = "";
+    schema->metadata     = nullptr;
+    schema->flags        = ARROW_FLAG_NULLABLE;
+    schema->n_children   = 0;
+    schema->children     = nullptr;
+    schema->dictionary   = nullptr;
+    schema->release      = &detail::optfun_release_arrow_schema;
+    schema->private_data = nullptr;
+}
+
+// arrow_column<T>: an imported Arrow primitive array, released when destroyed:
+// - a random-access range of optional<T>, each read from the array's buffers,
+// - view() gives the nullable_view for the range stages, like `c.view() | sum_present()`.
+
+template< typename T >
+class arrow_column
+{
+public:
+    using value_type     = optional<T>;
+    using const_iterator = typename nullable_view<T>::const_iterator;
+    using iterator       = const_iterator;
+
+    // take over array, leaving it released:
+
+    arrow_column( ArrowArray * array, nullable_view<T> view )
+    : array_( *array ), view_( view )
+    {
+        array->release = nullptr;
+    }
+
+    arrow_column( arrow_column && other ) noexcept
+    : array_( other.array_ ), view_( other.view_ )
+    {
+        other.array_.release = nullptr;
+    }
+
+    arrow_column & operator=( arrow_column && other ) noexcept
+    {
+        if ( this != &other )
+        {
+            release();
+            array_ = other.array_;
+            view_  = other.view_;
+            other.array_.release = nullptr;
+        }
+        return *this;
+    }
+
+    ~arrow_column()
+    {
+        release();
+    }
+
+    std::size_t size()  const { return view_.size(); }
+    bool        empty() const { return view_.size() == 0; }
+
+    // the array's null count, -1 if unknown:
+
+    std::int64_t null_count() const { return array_.null_count; }
+
+    optional<T> operator[]( std::size_t i ) const { return view_[i]; }
+
+    const_iterator begin() const { return view_.begin(); }
+    const_iterator end()   const { return view_.end(); }
+
+    nullable_view<T> const & view() const { return view_; }
+
+private:
+    void release() noexcept
+    {
+        if ( array_.release != nullptr )
+        {
+            array_.release( &array_ );
+        }
+    }
+
+    ArrowArray       array_;
+    nullable_view<T> view_;
+};
+
+// import_arrow<T>(array, schema, ec): take over Arrow primitive array of T; schema is only read.
+// nullopt and ec set if it is not one, array is then left to the caller:
+
+template< typename T >
+optional< arrow_column<T> > import_arrow( ArrowArray * array, ArrowSchema const * schema, std::error_code & ec )
+{
+    ec.clear();
+
+    if ( array->release == nullptr || schema->release == nullptr )
+        ec = arrow_errc::released;
+    else if ( schema->format == nullptr || std::strcmp( schema->format, detail::arrow_format<T>() ) != 0 )
+        ec = arrow_errc::format_mismatch;
+    else if ( array->n_buffers != 2 || array->n_children != 0 || array->dictionary != nullptr || schema->dictionary != nullptr )
+        ec = arrow_errc::unsupported_layout;
+    else if ( array->offset % 8 != 0 )
+        ec = arrow_errc::unsupported_offset;
+
+    if ( ec )
+    {
+        return nullopt;
+    }
+
+    std::size_t const offset = static_cast<std::size_t>( array->offset );
+
+    T const * const values = static_cast<T const *>( array->buffers[1] ) + offset;
+
+    std::uint8_t const * const validity = array->buffers[0] != nullptr
+        ? static_cast<std::uint8_t const *>( array->buffers[0] ) + offset / 8 : nullptr;
+
+    return arrow_column<T>( array, nullable_view<T>( values, validity, static_cast<std::size_t>( array->length ) ) );
+}
+
+}} // namespace nonstd::optfun_lite
+
+//
+// make Arrow export and import available in namespace nonstd:
+//
+
+namespace nonstd {
+
+using optfun_lite::arrow_errc;
+using optfun_lite::arrow_category;
+using optfun_lite::arrow_column;
+using optfun_lite::export_arrow;
+using optfun_lite::import_arrow;
+
+} // namespace nonstd
+
+#endif // optfun_CPP17_OR_GREATER
+
+#endif // NONSTD_OPTIONAL_FUN_ARROW_LITE_HPP
+
+// end of file
@@ -0,0 +1,147 @@
+//
+// Copyright (c) 2017 Martin Moene
+//
+// https://github.com/martinmoene/optional-fun-lite
+//
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+// optional-fun-bridge: C-style results with a sentinel or a null pointer as inputs of the adaptors.
+
+#pragma once
+
+#ifndef NONSTD_OPTIONAL_FUN_BRIDGE_LITE_HPP
+#define NONSTD_OPTIONAL_FUN_BRIDGE_LITE_HPP
+
+#include "optional-fun.hpp"
+
+#if optfun_CPP17_OR_GREATER
+
+#include <type_traits>
+#include <utility>
+
+//
+// Bridges:
+// - from_sentinel(v, s): v, empty if it equals s, like `from_sentinel( std::getc( f ), EOF )`,
+// - from_errno(r): r, empty if negative, like `from_errno( ::read( fd, buf, n ) )`, for a result
+//   of -1 with the cause in errno, or a negated error number,
+// - from_nullable(p): *p as an optional_ref, empty if p is null, like `from_nullable( std::localtime( &t ) )`,
+// - from_predicate(v, p): v, empty unless p(v), like `from_predicate( x, []( double d ) { return d == d; } )`
+//   for a result that is NaN on failure,
+// - the adaptors take them in place of an optional, like `from_errno( n ) | map( f ) | or_else( g )`:
+//   the bridge holds the raw result, without the flag of an optional, and an adaptor's test of
+//   its presence is the test on the raw result itself, the branch one would write by hand,
+// - an adaptor without a hint expects from_errno() to succeed, as the compiler does for a
+//   hand-written test of a negative result, so that both compile to the same branch.
+//
+
+namespace nonstd { namespace optfun_lite {
+
+// raw result v of type T, present if present(v):
+
+template< typename T, typename Present >
+class bridged
+{
+public:
+    typedef T value_type;
+
+    optfun_force_inline bridged( T v, Present present )
+    : value_( std::move( v ) ), present_( std::move( present ) ) {}
+
+    optfun_force_inline bool has_value() const { return present_( value_ ); }
+
+    optfun_force_inline T const & operator*()  const { return  value_; }
+    optfun_force_inline T const * operator->() const { return &value_; }
+
+    template< typename U >
+    optfun_force_inline T value_or( U const & u ) const
+    {
+        return has_value() ? value_ : static_cast<T>( u );
+    }
+
+    template< typename U >
+    optfun_force_inline operator optional<U>() const
+    {
+        return has_value() ? optional<U>( value_ ) : optional<U>();
+    }
+
+private:
+    T value_;
+    optfun_no_unique_address Present present_;
+};
+
+template< typename T, typename Present >
+optfun_force_inline bool has_value( bridged<T, Present> const & o ) { return o.has_value(); }
+
+namespace detail {
+
+template< typename T, typename Present >
+struct is_optional_like< bridged<T, Present> > { static const bool value = true; };
+
+template< typename T >
+struct not_sentinel
+{
+    T sentinel;
+
+    optfun_force_inline bool operator()( T const & v ) const { return !( v == sentinel ); }
+};
+
+struct non_negative
+{
+    template< typename T >
+    optfun_force_inline bool operator()( T const & v ) const { return v >= T( 0 ); }
+};
+
+// GCC predicts a negative return value, an error, in 2% of calls; so does an adaptor on one:
+
+template< typename T >
+struct expects_present< bridged<T, non_negative> > { static const bool value = true; };
+
+} // namespace detail
+
+template< typename T >
+optfun_force_inline bridged< T, detail::not_sentinel<T> > from_sentinel( T v, std::common_type_t<T> sentinel )
+{
+    return bridged< T, detail::not_sentinel<T> >( std::move( v ), detail::not_sentinel<T>{ std::move( sentinel ) } );
+}
+
+template< typename T >
+optfun_force_inline bridged< T, detail::non_negative > from_errno( T r )
+{
+    static_assert( std::is_signed_v<T> && std::is_integral_v<T>, "from_errno(r): r must be a signed integer" );
+
+    return bridged< T, detail::non_negative >( r, detail::non_negative() );
+}
+
+template< typename T >
+optfun_force_inline optional_ref<T> from_nullable( T * p )
+{
+    return p != nullptr ? optional_ref<T>( *p ) : optional_ref<T>();
+}
+
+template< typename T, typename Predicate >
+optfun_force_inline bridged< T, Predicate > from_predicate( T v, Predicate p )
+{
+    return bridged< T, Predicate >( std::move( v ), std::move( p ) );
+}
+
+}} // namespace nonstd::optfun_lite
+
+//
+// make bridges available in namespace nonstd:
+//
+
+namespace nonstd {
+
+using optfun_lite::from_sentinel;
+using optfun_lite::from_errno;
+using optfun_lite::from_nullable;
+using optfun_lite::from_predicate;
+
+} // namespace nonstd
+
+#endif // optfun_CPP17_OR_GREATER
+
+#endif // NONSTD_OPTIONAL_FUN_BRIDGE_LITE_HPP
+
+// end of file
@@ -0,0 +1,484 @@
+//
+// Copyright (c) 2017 Martin Moene
+//
+// https://github.com/martinmoene/optional-fun-lite
+//
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+// optional-fun-codec: streaming binary codec for sequences of optionals,
+// with run-length-encoded presence.
+
+#pragma once
+
+#ifndef NONSTD_OPTIONAL_FUN_CODEC_LITE_HPP
+#define NONSTD_OPTIONAL_FUN_CODEC_LITE_HPP
+
+#include "optional-fun.hpp"
+
+#if optfun_CPP17_OR_GREATER
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+//
+// optional codec:
+// - optional_encoder<T> encodes optionals pushed one at a time into a buffer that it hands
+//   to a sink when full; optional_decoder<T> decodes buffers fed one at a time, of any size,
+//   and passes each optional to a consumer, so neither side holds the whole sequence,
+// - `decoder | map( f ) | filter( g )` applies the stages to each decoded optional,
+// - encode_optionals(r) and decode_optionals<T>(data, size) code a whole range at once,
+// - a decoder of untrusted input takes a maximum number of elements, since a run header of
+//   a few bytes may announce a run of empty optionals of any length.
+//
+// wire format, a sequence of runs:
+// - run header: varint of `( length << 1 ) | present`,
+// - a run of present values is followed by `length` payloads, a run of empty ones by nothing,
+//   so a run of empty optionals of any length takes a few bytes,
+// - varint: LEB128, 7 bits per byte, least significant group first, high bit set if more follow,
+//   at most 10 bytes, the 10th holding only the top bit of a 64-bit value,
+// - payload per varint_payload: varint of the value, zigzag-encoded if signed; or per
+//   fixed_payload: sizeof(T) bytes of the value's representation, little-endian.
+//
+
+namespace nonstd { namespace optfun_lite {
+
+// varint_payload: integral values as varint, small magnitudes take a byte:
+
+struct varint_payload
+{
+    static constexpr bool is_varint = true;
+
+    template< typename T >
+    static constexpr unsigned width = 10;
+
+    template< typename T >
+    static std::uint64_t to_bits( T x )
+    {
+        static_assert( std::is_integral_v<T>, "varint_payload requires an integral type" );
+
+        if constexpr ( std::is_signed_v<T> )
+        {
+            std::uint64_t const u = static_cast<std::uint64_t>( static_cast<std::int64_t>( x ) );
+            return ( u << 1 ) ^ ( std::int64_t( x ) < 0 ? ~std::uint64_t( 0 ) : 0 );
+        }
+        else
+        {
+            return static_cast<std::uint64_t>( x );
+        }
+    }
+
+    template< typename T >
+    static T from_bits( std::uint64_t u )
+    {
+        if constexpr ( std::is_signed_v<T> )
+            return static_cast<T>( static_cast<std::int64_t>( ( u >> 1 ) ^ ( ~( u & 1 ) + 1 ) ) );
+        else
+            return static_cast<T>( u );
+    }
+};
+
+// fixed_payload: arithmetic values of up to 8 bytes as their little-endian representation:
+
+struct fixed_payload
+{
+    static constexpr bool is_varint = false;
+
+    template< typename T >
+    static constexpr unsigned width = sizeof( T );
+
+    template< typename T >
+    static std::uint64_t to_bits( T x )
+    {
+        static_assert( std::is_arithmetic_v<T> && sizeof( T ) <= 8, "fixed_payload requires an arithmetic type of at most 8 bytes" );
+
+        if constexpr ( std::is_same_v<T, bool> )
+        {
+            return x ? 1 : 0;
+        }
+        else
+        {
+            std::uint64_t u = 0;
+            unsigned char bytes[ sizeof( T ) ];
+            std::memcpy( bytes, &x, sizeof( T ) );
+
+            for ( std::size_t k = 0; k != sizeof( T ); ++k )
+                u |= std::uint64_t( bytes[ is_little() ? k : sizeof( T ) - 1 - k ] ) << ( 8 * k );
+            return u;
+        }
+    }
+
+    template< typename T >
+    static T from_bits( std::uint64_t u )
+    {
+        if constexpr ( std::is_same_v<T, bool> )
+        {
+            return u != 0;
+        }
+        else
+        {
+            unsigned char bytes[ sizeof( T ) ];
+
+            for ( std::size_t k = 0; k != sizeof( T ); ++k )
+                bytes[ is_little() ? k : sizeof( T ) - 1 - k ] = static_cast<unsigned char>( u >> ( 8 * k ) );
+
+            T x;
+            std::memcpy( &x, bytes, sizeof( T ) );
+            return x;
+        }
+    }
+
+private:
+    static bool is_little()
+    {
+        std::uint16_t const one = 1;
+        unsigned char first;
+        std::memcpy( &first, &one, 1 );
+        return first == 1;
+    }
+};
+
+// varint for integral types except bool, fixed width otherwise:
+
+template< typename T >
+using default_payload = std::conditional_t< std::is_integral_v<T> && ! std::is_same_v<T, bool>, varint_payload, fixed_payload >;
+
+// optional_encoder<T>: push optionals, finish() when done; the sink receives the encoded
+// bytes a buffer at a time and must outlive the encoder:
+
+template< typename T, typename Payload = default_payload<T> >
+class optional_encoder
+{
+public:
+    using sink_type = function_ref< void( std::uint8_t const *, std::size_t ) >;
+
+    // longest run of present values kept before it is written:
+
+    static constexpr std::size_t max_run = 128;
+
+    explicit optional_encoder( sink_type sink, std::size_t buffer_size = 4096 )
+    : sink_( sink ), buffer_( buffer_size < 64 ? 64 : buffer_size ) {}
+
+    void push( optional<T> const & o )
+    {
+        if ( has_value( o ) )
+        {
+            if ( empty_ != 0 )
+            {
+                put_header( empty_, false );
+                empty_ = 0;
+            }
+
+            run_[ present_++ ] = *o;
+
+            if ( present_ == max_run )
+            {
+                put_run();
+            }
+        }
+        else
+        {
+            if ( present_ != 0 )
+            {
+                put_run();
+            }
+            ++empty_;
+        }
+    }
+
+    template< typename R >
+    void push_range( R const & r )
+    {
+        for ( auto const & o : r )
+        {
+            push( o );
+        }
+    }
+
+    // write the pending run and hand the buffer to the sink:
+
+    void finish()
+    {
+        if ( present_ != 0 )
+        {
+            put_run();
+        }
+        if ( empty_ != 0 )
+        {
+            put_header( empty_, false );
+            empty_ = 0;
+        }
+        flush();
+    }
+
+private:
+    void flush()
+    {
+        if ( size_ != 0 )
+        {
+            sink_( buffer_.data(), size_ );
+            size_ = 0;
+        }
+    }
+
+    // make room for a token of at most 10 bytes:
+
+    void reserve_token()
+    {
+        if ( size_ + 10 > buffer_.size() )
+        {
+            flush();
+        }
+    }
+
+    void put_varint( std::uint64_t u )
+    {
+        reserve_token();
+
+        std::uint8_t * p = buffer_.data() + size_;
+
+        while ( u >= 0x80 )
+        {
+            *p++ = static_cast<std::uint8_t>( u | 0x80 );
+            u >>= 7;
+        }
+        *p++ = static_cast<std::uint8_t>( u );
+
+        size_ = static_cast<std::size_t>( p - buffer_.data() );
+    }
+
+    void put_fixed( std::uint64_t u )
+    {
+        reserve_token();
+
+        for ( unsigned k = 0; k != Payload::template width<T>; ++k )
+        {
+            buffer_[ size_++ ] = static_cast<std::uint8_t>( u >> ( 8 * k ) );
+        }
+    }
+
+    void put_header( std::uint64_t length, bool present )
+    {
+        put_varint( ( length << 1 ) | ( present ? 1u : 0u ) );
+    }
+
+    void put_run()
+    {
+        put_header( present_, true );
+
+        for ( std::size_t i = 0; i != present_; ++i )
+        {
+            if constexpr ( Payload::is_varint )
+                put_varint( Payload::to_bits( run_[i] ) );
+            else
+                put_fixed( Payload::to_bits( run_[i] ) );
+        }
+        present_ = 0;
+    }
+
+    sink_type                 sink_;
+    std::vector<std::uint8_t> buffer_;
+    std::size_t               size_ = 0;
+    T                         run_[ max_run ] = {};
+    std::size_t               present_ = 0;
+    std::uint64_t             empty_   = 0;
+};
+
+// optional_decoder<T>: feed(data, size, out) decodes a buffer and calls out(optional<T>)
+// per element; a token may span buffers. feed() yields false on malformed input, and on
+// a run that would take the number of elements beyond max_elements:
+
+template< typename T, typename Payload = default_payload<T> >
+class optional_decoder
+{
+public:
+    using value_type = optional<T>;
+
+    static constexpr std::uint64_t unlimited = ~std::uint64_t( 0 );
+
+    explicit optional_decoder( std::uint64_t max_elements = unlimited )
+    : max_elements_( max_elements ) {}
+
+    template< typename Out >
+    bool feed( std::uint8_t const * data, std::size_t size, Out && out )
+    {
+        for ( std::size_t i = 0; i != size; ++i )
+        {
+            std::uint8_t const b = data[i];
+
+            if ( in_header_ || Payload::is_varint )
+            {
+                if ( shift_ >= 64 || ( shift_ == 63 && b > 1 ) )
+                {
+                    return false;
+                }
+
+                acc_ |= std::uint64_t( b & 0x7f ) << shift_;
+                shift_ += 7;
+
+                if ( b & 0x80 )
+                {
+                    continue;
+                }
+            }
+            else
+            {
+                acc_ |= std::uint64_t( b ) << shift_;
+                shift_ += 8;
+
+                if ( shift_ < 8 * Payload::template width<T> )
+                {
+                    continue;
+                }
+            }
+
+            std::uint64_t const token = acc_;
+            acc_   = 0;
+            shift_ = 0;
+
+            if ( in_header_ )
+            {
+                remaining_ = token >> 1;
+
+                if ( remaining_ > max_elements_ - elements_ )
+                {
+                    return false;
+                }
+                elements_ += remaining_;
+
+                if ( token & 1 )
+                {
+                    in_header_ = remaining_ == 0;
+                }
+                else
+                {
+                    for ( ; remaining_ != 0; --remaining_ )
+                        out( optional<T>() );
+                }
+            }
+            else
+            {
+                out( optional<T>( Payload::template from_bits<T>( token ) ) );
+                in_header_ = --remaining_ == 0;
+            }
+        }
+        return true;
+    }
+
+    // true if the input fed so far ends at a run boundary:
+
+    bool done() const
+    {
+        return in_header_ && shift_ == 0;
+    }
+
+private:
+    std::uint64_t acc_       = 0;
+    unsigned      shift_     = 0;
+    std::uint64_t remaining_ = 0;
+    std::uint64_t elements_  = 0;
+    std::uint64_t max_elements_;
+    bool          in_header_ = true;
+};
+
+// piped_decoder: decoder whose consumer receives each decoded optional after stage:
+
+template< typename Decoder, typename Stage >
+class piped_decoder
+{
+public:
+    piped_decoder( Decoder decoder, Stage stage )
+    : decoder_( std::move( decoder ) ), stage_( std::move( stage ) ) {}
+
+    template< typename Out >
+    bool feed( std::uint8_t const * data, std::size_t size, Out && out )
+    {
+        return decoder_.feed( data, size, [&]( auto const & o ) { out( o | stage_ ); } );
+    }
+
+    bool done() const { return decoder_.done(); }
+
+    template< typename S, typename = std::enable_if_t< detail::is_stage<S>::value > >
+    friend auto operator|( piped_decoder p, S const & s )
+    {
+        auto stage = p.stage_ | s;
+        return piped_decoder< Decoder, decltype( stage ) >( std::move( p.decoder_ ), std::move( stage ) );
+    }
+
+private:
+    Decoder decoder_;
+    Stage   stage_;
+};
+
+// decoder | stage: decode into stage:
+
+template< typename T, typename P, typename S, typename = std::enable_if_t< detail::is_stage<S>::value > >
+piped_decoder< optional_decoder<T, P>, S > operator|( optional_decoder<T, P> d, S const & s )
+{
+    return piped_decoder< optional_decoder<T, P>, S >( std::move( d ), s );
+}
+
+// encode_optionals(r): encoding of a range of optionals:
+
+template< typename Payload = void, typename R >
+std::vector<std::uint8_t> encode_optionals( R const & r )
+{
+    using T = detail::range_value_t<R>;
+    using P = std::conditional_t< std::is_void_v<Payload>, default_payload<T>, Payload >;
+
+    std::vector<std::uint8_t> result;
+
+    auto sink = [&]( std::uint8_t const * data, std::size_t size ) { result.insert( result.end(), data, data + size ); };
+
+    optional_encoder<T, P> encoder( sink );
+    encoder.push_range( r );
+    encoder.finish();
+
+    return result;
+}
+
+// decode_optionals<T>(data, size, max_elements): optionals of an encoding, nullopt if it is
+// malformed or incomplete, or holds more than max_elements of them:
+
+template< typename T, typename Payload = default_payload<T> >
+optional< std::vector< optional<T> > > decode_optionals( std::uint8_t const * data, std::size_t size
+    , std::uint64_t max_elements = optional_decoder<T, Payload>::unlimited )
+{
+    std::vector< optional<T> > result;
+    optional_decoder<T, Payload> decoder( max_elements );
+
+    if ( ! decoder.feed( data, size, [&]( optional<T> const & o ) { result.push_back( o ); } ) || ! decoder.done() )
+    {
+        return nullopt;
+    }
+    return result;
+}
+
+}} // namespace nonstd::optfun_lite
+
+//
+// make the codec available in namespace nonstd:
+//
+
+namespace nonstd {
+
+using optfun_lite::varint_payload;
+using optfun_lite::fixed_payload;
+using optfun_lite::optional_encoder;
+using optfun_lite::optional_decoder;
+using optfun_lite::piped_decoder;
+using optfun_lite::encode_optionals;
+using optfun_lite::decode_optionals;
+
+} // namespace nonstd
+
+#endif // optfun_CPP17_OR_GREATER
+
+#endif // NONSTD_OPTIONAL_FUN_CODEC_LITE_HPP
+
+// end of file
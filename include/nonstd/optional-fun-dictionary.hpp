@@ -0,0 +1,381 @@
+//
+// Copyright (c) 2017 Martin Moene
+//
+// https://github.com/martinmoene/optional-fun-lite
+//
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+// optional-fun-dictionary: dictionary-encoded column of optional strings.
+
+#pragma once
+
+#ifndef NONSTD_OPTIONAL_FUN_DICTIONARY_LITE_HPP
+#define NONSTD_OPTIONAL_FUN_DICTIONARY_LITE_HPP
+
+#include "optional-fun.hpp"
+
+#if optfun_CPP17_OR_GREATER
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+//
+// Dictionary column:
+// - dictionary_column: a column of optional strings as a 32-bit code per row that indexes
+//   a dictionary of the distinct strings, interned in an arena; code empty_code is reserved
+//   for an empty element,
+// - c[i] and iteration yield optional<std::string_view> into the arena,
+// - c | map(f) and c | and_then(f) invoke f once per dictionary entry, not once per row,
+//   and scatter its results to the rows: a result of std::string or std::string_view
+//   yields a dictionary_column, any other a std::vector<optional<U>>.
+//
+
+namespace nonstd { namespace optfun_lite {
+
+namespace detail {
+
+// strings in blocks that never move, so that views of them stay valid:
+
+class string_arena
+{
+public:
+    static constexpr std::size_t block_size = 64 * 1024;
+
+    string_arena() = default;
+
+    // the blocks move, and the source no longer points into them:
+
+    string_arena( string_arena && other ) noexcept
+    : blocks_( std::move( other.blocks_ ) )
+    , next_( std::exchange( other.next_, nullptr ) )
+    , available_( std::exchange( other.available_, 0 ) )
+    , bytes_( std::exchange( other.bytes_, 0 ) ) {}
+
+    string_arena & operator=( string_arena && other ) noexcept
+    {
+        if ( this != &other )
+        {
+            blocks_    = std::move( other.blocks_ );
+            next_      = std::exchange( other.next_, nullptr );
+            available_ = std::exchange( other.available_, 0 );
+            bytes_     = std::exchange( other.bytes_, 0 );
+            other.blocks_.clear();
+        }
+        return *this;
+    }
+
+    std::string_view store( std::string_view s )
+    {
+        if ( s.size() > available_ )
+        {
+            std::size_t const size = (std::max)( block_size, s.size() );
+
+            blocks_.push_back( std::make_unique<char[]>( size ) );
+            next_      = blocks_.back().get();
+            available_ = size;
+            bytes_    += size;
+        }
+
+        if ( ! s.empty() )
+        {
+            std::memcpy( next_, s.data(), s.size() );
+        }
+
+        std::string_view const result( next_, s.size() );
+        next_      += s.size();
+        available_ -= s.size();
+        return result;
+    }
+
+    std::size_t memory_bytes() const { return bytes_; }
+
+private:
+    std::vector< std::unique_ptr<char[]> > blocks_;
+    char *      next_      = nullptr;
+    std::size_t available_ = 0;
+    std::size_t bytes_     = 0;
+};
+
+} // namespace detail
+
+class dictionary_column
+{
+public:
+    using value_type = optional<std::string_view>;
+    using code_type  = std::uint32_t;
+
+    static constexpr code_type empty_code = 0xffffffffu;
+
+    // iteration yields optional<std::string_view>:
+
+    class const_iterator
+    {
+    public:
+        using iterator_category = std::random_access_iterator_tag;
+        using value_type        = optional<std::string_view>;
+        using difference_type   = std::ptrdiff_t;
+        using pointer           = void;
+        using reference         = optional<std::string_view>;
+
+        const_iterator() = default;
+
+        const_iterator( dictionary_column const * c, std::size_t pos )
+        : c_( c ), pos_( pos ) {}
+
+        reference operator*() const { return ( *c_ )[ pos_ ]; }
+        reference operator[]( difference_type n ) const { return ( *c_ )[ pos_ + static_cast<std::size_t>( n ) ]; }
+
+        const_iterator & operator++() { ++pos_; return *this; }
+        const_iterator & operator--() { --pos_; return *this; }
+        const_iterator   operator++( int ) { const_iterator result( *this ); ++pos_; return result; }
+        const_iterator   operator--( int ) { const_iterator result( *this ); --pos_; return result; }
+
+        const_iterator & operator+=( difference_type n ) { pos_ += static_cast<std::size_t>( n ); return *this; }
+        const_iterator & operator-=( difference_type n ) { pos_ -= static_cast<std::size_t>( n ); return *this; }
+
+        friend const_iterator  operator+( const_iterator it, difference_type n ) { return it += n; }
+        friend const_iterator  operator+( difference_type n, const_iterator it ) { return it += n; }
+        friend const_iterator  operator-( const_iterator it, difference_type n ) { return it -= n; }
+        friend difference_type operator-( const_iterator a, const_iterator b ) { return static_cast<difference_type>( a.pos_ - b.pos_ ); }
+
+        friend bool operator==( const_iterator a, const_iterator b ) { return a.pos_ == b.pos_; }
+        friend bool operator!=( const_iterator a, const_iterator b ) { return a.pos_ != b.pos_; }
+        friend bool operator< ( const_iterator a, const_iterator b ) { return a.pos_ <  b.pos_; }
+        friend bool operator> ( const_iterator a, const_iterator b ) { return a.pos_ >  b.pos_; }
+        friend bool operator<=( const_iterator a, const_iterator b ) { return a.pos_ <= b.pos_; }
+        friend bool operator>=( const_iterator a, const_iterator b ) { return a.pos_ >= b.pos_; }
+
+    private:
+        dictionary_column const * c_ = nullptr;
+        std::size_t pos_ = 0;
+    };
+
+    dictionary_column() = default;
+
+    // the arena moves with the column, the views into it stay valid; a copy would not share it;
+    // a moved-from column is empty and may be reused:
+
+    dictionary_column( dictionary_column && other )
+    : arena_( std::move( other.arena_ ) )
+    , entries_( std::move( other.entries_ ) )
+    , index_( std::move( other.index_ ) )
+    , codes_( std::move( other.codes_ ) )
+    {
+        other.clear_moved();
+    }
+
+    dictionary_column & operator=( dictionary_column && other )
+    {
+        if ( this != &other )
+        {
+            arena_   = std::move( other.arena_ );
+            entries_ = std::move( other.entries_ );
+            index_   = std::move( other.index_ );
+            codes_   = std::move( other.codes_ );
+            other.clear_moved();
+        }
+        return *this;
+    }
+
+    // from a range of optional strings, like std::vector< optional<std::string> >:
+
+    template< typename R
+        , typename = std::enable_if_t< ! std::is_same_v< std::decay_t<R>, dictionary_column > >
+    >
+    explicit dictionary_column( R const & r )
+    {
+        for ( auto const & o : r )
+        {
+            if ( has_value( o ) )
+                push_back( std::string_view( *o ) );
+            else
+                push_back( nullopt );
+        }
+    }
+
+    void push_back( optional<std::string_view> const & o )
+    {
+        codes_.push_back( o.has_value() ? intern( *o ) : empty_code );
+    }
+
+    void push_code( code_type code )
+    {
+        assert( code == empty_code || code < entries_.size() );
+        codes_.push_back( code );
+    }
+
+    // code of s in the dictionary, adding it if new:
+
+    code_type intern( std::string_view s )
+    {
+        auto const pos = index_.find( s );
+
+        if ( pos != index_.end() )
+        {
+            return pos->second;
+        }
+
+        assert( entries_.size() < empty_code );
+
+        code_type const code = static_cast<code_type>( entries_.size() );
+        std::string_view const stored = arena_.store( s );
+
+        entries_.push_back( stored );
+        index_.emplace( stored, code );
+        return code;
+    }
+
+    std::size_t size()  const { return codes_.size(); }
+    bool        empty() const { return codes_.empty(); }
+
+    optional<std::string_view> operator[]( std::size_t i ) const
+    {
+        code_type const code = codes_[i];
+        return code != empty_code ? optional<std::string_view>( entries_[ code ] ) : optional<std::string_view>();
+    }
+
+    const_iterator begin() const { return const_iterator( this, 0 ); }
+    const_iterator end()   const { return const_iterator( this, size() ); }
+
+    // distinct strings, entry k for code k, and the code per row:
+
+    std::vector<std::string_view> const & dictionary() const { return entries_; }
+    std::vector<code_type>        const & codes()      const { return codes_;   }
+
+    // bytes of codes, dictionary and arena, not counting the hash index:
+
+    std::size_t memory_bytes() const
+    {
+        return sizeof( code_type ) * codes_.size() + sizeof( std::string_view ) * entries_.size() + arena_.memory_bytes();
+    }
+
+private:
+    // the containers of a moved-from column are valid, but not necessarily empty:
+
+    void clear_moved()
+    {
+        entries_.clear();
+        index_.clear();
+        codes_.clear();
+    }
+
+    detail::string_arena                                    arena_;
+    std::vector<std::string_view>                           entries_;
+    std::unordered_map< std::string_view, code_type >       index_;
+    std::vector<code_type>                                  codes_;
+};
+
+namespace detail {
+
+template< typename U >
+constexpr bool is_string_result_v = std::is_same_v<U, std::string> || std::is_same_v<U, std::string_view>;
+
+// rows of c via table, an optional<U> per dictionary entry:
+
+template< typename U >
+auto dictionary_scatter( dictionary_column const & c, std::vector< optional<U> > const & table )
+{
+    if constexpr ( is_string_result_v<U> )
+    {
+        // intern the results, remapping the codes:
+
+        dictionary_column result;
+        std::vector<dictionary_column::code_type> remap( table.size() );
+
+        for ( std::size_t k = 0; k != table.size(); ++k )
+        {
+            remap[k] = table[k].has_value() ? result.intern( *table[k] ) : dictionary_column::empty_code;
+        }
+
+        for ( dictionary_column::code_type const code : c.codes() )
+        {
+            result.push_code( code != dictionary_column::empty_code ? remap[ code ] : dictionary_column::empty_code );
+        }
+        return result;
+    }
+    else
+    {
+        // without a branch per row: code + 1 wraps empty_code to the empty entry 0:
+
+        std::vector< optional<U> > shifted;
+        shifted.reserve( table.size() + 1 );
+        shifted.emplace_back();
+        shifted.insert( shifted.end(), table.begin(), table.end() );
+
+        std::vector< optional<U> > result;
+        result.reserve( c.size() );
+
+        for ( dictionary_column::code_type const code : c.codes() )
+        {
+            result.push_back( shifted[ static_cast<dictionary_column::code_type>( code + 1u ) ] );
+        }
+        return result;
+    }
+}
+
+} // namespace detail
+
+// c | map(f): f once per dictionary entry, scattered to the rows:
+
+template< typename F, typename H >
+auto operator|( dictionary_column const & c, map<F,H> const & m )
+{
+    using U = std::decay_t< detail::invoke_result_t< F, std::string_view > >;
+
+    std::vector< optional<U> > table;
+    table.reserve( c.dictionary().size() );
+
+    for ( std::string_view const s : c.dictionary() )
+    {
+        table.emplace_back( detail::invoke( m.f, s ) );
+    }
+    return detail::dictionary_scatter( c, table );
+}
+
+// c | and_then(f): f once per dictionary entry, scattered to the rows:
+
+template< typename F, typename H >
+auto operator|( dictionary_column const & c, and_then<F,H> const & a )
+{
+    using U = detail::optional_value_t< std::decay_t< detail::invoke_result_t< F, std::string_view > > >;
+
+    std::vector< optional<U> > table;
+    table.reserve( c.dictionary().size() );
+
+    for ( std::string_view const s : c.dictionary() )
+    {
+        auto r = detail::invoke( a.f, s );
+        table.push_back( has_value( r ) ? optional<U>( *std::move( r ) ) : optional<U>() );
+    }
+    return detail::dictionary_scatter( c, table );
+}
+
+}} // namespace nonstd::optfun_lite
+
+//
+// make dictionary column available in namespace nonstd:
+//
+
+namespace nonstd {
+
+using optfun_lite::dictionary_column;
+
+} // namespace nonstd
+
+#endif // optfun_CPP17_OR_GREATER
+
+#endif // NONSTD_OPTIONAL_FUN_DICTIONARY_LITE_HPP
+
+// end of file
@@ -0,0 +1,352 @@
+//
+// Copyright (c) 2017 Martin Moene
+//
+// https://github.com/martinmoene/optional-fun-lite
+//
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+// optional-fun-fields: record of optional fields that share one presence mask.
+
+#pragma once
+
+#ifndef NONSTD_OPTIONAL_FUN_FIELDS_LITE_HPP
+#define NONSTD_OPTIONAL_FUN_FIELDS_LITE_HPP
+
+#include "optional-fun.hpp"
+
+#if optfun_CPP17_OR_GREATER
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+//
+// Optional fields:
+// - optional_fields<Ts...>: up to 64 optional fields, their values in uninitialized storage,
+//   ordered by decreasing alignment without padding, their presence in the bits of one unsigned
+//   integer, instead of a flag and padding per field as with optional<T> members,
+// - field<I>() yields an optional_ref to field I for the adaptors, like `r.field<2>() | map(f)`,
+// - mask<Is...> is the presence mask of fields Is, and all_of(m) checks that all fields of
+//   mask m are present with a single compare, like `r.all_of( r.mask<0, 3, 7> )`,
+// - only present fields are constructed, copied and destroyed; a record of trivially copyable
+//   fields is trivially copyable.
+//
+
+namespace nonstd { namespace optfun_lite {
+
+namespace detail {
+
+// smallest unsigned integer with at least N bits:
+
+template< std::size_t N >
+using presence_t =
+    std::conditional_t< N <=  8, std::uint8_t,
+    std::conditional_t< N <= 16, std::uint16_t,
+    std::conditional_t< N <= 32, std::uint32_t, std::uint64_t > > >;
+
+// fields stored by decreasing alignment, in field order for equal alignment, so that
+// there is no padding between them; offset[I] is the position of field I in the storage:
+
+template< typename... Ts >
+struct field_layout
+{
+    static constexpr std::size_t N = sizeof...( Ts );
+
+    static constexpr std::size_t size = ( sizeof( Ts ) + ... );
+
+    static constexpr std::array< std::size_t, N > offset = []
+    {
+        std::size_t const align[] = { alignof( Ts )... };
+        std::size_t const bytes[] = { sizeof( Ts )... };
+        std::array< std::size_t, N > result{};
+
+        for ( std::size_t i = 0; i != N; ++i )
+        {
+            for ( std::size_t j = 0; j != N; ++j )
+            {
+                if ( align[j] > align[i] || ( align[j] == align[i] && j < i ) )
+                {
+                    result[i] += bytes[j];
+                }
+            }
+        }
+        return result;
+    }();
+};
+
+// values and presence of the fields:
+
+template< typename... Ts >
+class fields_data
+{
+public:
+    using mask_type = presence_t< sizeof...( Ts ) >;
+
+    template< std::size_t I >
+    using field_type = std::tuple_element_t< I, std::tuple<Ts...> >;
+
+    static constexpr bool nothrow_move = ( std::is_nothrow_move_constructible_v<Ts> && ... );
+
+protected:
+    template< std::size_t I >
+    bool has() const
+    {
+        return ( presence_ >> I ) & 1u;
+    }
+
+    template< std::size_t I >
+    void * address()
+    {
+        return storage_ + field_layout<Ts...>::offset[I];
+    }
+
+    template< std::size_t I >
+    void const * address() const
+    {
+        return storage_ + field_layout<Ts...>::offset[I];
+    }
+
+    template< std::size_t I >
+    field_type<I> & value()
+    {
+        return *std::launder( static_cast<field_type<I> *>( address<I>() ) );
+    }
+
+    template< std::size_t I >
+    field_type<I> const & value() const
+    {
+        return *std::launder( static_cast<field_type<I> const *>( address<I>() ) );
+    }
+
+    template< std::size_t I, typename... Args >
+    field_type<I> & construct( Args &&... args )
+    {
+        field_type<I> * p = ::new( address<I>() ) field_type<I>( std::forward<Args>( args )... );
+        presence_ = static_cast<mask_type>( presence_ | ( mask_type( 1 ) << I ) );
+        return *p;
+    }
+
+    template< std::size_t I >
+    void destroy()
+    {
+        if ( has<I>() )
+        {
+            value<I>().~field_type<I>();
+            presence_ = static_cast<mask_type>( presence_ & ~( mask_type( 1 ) << I ) );
+        }
+    }
+
+    template< std::size_t... Is >
+    void copy_from( fields_data const & other, std::index_sequence<Is...> )
+    {
+        ( ( other.template has<Is>() ? void( construct<Is>( other.template value<Is>() ) ) : void() ), ... );
+    }
+
+    template< std::size_t... Is >
+    void move_from( fields_data & other, std::index_sequence<Is...> )
+    {
+        ( ( other.template has<Is>() ? void( construct<Is>( std::move( other.template value<Is>() ) ) ) : void() ), ... );
+    }
+
+    template< std::size_t... Is >
+    void clear( std::index_sequence<Is...> )
+    {
+        ( destroy<Is>(), ... );
+    }
+
+    alignas( Ts... ) unsigned char storage_[ field_layout<Ts...>::size ];
+    mask_type                     presence_ = 0;
+};
+
+// copy and destruction of a record of trivially copyable fields is that of its bytes,
+// otherwise that of its present fields; if a field's copy or move throws, the fields
+// built before it are destroyed, leaving the record empty:
+
+template< bool Trivial, typename... Ts >
+class fields_copy : public fields_data<Ts...> {};
+
+template< typename... Ts >
+class fields_copy< false, Ts... > : public fields_data<Ts...>
+{
+    using data = fields_data<Ts...>;
+    using all  = std::index_sequence_for<Ts...>;
+
+public:
+    fields_copy() = default;
+
+    fields_copy( fields_copy const & other )
+    {
+        build( [&] { this->copy_from( other, all() ); } );
+    }
+
+    fields_copy( fields_copy && other ) noexcept( data::nothrow_move )
+    {
+        build( [&] { this->move_from( other, all() ); } );
+    }
+
+    fields_copy & operator=( fields_copy const & other )
+    {
+        if ( this != &other )
+        {
+            this->clear( all() );
+            build( [&] { this->copy_from( other, all() ); } );
+        }
+        return *this;
+    }
+
+    fields_copy & operator=( fields_copy && other ) noexcept( data::nothrow_move )
+    {
+        if ( this != &other )
+        {
+            this->clear( all() );
+            build( [&] { this->move_from( other, all() ); } );
+        }
+        return *this;
+    }
+
+    ~fields_copy()
+    {
+        this->clear( all() );
+    }
+
+private:
+    // a throwing constructor leaves no destructor to run, so clear the fields built so far:
+
+    template< typename Fill >
+    void build( Fill fill )
+    {
+        try
+        {
+            fill();
+        }
+        catch ( ... )
+        {
+            this->clear( all() );
+            throw;
+        }
+    }
+};
+
+} // namespace detail
+
+template< typename... Ts >
+class optional_fields : public detail::fields_copy< ( std::is_trivially_copyable_v<Ts> && ... ), Ts... >
+{
+    static_assert( sizeof...( Ts ) > 0 && sizeof...( Ts ) <= 64, "optional_fields supports 1 to 64 fields" );
+
+    using all = std::index_sequence_for<Ts...>;
+
+public:
+    using mask_type = detail::presence_t< sizeof...( Ts ) >;
+
+    template< std::size_t I >
+    using field_type = std::tuple_element_t< I, std::tuple<Ts...> >;
+
+    static constexpr std::size_t size = sizeof...( Ts );
+
+    // presence mask of fields Is:
+
+    template< std::size_t... Is >
+    static constexpr mask_type mask = static_cast<mask_type>( ( mask_type( 0 ) | ... | ( mask_type( 1 ) << Is ) ) );
+
+    // all fields empty:
+
+    optional_fields() = default;
+
+    // each field from an optional, like `optional_fields<int, double> r( 1, nullopt )`:
+
+    explicit optional_fields( optional<Ts> const &... values )
+    {
+        assign( all(), values... );
+    }
+
+    // presence of all fields, bit I for field I:
+
+    mask_type presence() const { return this->presence_; }
+
+    // all, any of the fields of mask m present:
+
+    bool all_of( mask_type m ) const { return ( this->presence_ & m ) == m; }
+    bool any_of( mask_type m ) const { return ( this->presence_ & m ) != 0; }
+
+    template< std::size_t I >
+    bool has_value() const
+    {
+        return this->template has<I>();
+    }
+
+    // field I as an optional reference:
+
+    template< std::size_t I >
+    optional_ref< field_type<I> > field()
+    {
+        return has_value<I>() ? optional_ref< field_type<I> >( this->template value<I>() ) : optional_ref< field_type<I> >();
+    }
+
+    template< std::size_t I >
+    optional_ref< field_type<I> const > field() const
+    {
+        return has_value<I>() ? optional_ref< field_type<I> const >( this->template value<I>() ) : optional_ref< field_type<I> const >();
+    }
+
+    // construct field I in place, replacing its value, if any:
+
+    template< std::size_t I, typename... Args >
+    field_type<I> & emplace( Args &&... args )
+    {
+        this->template destroy<I>();
+        return this->template construct<I>( std::forward<Args>( args )... );
+    }
+
+    template< std::size_t I >
+    void reset()
+    {
+        this->template destroy<I>();
+    }
+
+    friend bool operator==( optional_fields const & a, optional_fields const & b )
+    {
+        return a.presence_ == b.presence_ && a.equal( b, all() );
+    }
+
+    friend bool operator!=( optional_fields const & a, optional_fields const & b )
+    {
+        return !( a == b );
+    }
+
+private:
+    template< std::size_t... Is >
+    void assign( std::index_sequence<Is...>, optional<Ts> const &... values )
+    {
+        ( ( values.has_value() ? void( this->template construct<Is>( *values ) ) : void() ), ... );
+    }
+
+    template< std::size_t... Is >
+    bool equal( optional_fields const & other, std::index_sequence<Is...> ) const
+    {
+        return ( ( ! has_value<Is>() || this->template value<Is>() == other.template value<Is>() ) && ... );
+    }
+};
+
+}} // namespace nonstd::optfun_lite
+
+//
+// make optional fields available in namespace nonstd:
+//
+
+namespace nonstd {
+
+using optfun_lite::optional_fields;
+
+} // namespace nonstd
+
+#endif // optfun_CPP17_OR_GREATER
+
+#endif // NONSTD_OPTIONAL_FUN_FIELDS_LITE_HPP
+
+// end of file
@@ -0,0 +1,575 @@
+//
+// Copyright (c) 2017 Martin Moene
+//
+// https://github.com/martinmoene/optional-fun-lite
+//
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+// optional-fun-mmap: nullable columns in a memory-mappable file, loaded without a copy.
+
+#pragma once
+
+#ifndef NONSTD_OPTIONAL_FUN_MMAP_LITE_HPP
+#define NONSTD_OPTIONAL_FUN_MMAP_LITE_HPP
+
+#include "optional-fun.hpp"
+
+#if optfun_CPP17_OR_GREATER
+
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <system_error>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#if defined(_WIN32)
+# ifndef  NOMINMAX
+#  define NOMINMAX
+# endif
+# ifndef  WIN32_LEAN_AND_MEAN
+#  define WIN32_LEAN_AND_MEAN
+# endif
+# include <windows.h>
+#else
+# include <fcntl.h>
+# include <sys/mman.h>
+# include <sys/stat.h>
+# include <unistd.h>
+#endif
+
+//
+// nullable column file, version 1:
+// - write_column(path, r) writes a range of optionals or a nullable_view to a file,
+//   map_column<T>(path, ec) maps it read-only and yields a mapped_column<T>,
+// - the mapped_column's view() is a nullable_view into the mapping, so loading copies nothing
+//   and pages are read on first access; operator[] and iteration yield optional<T>,
+// - T is an arithmetic type; the file is read on a machine of the writer's byte order only.
+//
+// layout, offsets in bytes, integers in the byte order of the writer:
+//
+//   0  char[8]   magic "OFUNCOL\0"
+//   8  uint32    version, 1
+//  12  uint32    byte order mark, 0x01020304 as written
+//  16  uint32    value kind: 1 signed integer, 2 unsigned integer, 3 floating point, 4 bool
+//  20  uint32    value size, sizeof(T)
+//  24  uint64    size, number of elements n
+//  32  uint64    null count
+//  40  uint64    offset of the value block, a multiple of 64
+//  48  uint64    offset of the validity bitmap, a multiple of 64, or 0 if all values are present
+//  56  uint64    reserved, 0
+//  64            value block: n values, an absent value is value-initialized, padded to 64
+//                validity bitmap: ceil(n/8) bytes, bit i of byte i/8 (LSB first) set if
+//                value i is present, like Arrow's; padded to 64
+//
+
+namespace nonstd { namespace optfun_lite {
+
+// errors of map_column() besides those of the operating system:
+
+enum class column_errc
+{
+    bad_magic = 1,      // not a column file
+    bad_version,        // written by an unsupported version
+    bad_byte_order,     // written on a machine of the other byte order
+    type_mismatch,      // value kind or size differs from T
+    truncated,          // blocks extend beyond the end of the file
+};
+
+namespace detail {
+
+class column_category_t : public std::error_category
+{
+public:
+    char const * name() const noexcept override
+    {
+        return "optional-fun column";
+    }
+
+    std::string message( int ev ) const override
+    {
+        switch ( static_cast<column_errc>( ev ) )
+        {
+            case column_errc::bad_magic:      return "not a column file";
+            case column_errc::bad_version:    return "unsupported column file version";
+            case column_errc::bad_byte_order: return "column file of the other byte order";
+            case column_errc::type_mismatch:  return "column file of another value type";
+            case column_errc::truncated:      return "truncated column file";
+        }
+        return "unknown column file error";
+    }
+};
+
+} // namespace detail
+
+inline std::error_category const & column_category() noexcept
+{
+    static detail::column_category_t const category;
+    return category;
+}
+
+inline std::error_code make_error_code( column_errc e ) noexcept
+{
+    return std::error_code( static_cast<int>( e ), column_category() );
+}
+
+}} // namespace nonstd::optfun_lite
+
+namespace std {
+
+template<>
+struct is_error_code_enum< ::nonstd::optfun_lite::column_errc > : true_type {};
+
+} // namespace std
+
+namespace nonstd { namespace optfun_lite {
+
+namespace detail {
+
+struct column_header
+{
+    char          magic[8];
+    std::uint32_t version;
+    std::uint32_t byte_order;
+    std::uint32_t value_kind;
+    std::uint32_t value_size;
+    std::uint64_t size;
+    std::uint64_t null_count;
+    std::uint64_t values_offset;
+    std::uint64_t validity_offset;
+    std::uint64_t reserved;
+};
+
+static_assert( sizeof( column_header ) == 64, "column file header must be 64 bytes" );
+
+constexpr char          column_magic[8]    = { 'O', 'F', 'U', 'N', 'C', 'O', 'L', '\0' };
+constexpr std::uint32_t column_version     = 1;
+constexpr std::uint32_t column_byte_order  = 0x01020304;
+constexpr std::uint64_t column_block_align = 64;
+
+template< typename T >
+constexpr std::uint32_t column_value_kind()
+{
+    static_assert( std::is_arithmetic_v<T>, "column files hold arithmetic values" );
+
+    if constexpr ( std::is_same_v<T, bool> )
+        return 4;
+    else if constexpr ( std::is_floating_point_v<T> )
+        return 3;
+    else if constexpr ( std::is_signed_v<T> )
+        return 1;
+    else
+        return 2;
+}
+
+constexpr std::uint64_t column_pad( std::uint64_t n )
+{
+    return ( n + column_block_align - 1 ) / column_block_align * column_block_align;
+}
+
+// write n bytes of data, then zeros up to the block boundary after `written + n` bytes:
+
+inline bool write_block( std::FILE * file, void const * data, std::uint64_t n, std::uint64_t written = 0 )
+{
+    static char const zeros[ column_block_align ] = {};
+
+    std::size_t const pad = static_cast<std::size_t>( column_pad( written + n ) - ( written + n ) );
+
+    return ( n == 0 || std::fwrite( data, 1, static_cast<std::size_t>( n ), file ) == n )
+        && ( pad == 0 || std::fwrite( zeros, 1, pad, file ) == pad );
+}
+
+inline std::error_code last_error() noexcept
+{
+#if defined(_WIN32)
+    return std::error_code( static_cast<int>( ::GetLastError() ), std::system_category() );
+#else
+    return std::error_code( errno, std::generic_category() );
+#endif
+}
+
+// error of a failed C library call, like fwrite(), which sets errno, if at all, on every platform;
+// never an empty error_code, which would mean success:
+
+inline std::error_code crt_error() noexcept
+{
+    return errno != 0 ? std::error_code( errno, std::generic_category() ) : std::make_error_code( std::errc::io_error );
+}
+
+// write header, value block and, if a value is absent, the validity bitmap;
+// emit( value, valid ) is called with sinks of the elements' values and presence, in order:
+
+template< typename T, typename Emit >
+std::error_code write_column_file( std::string const & path, std::uint64_t size, std::uint64_t null_count, Emit emit )
+{
+    column_header h = {};
+
+    std::memcpy( h.magic, column_magic, sizeof h.magic );
+    h.version         = column_version;
+    h.byte_order      = column_byte_order;
+    h.value_kind      = column_value_kind<T>();
+    h.value_size      = sizeof( T );
+    h.size            = size;
+    h.null_count      = null_count;
+    h.values_offset   = sizeof h;
+    h.validity_offset = null_count != 0 ? h.values_offset + column_pad( size * sizeof( T ) ) : 0;
+
+    errno = 0;
+
+    std::FILE * const file = std::fopen( path.c_str(), "wb" );
+
+    if ( file == nullptr )
+    {
+        return crt_error();
+    }
+
+    // values are written a chunk at a time, the bitmap after them:
+
+    std::size_t const chunk = 4096;
+
+    std::unique_ptr<T[]>      values( new T[ chunk ] );
+    std::size_t               count = 0;
+    std::vector<std::uint8_t> validity( null_count != 0 ? static_cast<std::size_t>( ( size + 7 ) / 8 ) : 0 );
+
+    bool ok = write_block( file, &h, sizeof h );
+
+    auto const flush = [&]
+    {
+        ok = ok && std::fwrite( values.get(), sizeof( T ), count, file ) == count;
+        count = 0;
+    };
+
+    std::uint64_t i = 0;
+
+    emit(
+        [&]( T const & x )
+        {
+            values[ count++ ] = x;
+            if ( count == chunk )
+                flush();
+        },
+        [&]( bool present )
+        {
+            if ( null_count != 0 )
+                validity[ i / 8 ] = static_cast<std::uint8_t>( validity[ i / 8 ] | ( unsigned( present ) << ( i % 8 ) ) );
+            ++i;
+        }
+    );
+    flush();
+
+    ok = ok && write_block( file, nullptr, 0, size * sizeof( T ) );
+
+    if ( null_count != 0 )
+    {
+        ok = ok && write_block( file, validity.data(), validity.size() );
+    }
+
+    std::error_code ec = ok ? std::error_code() : crt_error();
+
+    if ( std::fclose( file ) != 0 && ! ec )
+    {
+        ec = crt_error();
+    }
+    return ec;
+}
+
+// read-only mapping of a whole file:
+
+class file_mapping
+{
+public:
+    file_mapping() = default;
+
+    file_mapping( std::string const & path, std::error_code & ec ) noexcept
+    {
+#if defined(_WIN32)
+        HANDLE const file = ::CreateFileA( path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr );
+        if ( file == INVALID_HANDLE_VALUE )
+        {
+            ec = last_error();
+            return;
+        }
+
+        LARGE_INTEGER size;
+        if ( ! ::GetFileSizeEx( file, &size ) )
+        {
+            ec = last_error();
+            ::CloseHandle( file );
+            return;
+        }
+
+        HANDLE const mapping = size.QuadPart != 0 ? ::CreateFileMappingA( file, nullptr, PAGE_READONLY, 0, 0, nullptr ) : nullptr;
+        if ( size.QuadPart != 0 && mapping == nullptr )
+        {
+            ec = last_error();
+            ::CloseHandle( file );
+            return;
+        }
+
+        void * const data = mapping != nullptr ? ::MapViewOfFile( mapping, FILE_MAP_READ, 0, 0, 0 ) : nullptr;
+        if ( mapping != nullptr && data == nullptr )
+        {
+            ec = last_error();
+        }
+
+        if ( mapping != nullptr )
+            ::CloseHandle( mapping );
+        ::CloseHandle( file );
+
+        if ( ! ec )
+        {
+            data_ = static_cast<std::byte const *>( data );
+            size_ = static_cast<std::size_t>( size.QuadPart );
+        }
+#else
+        int const fd = ::open( path.c_str(), O_RDONLY );
+        if ( fd < 0 )
+        {
+            ec = last_error();
+            return;
+        }
+
+        struct stat st;
+        if ( ::fstat( fd, &st ) != 0 )
+        {
+            ec = last_error();
+            ::close( fd );
+            return;
+        }
+
+        std::size_t const size = static_cast<std::size_t>( st.st_size );
+        void * const data = size != 0 ? ::mmap( nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0 ) : nullptr;
+
+        if ( data == MAP_FAILED )
+        {
+            ec = last_error();
+        }
+        else
+        {
+            data_ = static_cast<std::byte const *>( data );
+            size_ = size;
+        }
+        ::close( fd );
+#endif
+    }
+
+    file_mapping( file_mapping && other ) noexcept
+    : data_( std::exchange( other.data_, nullptr ) ), size_( std::exchange( other.size_, 0 ) ) {}
+
+    file_mapping & operator=( file_mapping && other ) noexcept
+    {
+        if ( this != &other )
+        {
+            unmap();
+            data_ = std::exchange( other.data_, nullptr );
+            size_ = std::exchange( other.size_, 0 );
+        }
+        return *this;
+    }
+
+    ~file_mapping()
+    {
+        unmap();
+    }
+
+    std::byte const * data() const noexcept { return data_; }
+    std::size_t       size() const noexcept { return size_; }
+
+private:
+    void unmap() noexcept
+    {
+        if ( data_ != nullptr )
+        {
+#if defined(_WIN32)
+            ::UnmapViewOfFile( data_ );
+#else
+            ::munmap( const_cast<std::byte *>( data_ ), size_ );
+#endif
+        }
+    }
+
+    std::byte const * data_ = nullptr;
+    std::size_t       size_ = 0;
+};
+
+} // namespace detail
+
+// mapped_column<T>: nullable column of a column file, mapped read-only:
+// - a random-access range of optional<T>, each read from the mapping,
+// - view() gives the nullable_view for the range stages, like `c.view() | sum_present()`.
+
+template< typename T >
+class mapped_column
+{
+public:
+    using value_type = optional<T>;
+
+    using const_iterator = typename nullable_view<T>::const_iterator;
+    using iterator = const_iterator;
+
+    mapped_column( detail::file_mapping mapping, nullable_view<T> view, std::size_t null_count )
+    : mapping_( std::move( mapping ) ), view_( view ), null_count_( null_count ) {}
+
+    // moving keeps the view valid, the mapping stays in place:
+
+    mapped_column( mapped_column && ) noexcept = default;
+    mapped_column & operator=( mapped_column && ) noexcept = default;
+
+    std::size_t size()       const { return view_.size(); }
+    bool        empty()      const { return view_.size() == 0; }
+    std::size_t null_count() const { return null_count_; }
+
+    optional<T> operator[]( std::size_t i ) const { return view_[i]; }
+
+    const_iterator begin() const { return view_.begin(); }
+    const_iterator end()   const { return view_.end(); }
+
+    nullable_view<T> const & view() const { return view_; }
+
+    // the mapped file:
+
+    void const * file_data() const { return mapping_.data(); }
+    std::size_t  file_size() const { return mapping_.size(); }
+
+private:
+    detail::file_mapping mapping_;
+    nullable_view<T>     view_;
+    std::size_t          null_count_;
+};
+
+// write_column(path, r): write a range of optionals or a nullable_view to a column file:
+
+template< typename R >
+std::error_code write_column( std::string const & path, R const & r )
+{
+    using T = detail::range_value_t<R>;
+
+    std::uint64_t size       = 0;
+    std::uint64_t null_count = 0;
+
+    for ( auto it = std::begin( r ); it != std::end( r ); ++it )
+    {
+        ++size;
+        null_count += ! has_value( *it );
+    }
+    return detail::write_column_file<T>( path, size, null_count, [&]( auto out_value, auto out_valid )
+    {
+        for ( auto it = std::begin( r ); it != std::end( r ); ++it )
+        {
+            out_value( has_value( *it ) ? T( **it ) : T() );
+            out_valid( has_value( *it ) );
+        }
+    });
+}
+
+template< typename T >
+std::error_code write_column( std::string const & path, nullable_view<T> const & v )
+{
+    std::uint64_t null_count = 0;
+
+    for ( std::size_t i = 0; i != v.size(); ++i )
+    {
+        null_count += ! v.valid( i );
+    }
+    return detail::write_column_file<T>( path, v.size(), null_count, [&]( auto out_value, auto out_valid )
+    {
+        for ( std::size_t i = 0; i != v.size(); ++i )
+        {
+            out_value( v.valid( i ) ? v.values()[i] : T() );
+            out_valid( v.valid( i ) );
+        }
+    });
+}
+
+// map_column<T>(path, ec): the column of a column file of T, mapped read-only;
+// nullopt and ec set if the file cannot be mapped or is not a valid column file of T:
+
+template< typename T >
+optional< mapped_column<T> > map_column( std::string const & path, std::error_code & ec )
+{
+    ec.clear();
+
+    detail::file_mapping mapping( path, ec );
+
+    if ( ec )
+    {
+        return nullopt;
+    }
+
+    detail::column_header h;
+
+    if ( mapping.size() < sizeof h )
+    {
+        ec = column_errc::truncated;
+        return nullopt;
+    }
+
+    std::memcpy( &h, mapping.data(), sizeof h );
+
+    if ( std::memcmp( h.magic, detail::column_magic, sizeof h.magic ) != 0 )
+        ec = column_errc::bad_magic;
+    else if ( h.version != detail::column_version )
+        ec = column_errc::bad_version;
+    else if ( h.byte_order != detail::column_byte_order )
+        ec = column_errc::bad_byte_order;
+    else if ( h.value_kind != detail::column_value_kind<T>() || h.value_size != sizeof( T ) )
+        ec = column_errc::type_mismatch;
+
+    if ( ec )
+    {
+        return nullopt;
+    }
+
+    std::uint64_t const file_size = mapping.size();
+
+    bool const values_fit = h.values_offset % detail::column_block_align == 0
+        && h.values_offset <= file_size && h.size <= ( file_size - h.values_offset ) / sizeof( T );
+
+    bool const validity_fits = h.validity_offset == 0
+        || ( h.validity_offset % detail::column_block_align == 0
+            && h.validity_offset <= file_size && ( h.size + 7 ) / 8 <= file_size - h.validity_offset );
+
+    if ( ! values_fit || ! validity_fits || ( h.validity_offset == 0 && h.null_count != 0 ) )
+    {
+        ec = column_errc::truncated;
+        return nullopt;
+    }
+
+    T const * const values = reinterpret_cast<T const *>( mapping.data() + h.values_offset );
+
+    std::uint8_t const * const validity = h.validity_offset != 0
+        ? reinterpret_cast<std::uint8_t const *>( mapping.data() + h.validity_offset ) : nullptr;
+
+    nullable_view<T> const view( values, validity, static_cast<std::size_t>( h.size ) );
+
+    return mapped_column<T>( std::move( mapping ), view, static_cast<std::size_t>( h.null_count ) );
+}
+
+}} // namespace nonstd::optfun_lite
+
+//
+// make column files available in namespace nonstd:
+//
+
+namespace nonstd {
+
+using optfun_lite::column_errc;
+using optfun_lite::column_category;
+using optfun_lite::mapped_column;
+using optfun_lite::write_column;
+using optfun_lite::map_column;
+
+} // namespace nonstd
+
+#endif // optfun_CPP17_OR_GREATER
+
+#endif // NONSTD_OPTIONAL_FUN_MMAP_LITE_HPP
+
+// end of file
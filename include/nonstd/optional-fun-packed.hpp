@@ -0,0 +1,516 @@
+//
+// Copyright (c) 2017 Martin Moene
+//
+// https://github.com/martinmoene/optional-fun-lite
+//
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+// optional-fun-packed: array of optional bools and small enums, packed into
+// a few bits per element.
+
+#pragma once
+
+#ifndef NONSTD_OPTIONAL_FUN_PACKED_LITE_HPP
+#define NONSTD_OPTIONAL_FUN_PACKED_LITE_HPP
+
+#include "optional-fun.hpp"
+
+#if optfun_CPP17_OR_GREATER
+
+#include <array>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <limits>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+//
+// Packed optional array:
+// - packed_optional_array<T, Bits>: optional<T> in a field of Bits bits, 2, 4 or 8, 64 / Bits
+//   fields per 64-bit word; field code 0 is empty, code v + 1 is value v,
+// - T is bool, an enumeration with an unsigned underlying type or an unsigned integral type
+//   whose values are below 2^Bits - 1; Bits defaults to 2 for bool, 4 otherwise; storing
+//   a value that does not fit is asserted against, and in a release build it is masked to
+//   its field, so that it never spills into a neighbouring one,
+// - a[i] yields a proxy reference that converts to and assigns from optional<T> and pipes like
+//   one, `a[i] | map(f)`; a const array yields optional<T>,
+// - a | map(f) and a | and_then(f) evaluate f once per distinct present value, not per
+//   element, and translate a word of fields at a time; a | and_(u) and a | or_(u), with a
+//   value, an optional or another array u of the same size, combine a word of fields at a time.
+//
+
+namespace nonstd { namespace optfun_lite {
+
+namespace detail {
+
+template< typename T, bool = std::is_enum_v<T> >
+struct packed_underlying { using type = T; };
+
+template< typename T >
+struct packed_underlying< T, true > { using type = std::underlying_type_t<T>; };
+
+// an enumeration with a signed underlying type may hold negative values, which never fit:
+
+template< typename T >
+constexpr bool is_packable_v = std::is_unsigned_v< typename packed_underlying<T>::type >;
+
+template< typename T >
+constexpr unsigned packed_default_bits = std::is_same_v<T, bool> ? 2 : 4;
+
+// value as an unsigned number:
+
+template< typename T >
+constexpr std::uint64_t packed_number( T const & x )
+{
+    return static_cast<std::uint64_t>( static_cast< typename packed_underlying<T>::type >( x ) );
+}
+
+// true if optional value has a field code, which all of T's values have if it is narrow enough:
+
+template< typename T, unsigned Bits >
+constexpr bool packed_fits( optional<T> const & o )
+{
+    if constexpr ( std::numeric_limits< typename packed_underlying<T>::type >::digits < Bits )
+        return true;
+    else
+        return ! o.has_value() || packed_number( *o ) < ( std::uint64_t( 1 ) << Bits ) - 1;
+}
+
+// field code of optional value, masked to the field:
+
+template< typename T, unsigned Bits >
+constexpr std::uint64_t packed_code( optional<T> const & o )
+{
+    return o.has_value() ? ( packed_number( *o ) + 1 ) & ( ( std::uint64_t( 1 ) << Bits ) - 1 ) : 0;
+}
+
+template< typename T >
+constexpr optional<T> packed_value( std::uint64_t code )
+{
+    if ( code == 0 )
+    {
+        return nullopt;
+    }
+
+    if constexpr ( std::is_same_v<T, bool> )
+        return code != 1;
+    else if constexpr ( std::is_enum_v<T> )
+        return static_cast<T>( static_cast< std::underlying_type_t<T> >( code - 1 ) );
+    else
+        return static_cast<T>( code - 1 );
+}
+
+// bit 0 of each field, a field of all bits:
+
+template< unsigned Bits > constexpr std::uint64_t packed_low   = ~std::uint64_t( 0 ) / ( ( std::uint64_t( 1 ) << Bits ) - 1 );
+template< unsigned Bits > constexpr std::uint64_t packed_field = ( std::uint64_t( 1 ) << Bits ) - 1;
+
+// all bits of each non-zero field of word x set:
+
+template< unsigned Bits >
+constexpr std::uint64_t packed_nonzero( std::uint64_t x )
+{
+    for ( unsigned s = 1; s < Bits; s *= 2 )
+    {
+        x |= x >> s;
+    }
+    return ( x & packed_low<Bits> ) * packed_field<Bits>;
+}
+
+} // namespace detail
+
+template< typename T, unsigned Bits = detail::packed_default_bits<T> >
+class packed_optional_array
+{
+    static_assert( detail::is_packable_v<T>, "packed_optional_array requires bool, an enumeration with an unsigned underlying type or an unsigned integral type" );
+    static_assert( Bits == 2 || Bits == 4 || Bits == 8, "packed_optional_array requires a field of 2, 4 or 8 bits" );
+
+public:
+    using value_type = optional<T>;
+
+    static constexpr unsigned    bits     = Bits;
+    static constexpr std::size_t per_word = 64 / Bits;
+
+    // proxy reference to element:
+
+    class reference
+    {
+    public:
+        reference( packed_optional_array & a, std::size_t i )
+        : a_( a ), i_( i ) {}
+
+        operator optional<T>() const { return a_.get( i_ ); }
+
+        reference & operator=( optional<T> const & o )  { a_.set( i_, o );          return *this; }
+        reference & operator=( reference const & other ) { a_.set( i_, other.get() ); return *this; }
+
+        optional<T> get()       const { return a_.get( i_ ); }
+        bool        has_value() const { return a_.code( i_ ) != 0; }
+
+        template< typename S, typename = std::enable_if_t< detail::is_stage<S>::value > >
+        friend auto operator|( reference r, S const & s )
+        {
+            return r.get() | s;
+        }
+
+    private:
+        packed_optional_array & a_;
+        std::size_t             i_;
+    };
+
+    // iteration yields optional<T>:
+
+    class const_iterator
+    {
+    public:
+        using iterator_category = std::random_access_iterator_tag;
+        using value_type        = optional<T>;
+        using difference_type   = std::ptrdiff_t;
+        using pointer           = void;
+        using reference         = optional<T>;
+
+        const_iterator() = default;
+
+        const_iterator( packed_optional_array const * a, std::size_t pos )
+        : a_( a ), pos_( pos ) {}
+
+        reference operator*() const { return a_->get( pos_ ); }
+        reference operator[]( difference_type n ) const { return a_->get( pos_ + static_cast<std::size_t>( n ) ); }
+
+        const_iterator & operator++() { ++pos_; return *this; }
+        const_iterator & operator--() { --pos_; return *this; }
+        const_iterator   operator++( int ) { const_iterator result( *this ); ++pos_; return result; }
+        const_iterator   operator--( int ) { const_iterator result( *this ); --pos_; return result; }
+
+        const_iterator & operator+=( difference_type n ) { pos_ += static_cast<std::size_t>( n ); return *this; }
+        const_iterator & operator-=( difference_type n ) { pos_ -= static_cast<std::size_t>( n ); return *this; }
+
+        friend const_iterator  operator+( const_iterator it, difference_type n ) { return it += n; }
+        friend const_iterator  operator+( difference_type n, const_iterator it ) { return it += n; }
+        friend const_iterator  operator-( const_iterator it, difference_type n ) { return it -= n; }
+        friend difference_type operator-( const_iterator a, const_iterator b ) { return static_cast<difference_type>( a.pos_ - b.pos_ ); }
+
+        friend bool operator==( const_iterator a, const_iterator b ) { return a.pos_ == b.pos_; }
+        friend bool operator!=( const_iterator a, const_iterator b ) { return a.pos_ != b.pos_; }
+        friend bool operator< ( const_iterator a, const_iterator b ) { return a.pos_ <  b.pos_; }
+        friend bool operator> ( const_iterator a, const_iterator b ) { return a.pos_ >  b.pos_; }
+        friend bool operator<=( const_iterator a, const_iterator b ) { return a.pos_ <= b.pos_; }
+        friend bool operator>=( const_iterator a, const_iterator b ) { return a.pos_ >= b.pos_; }
+
+    private:
+        packed_optional_array const * a_ = nullptr;
+        std::size_t pos_ = 0;
+    };
+
+    packed_optional_array() = default;
+
+    // n empty elements:
+
+    explicit packed_optional_array( std::size_t n )
+    : words_( ( n + per_word - 1 ) / per_word ), size_( n ) {}
+
+    // from a range of optionals:
+
+    template< typename R
+        , typename = std::enable_if_t< ! std::is_same_v< std::decay_t<R>, packed_optional_array > && ! std::is_integral_v<R> >
+    >
+    explicit packed_optional_array( R const & r )
+    {
+        for ( auto const & o : r )
+        {
+            push_back( has_value( o ) ? optional<T>( *o ) : optional<T>() );
+        }
+    }
+
+    std::size_t size()  const { return size_; }
+    bool        empty() const { return size_ == 0; }
+
+    // number of present elements:
+
+    std::size_t count() const
+    {
+        std::size_t n = 0;
+        for ( std::uint64_t const w : words_ )
+        {
+            n += static_cast<std::size_t>( detail::popcount64( detail::packed_nonzero<Bits>( w ) & detail::packed_low<Bits> ) );
+        }
+        return n;
+    }
+
+    void push_back( optional<T> const & o )
+    {
+        if ( size_ % per_word == 0 )
+        {
+            words_.push_back( 0 );
+        }
+        set( size_++, o );
+    }
+
+    optional<T> operator[]( std::size_t i ) const { return get( i ); }
+    reference   operator[]( std::size_t i )       { return reference( *this, i ); }
+
+    optional<T> get( std::size_t i ) const
+    {
+        return detail::packed_value<T>( code( i ) );
+    }
+
+    void set( std::size_t i, optional<T> const & o )
+    {
+        std::uint64_t & w = words_[ i / per_word ];
+        unsigned const  s = static_cast<unsigned>( i % per_word ) * Bits;
+
+        assert( ( detail::packed_fits<T, Bits>( o ) ) && "packed_optional_array: the value does not fit in a field of Bits bits" );
+
+        w = ( w & ~( detail::packed_field<Bits> << s ) ) | ( detail::packed_code<T, Bits>( o ) << s );
+    }
+
+    const_iterator begin() const { return const_iterator( this, 0 ); }
+    const_iterator end()   const { return const_iterator( this, size_ ); }
+
+    // the fields, per_word per word, unused fields of the last word 0:
+
+    std::vector<std::uint64_t> const & words() const { return words_; }
+
+    // n elements of fields:
+
+    static packed_optional_array from_words( std::vector<std::uint64_t> words, std::size_t n )
+    {
+        packed_optional_array result;
+        result.words_ = std::move( words );
+        result.size_  = n;
+        result.words_.resize( ( n + per_word - 1 ) / per_word );
+        result.trim();
+        return result;
+    }
+
+    friend bool operator==( packed_optional_array const & a, packed_optional_array const & b )
+    {
+        return a.size_ == b.size_ && a.words_ == b.words_;
+    }
+
+    friend bool operator!=( packed_optional_array const & a, packed_optional_array const & b )
+    {
+        return !( a == b );
+    }
+
+private:
+    friend class reference;
+
+    std::uint64_t code( std::size_t i ) const
+    {
+        return ( words_[ i / per_word ] >> ( ( i % per_word ) * Bits ) ) & detail::packed_field<Bits>;
+    }
+
+    // clear the unused fields of the last word:
+
+    void trim()
+    {
+        if ( size_ % per_word != 0 )
+        {
+            words_.back() &= ( std::uint64_t( 1 ) << ( size_ % per_word * Bits ) ) - 1;
+        }
+    }
+
+    std::vector<std::uint64_t> words_;
+    std::size_t                size_ = 0;
+};
+
+template< typename R >
+packed_optional_array( R const & ) -> packed_optional_array< detail::range_value_t<R> >;
+
+namespace detail {
+
+template< typename T >                struct is_packed_optional_array                                : std::false_type {};
+template< typename T, unsigned Bits > struct is_packed_optional_array< packed_optional_array<T, Bits> > : std::true_type {};
+
+// result code for each field code, via f once on each value that occurs;
+// f yields an optional for and_then(), a value for map():
+
+template< typename U, unsigned Bits, typename T, typename F >
+class packed_table
+{
+public:
+    explicit packed_table( F const & f )
+    : f_( f ) {}
+
+    std::uint64_t operator()( std::uint64_t c )
+    {
+        if ( ! known_[c] )
+        {
+            table_[c] = code( *packed_value<T>( c ) );
+            known_[c] = true;
+        }
+        return table_[c];
+    }
+
+private:
+    std::uint64_t code( T const & x ) const
+    {
+        optional<U> result;
+
+        if constexpr ( is_optional_like< std::decay_t< invoke_result_t< F const &, T const & > > >::value )
+        {
+            auto const r = invoke( f_, x );
+            if ( has_value( r ) )
+                result = *r;
+        }
+        else
+        {
+            result = invoke( f_, x );
+        }
+
+        assert( ( packed_fits<U, Bits>( result ) ) && "packed_optional_array: a result of f does not fit in a field of Bits bits" );
+
+        return packed_code<U, Bits>( result );
+    }
+
+    static constexpr std::size_t codes = std::size_t( 1 ) << Bits;
+
+    F const &                          f_;
+    std::array< std::uint64_t, codes > table_{};
+    std::array< bool, codes >          known_{};
+};
+
+// a's fields translated via table: for 2 and 4 bits, the fields of a word
+// equal to each code at once, for 8 bits, field by field:
+
+template< typename U, unsigned Bits, typename T, typename Table >
+packed_optional_array<U, Bits> packed_translate( packed_optional_array<T, Bits> const & a, Table table )
+{
+    std::vector<std::uint64_t> words( a.words().size() );
+
+    for ( std::size_t i = 0; i != words.size(); ++i )
+    {
+        std::uint64_t const w = a.words()[i];
+        std::uint64_t r = 0;
+
+        if constexpr ( Bits < 8 )
+        {
+            for ( std::uint64_t c = 1; c != packed_field<Bits> + 1; ++c )
+            {
+                std::uint64_t const equal = ~packed_nonzero<Bits>( w ^ ( packed_low<Bits> * c ) );
+
+                if ( equal != 0 )
+                {
+                    r |= equal & ( packed_low<Bits> * table( c ) );
+                }
+            }
+        }
+        else
+        {
+            for ( unsigned s = 0; s != 64; s += Bits )
+            {
+                if ( std::uint64_t const c = ( w >> s ) & packed_field<Bits> )
+                {
+                    r |= table( c ) << s;
+                }
+            }
+        }
+        words[i] = r;
+    }
+    return packed_optional_array<U, Bits>::from_words( std::move( words ), a.size() );
+}
+
+// fields of u: those of an array, empty beyond its end, or the code of a value or optional in each field:
+
+template< typename T, unsigned Bits, typename U >
+std::uint64_t packed_operand( U const & u, std::size_t i )
+{
+    if constexpr ( is_packed_optional_array<U>::value )
+    {
+        return i < u.words().size() ? u.words()[i] : 0;
+    }
+    else
+    {
+        assert( ( packed_fits<T, Bits>( optional<T>( u ) ) ) && "packed_optional_array: and_(u), or_(u): u does not fit in a field of Bits bits" );
+        return packed_low<Bits> * packed_code<T, Bits>( optional<T>( u ) );
+    }
+}
+
+// an array operand must have as many elements as a:
+
+template< typename T, unsigned Bits, typename U >
+void packed_check_operand( [[maybe_unused]] packed_optional_array<T, Bits> const & a, [[maybe_unused]] U const & u )
+{
+    if constexpr ( is_packed_optional_array<U>::value )
+    {
+        assert( u.size() == a.size() && "packed_optional_array: and_(u), or_(u): u must have the size of the array" );
+    }
+}
+
+} // namespace detail
+
+// a | map(f): f on each distinct present value, like map() on each element:
+
+template< typename T, unsigned Bits, typename F, typename H >
+auto operator|( packed_optional_array<T, Bits> const & a, map<F,H> const & m )
+{
+    using U = std::decay_t< detail::invoke_result_t< F, T > >;
+
+    return detail::packed_translate<U, Bits>( a, detail::packed_table<U, Bits, T, F>( m.f ) );
+}
+
+// a | and_then(f): f on each distinct present value, like and_then() on each element:
+
+template< typename T, unsigned Bits, typename F, typename H >
+auto operator|( packed_optional_array<T, Bits> const & a, and_then<F,H> const & m )
+{
+    using U = detail::optional_value_t< std::decay_t< detail::invoke_result_t< F, T > > >;
+
+    return detail::packed_translate<U, Bits>( a, detail::packed_table<U, Bits, T, F>( m.f ) );
+}
+
+// a | and_(u): u where a is present, empty elsewhere; u a value, optional or array:
+
+template< typename T, unsigned Bits, typename U, typename H >
+packed_optional_array<T, Bits> operator|( packed_optional_array<T, Bits> const & a, and_<U,H> const & s )
+{
+    detail::packed_check_operand( a, s.u );
+
+    std::vector<std::uint64_t> words( a.words().size() );
+
+    for ( std::size_t i = 0; i != words.size(); ++i )
+    {
+        words[i] = detail::packed_nonzero<Bits>( a.words()[i] ) & detail::packed_operand<T, Bits>( s.u, i );
+    }
+    return packed_optional_array<T, Bits>::from_words( std::move( words ), a.size() );
+}
+
+// a | or_(u): a where present, u elsewhere; u a value, optional or array:
+
+template< typename T, unsigned Bits, typename U, typename H >
+packed_optional_array<T, Bits> operator|( packed_optional_array<T, Bits> const & a, or_<U,H> const & s )
+{
+    detail::packed_check_operand( a, s.u );
+
+    std::vector<std::uint64_t> words( a.words().size() );
+
+    for ( std::size_t i = 0; i != words.size(); ++i )
+    {
+        std::uint64_t const w = a.words()[i];
+        words[i] = w | ( ~detail::packed_nonzero<Bits>( w ) & detail::packed_operand<T, Bits>( s.u, i ) );
+    }
+    return packed_optional_array<T, Bits>::from_words( std::move( words ), a.size() );
+}
+
+}} // namespace nonstd::optfun_lite
+
+//
+// make packed optional array available in namespace nonstd:
+//
+
+namespace nonstd {
+
+using optfun_lite::packed_optional_array;
+
+} // namespace nonstd
+
+#endif // optfun_CPP17_OR_GREATER
+
+#endif // NONSTD_OPTIONAL_FUN_PACKED_LITE_HPP
+
+// end of file
@@ -0,0 +1,354 @@
+//
+// Copyright (c) 2017 Martin Moene
+//
+// https://github.com/martinmoene/optional-fun-lite
+//
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+// optional-fun-parse: parse text fields into optionals, without allocation or exceptions.
+
+#pragma once
+
+#ifndef NONSTD_OPTIONAL_FUN_PARSE_LITE_HPP
+#define NONSTD_OPTIONAL_FUN_PARSE_LITE_HPP
+
+#include "optional-fun.hpp"
+
+#if optfun_CPP17_OR_GREATER
+
+#include <charconv>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <string_view>
+#include <system_error>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#if defined(__cpp_lib_to_chars) || ( defined(_MSC_VER) && _MSC_VER >= 1924 )
+# define optfun_HAVE_FLOAT_FROM_CHARS  1
+#else
+# define optfun_HAVE_FLOAT_FROM_CHARS  0
+# include <cstdlib>
+# include <cstring>
+#endif
+
+//
+// Parse:
+// - parse_value<T>(s): the whole of text s as a T, or nullopt if it is not one;
+//   never allocates, throws or consults the locale,
+// - T is an integer, via std::from_chars, decimal, without a leading '+' or white space,
+// - T is float, double or long double, via std::from_chars, general format, which takes
+//   "inf" and "nan" as well; without floating point std::from_chars, via std::strtold(),
+//   which, unlike std::from_chars, does consult the locale for the decimal separator,
+// - T is bool: "true", "false", "1" or "0",
+// - T is std::chrono::system_clock::time_point: ISO 8601 "YYYY-MM-DD", optionally followed by
+//   'T' or ' ', "hh:mm:ss", a fraction of up to nine digits and "Z" or an offset "+hh:mm", "-hh:mm",
+//   within the range of system_clock::duration, like 1677 to 2262 for 64-bit nanoseconds,
+// - parse<T>(): and_then stage over an optional of text, like `field | parse<int>() | map( f )`,
+// - parse_all<T>(): range stage parsing a column of fields, optional or not, into a
+//   std::vector<optional<T>> at once, like `fields | parse_all<double>()`.
+//
+
+namespace nonstd { namespace optfun_lite {
+
+namespace detail {
+
+// std::from_chars of all of s:
+
+template< typename T >
+optional<T> parse_chars( std::string_view s ) noexcept
+{
+    T value{};
+    char const * const last = s.data() + s.size();
+    auto const result = std::from_chars( s.data(), last, value );
+
+    if ( result.ec != std::errc() || result.ptr != last || s.empty() )
+    {
+        return nullopt;
+    }
+    return value;
+}
+
+#if ! optfun_HAVE_FLOAT_FROM_CHARS
+
+// without floating point std::from_chars: strtold() of a terminated copy on the stack,
+// which does consult the locale for the decimal separator; a leading '+' and hexadecimal
+// "0x", which std::from_chars rejects, are rejected here too:
+
+template< typename T >
+optional<T> parse_chars_strtod( std::string_view s ) noexcept
+{
+    char buffer[64];
+
+    if ( s.empty() || s.size() >= sizeof( buffer ) || s.find_first_of( " \t\n\r\f\v" ) != s.npos )
+    {
+        return nullopt;
+    }
+
+    std::string_view const unsigned_s = s.substr( s[0] == '-' ? 1 : 0 );
+
+    if ( unsigned_s.empty() || unsigned_s[0] == '+' || unsigned_s[0] == '-'
+        || ( unsigned_s.size() > 1 && unsigned_s[0] == '0' && ( unsigned_s[1] == 'x' || unsigned_s[1] == 'X' ) ) )
+    {
+        return nullopt;
+    }
+
+    std::memcpy( buffer, s.data(), s.size() );
+    buffer[ s.size() ] = '\0';
+
+    char * end = nullptr;
+    long double const value = std::strtold( buffer, &end );
+
+    if ( end != buffer + s.size() )
+    {
+        return nullopt;
+    }
+    return static_cast<T>( value );
+}
+
+#endif // optfun_HAVE_FLOAT_FROM_CHARS
+
+// n decimal digits at s[pos], as an unsigned:
+
+inline bool parse_digits( std::string_view s, std::size_t pos, std::size_t n, unsigned & value ) noexcept
+{
+    if ( pos + n > s.size() )
+    {
+        return false;
+    }
+
+    value = 0;
+
+    for ( std::size_t i = pos; i != pos + n; ++i )
+    {
+        unsigned const digit = static_cast<unsigned>( s[i] ) - unsigned( '0' );
+
+        if ( digit > 9 )
+        {
+            return false;
+        }
+        value = 10 * value + digit;
+    }
+    return true;
+}
+
+inline bool is_leap_year( unsigned y ) noexcept
+{
+    return y % 4 == 0 && ( y % 100 != 0 || y % 400 == 0 );
+}
+
+// days since 1970-01-01 of a proleptic Gregorian date, after H. Hinnant's days_from_civil:
+
+inline std::int64_t days_from_civil( std::int64_t y, unsigned m, unsigned d ) noexcept
+{
+    y -= m <= 2;
+
+    std::int64_t const era = ( y >= 0 ? y : y - 399 ) / 400;
+    unsigned     const yoe = static_cast<unsigned>( y - era * 400 );
+    unsigned     const doy = ( 153 * ( m > 2 ? m - 3 : m + 9 ) + 2 ) / 5 + d - 1;
+    unsigned     const doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+
+    return era * 146097 + static_cast<std::int64_t>( doe ) - 719468;
+}
+
+inline optional<std::chrono::system_clock::time_point> parse_timestamp( std::string_view s ) noexcept
+{
+    using namespace std::chrono;
+
+    static unsigned char const month_days[] = { 31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31 };
+
+    unsigned year = 0, month = 0, day = 0, hour = 0, minute = 0, second = 0;
+
+    if ( ! parse_digits( s, 0, 4, year ) || s.size() < 10 || s[4] != '-' || s[7] != '-'
+        || ! parse_digits( s, 5, 2, month ) || ! parse_digits( s, 8, 2, day ) )
+    {
+        return nullopt;
+    }
+
+    if ( month < 1 || month > 12 || day < 1 || day > month_days[ month - 1 ] + unsigned( month == 2 && is_leap_year( year ) ) )
+    {
+        return nullopt;
+    }
+
+    nanoseconds fraction( 0 );
+    seconds     offset( 0 );
+    std::size_t pos = 10;
+
+    if ( pos != s.size() )
+    {
+        if ( ( s[pos] != 'T' && s[pos] != ' ' ) || s.size() < pos + 9 || s[pos + 3] != ':' || s[pos + 6] != ':'
+            || ! parse_digits( s, pos + 1, 2, hour ) || ! parse_digits( s, pos + 4, 2, minute ) || ! parse_digits( s, pos + 7, 2, second )
+            || hour > 23 || minute > 59 || second > 59 )
+        {
+            return nullopt;
+        }
+
+        pos += 9;
+
+        if ( pos != s.size() && s[pos] == '.' )
+        {
+            std::size_t digits = 0;
+            std::int64_t ns = 0;
+
+            for ( ++pos; pos != s.size() && s[pos] >= '0' && s[pos] <= '9'; ++pos, ++digits )
+            {
+                ns = 10 * ns + ( s[pos] - '0' );
+            }
+
+            if ( digits == 0 || digits > 9 )
+            {
+                return nullopt;
+            }
+
+            for ( ; digits != 9; ++digits )
+            {
+                ns *= 10;
+            }
+            fraction = nanoseconds( ns );
+        }
+
+        if ( pos != s.size() && s[pos] == 'Z' )
+        {
+            ++pos;
+        }
+        else if ( pos != s.size() && ( s[pos] == '+' || s[pos] == '-' ) )
+        {
+            unsigned offset_hour = 0, offset_minute = 0;
+
+            if ( s.size() != pos + 6 || s[pos + 3] != ':'
+                || ! parse_digits( s, pos + 1, 2, offset_hour ) || ! parse_digits( s, pos + 4, 2, offset_minute )
+                || offset_hour > 23 || offset_minute > 59 )
+            {
+                return nullopt;
+            }
+
+            offset = hours( offset_hour ) + minutes( offset_minute );
+            offset = s[pos] == '+' ? offset : -offset;
+            pos += 6;
+        }
+
+        if ( pos != s.size() )
+        {
+            return nullopt;
+        }
+    }
+
+    seconds const since_epoch = hours( 24 * days_from_civil( year, month, day ) )
+        + hours( hour ) + minutes( minute ) + seconds( second ) - offset;
+
+    // outside the range of the clock's duration, like 64-bit nanoseconds beyond 1677 to 2262;
+    // the last second before max() is out of range as well, as its fraction may not fit:
+
+    constexpr seconds min_since_epoch = duration_cast<seconds>( system_clock::duration::min() );
+    constexpr seconds max_since_epoch = duration_cast<seconds>( system_clock::duration::max() );
+
+    if ( since_epoch < min_since_epoch || since_epoch >= max_since_epoch )
+    {
+        return nullopt;
+    }
+
+    return system_clock::time_point( duration_cast<system_clock::duration>( since_epoch ) + duration_cast<system_clock::duration>( fraction ) );
+}
+
+template< typename T >
+struct parser
+{
+    static_assert( std::is_integral_v<T> || std::is_floating_point_v<T> || std::is_same_v<T, std::chrono::system_clock::time_point>
+        , "parse<T>: T must be an integer, a floating point type, bool or std::chrono::system_clock::time_point" );
+
+    optfun_force_inline optional<T> operator()( std::string_view s ) const noexcept
+    {
+        if constexpr ( std::is_same_v<T, bool> )
+        {
+            if ( s == "true"  || s == "1" ) return true;
+            if ( s == "false" || s == "0" ) return false;
+            return nullopt;
+        }
+        else if constexpr ( std::is_same_v<T, std::chrono::system_clock::time_point> )
+        {
+            return parse_timestamp( s );
+        }
+#if ! optfun_HAVE_FLOAT_FROM_CHARS
+        else if constexpr ( std::is_floating_point_v<T> )
+        {
+            return parse_chars_strtod<T>( s );
+        }
+#endif
+        else
+        {
+            return parse_chars<T>( s );
+        }
+    }
+};
+
+template< typename T >
+struct parse_all_t : range_stage
+{
+    template< typename R >
+    std::vector< optional<T> > operator()( R const & r ) const
+    {
+        std::vector< optional<T> > result;
+
+        if constexpr ( is_sized_range<R>::value )
+            result.reserve( static_cast<std::size_t>( std::size( r ) ) );
+
+        for ( auto const & field : r )
+        {
+            if constexpr ( is_optional_like< std::decay_t< decltype( field ) > >::value )
+                result.push_back( has_value( field ) ? parser<T>()( *field ) : optional<T>() );
+            else
+                result.push_back( parser<T>()( field ) );
+        }
+        return result;
+    }
+};
+
+} // namespace detail
+
+template< typename T >
+optional<T> parse_value( std::string_view s ) noexcept
+{
+    return detail::parser<T>()( s );
+}
+
+template< typename T >
+and_then< detail::parser<T> > parse()
+{
+    return and_then< detail::parser<T> >( detail::parser<T>() );
+}
+
+template< typename T >
+detail::parse_all_t<T> parse_all()
+{
+    return detail::parse_all_t<T>();
+}
+
+template< typename T, typename R >
+std::vector< optional<T> > parse_all( R const & r )
+{
+    return detail::parse_all_t<T>()( r );
+}
+
+}} // namespace nonstd::optfun_lite
+
+//
+// make parse available in namespace nonstd:
+//
+
+namespace nonstd {
+
+using optfun_lite::parse_value;
+using optfun_lite::parse;
+using optfun_lite::parse_all;
+
+} // namespace nonstd
+
+#endif // optfun_CPP17_OR_GREATER
+
+#endif // NONSTD_OPTIONAL_FUN_PARSE_LITE_HPP
+
+// end of file
@@ -0,0 +1,475 @@
+//
+// Copyright (c) 2017 Martin Moene
+//
+// https://github.com/martinmoene/optional-fun-lite
+//
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+// optional-fun-sparse: sequence of optionals that stores only its present values,
+// with a rank/select presence bitmap.
+
+#pragma once
+
+#ifndef NONSTD_OPTIONAL_FUN_SPARSE_LITE_HPP
+#define NONSTD_OPTIONAL_FUN_SPARSE_LITE_HPP
+
+#include "optional-fun.hpp"
+
+#if optfun_CPP17_OR_GREATER
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+//
+// Sparse optional vector:
+// - rank_select_bitmap: bits with a directory for rank(i), the number of set bits before
+//   position i, in constant time, and select(k), the position of the k-th set bit; the
+//   directory takes two words per block of 512 bits: the set bits before the block and
+//   those before each of its words, in 9-bit fields, plus a block index per 512 set bits,
+// - sparse_optional_vector<T>: a sequence of optional<T> that stores its present values
+//   contiguously and their presence in a rank_select_bitmap; element i is values()[rank(i)],
+// - present() iterates over the present elements only, as {index, value},
+// - v | map(f) and v | and_then(f) invoke f on the present values only and yield a
+//   sparse_optional_vector, v | map_or(f, u) yields a std::vector of size() elements.
+//
+
+namespace nonstd { namespace optfun_lite {
+
+class rank_select_bitmap
+{
+public:
+    static constexpr std::size_t block_words   = 8;
+    static constexpr std::size_t select_sample = 512;
+
+    rank_select_bitmap() = default;
+
+    // bits of size positions, bit i%64 of word i/64 for position i:
+
+    rank_select_bitmap( std::vector<std::uint64_t> words, std::size_t size )
+    : words_( std::move( words ) ), size_( size )
+    {
+        words_.resize( ( size_ + 63 ) / 64 );
+
+        if ( size_ % 64 != 0 )
+        {
+            words_.back() &= ( std::uint64_t( 1 ) << ( size_ % 64 ) ) - 1;
+        }
+
+        for ( std::size_t w = 0; w != words_.size(); ++w )
+        {
+            begin_word( w );
+            add_ones( static_cast<std::size_t>( detail::popcount64( words_[w] ) ), w );
+        }
+    }
+
+    std::size_t size()  const { return size_;  }
+    std::size_t count() const { return count_; }
+
+    std::vector<std::uint64_t> const & words() const { return words_; }
+
+    void push_back( bool bit )
+    {
+        if ( size_ % 64 == 0 )
+        {
+            words_.push_back( 0 );
+            begin_word( words_.size() - 1 );
+        }
+
+        if ( bit )
+        {
+            words_.back() |= std::uint64_t( 1 ) << ( size_ % 64 );
+            add_ones( 1, words_.size() - 1 );
+        }
+        ++size_;
+    }
+
+    bool test( std::size_t i ) const
+    {
+        return ( words_[ i / 64 ] >> ( i % 64 ) ) & 1u;
+    }
+
+    // number of set bits before position i, i <= size():
+
+    std::size_t rank( std::size_t i ) const
+    {
+        if ( i == size_ )
+        {
+            return count_;
+        }
+
+        std::size_t const w = i / 64;
+        std::size_t const m = i % 64;
+
+        return ones_before( w ) + static_cast<std::size_t>(
+            detail::popcount64( words_[w] & ( ( std::uint64_t( 1 ) << m ) - 1 ) ) );
+    }
+
+    // position of the k-th set bit, counting from 0, k < count():
+
+    std::size_t select( std::size_t k ) const
+    {
+        assert( k < count_ );
+
+        // the block is between those of the surrounding samples:
+
+        std::size_t lo = samples_[ k / select_sample ];
+        std::size_t hi = k / select_sample + 1 < samples_.size() ? samples_[ k / select_sample + 1 ] : blocks() - 1;
+
+        while ( lo < hi )
+        {
+            std::size_t const mid = lo + ( hi - lo + 1 ) / 2;
+
+            if ( directory_[ 2 * mid ] <= k )
+                lo = mid;
+            else
+                hi = mid - 1;
+        }
+
+        // then the word, via the block's counts:
+
+        std::size_t const last = (std::min)( words_.size(), ( lo + 1 ) * block_words );
+
+        std::size_t w = lo * block_words;
+        while ( w + 1 < last && ones_before( w + 1 ) <= k )
+        {
+            ++w;
+        }
+
+        // then the bit:
+
+        std::size_t r = k - ones_before( w );
+
+        std::uint64_t bits = words_[w];
+        for ( ; r != 0; --r )
+        {
+            bits &= bits - 1;
+        }
+        return w * 64 + static_cast<std::size_t>( detail::countr_zero64( bits ) );
+    }
+
+    // bytes of bits and directory:
+
+    std::size_t memory_bytes() const
+    {
+        return sizeof( std::uint64_t ) * ( words_.size() + directory_.size() ) + sizeof( std::size_t ) * samples_.size();
+    }
+
+private:
+    std::size_t blocks() const
+    {
+        return directory_.size() / 2;
+    }
+
+    std::size_t ones_before( std::size_t w ) const
+    {
+        std::size_t const b = w / block_words;
+        std::size_t const j = w % block_words;
+
+        return static_cast<std::size_t>( directory_[ 2 * b ] )
+            + ( j == 0 ? 0 : static_cast<std::size_t>( ( directory_[ 2 * b + 1 ] >> ( 9 * ( j - 1 ) ) ) & 0x1ffu ) );
+    }
+
+    // record the set bits before word w, all bits before it are final:
+
+    void begin_word( std::size_t w )
+    {
+        std::size_t const j = w % block_words;
+
+        if ( j == 0 )
+        {
+            directory_.push_back( count_ );
+            directory_.push_back( 0 );
+        }
+        else
+        {
+            directory_.back() |= std::uint64_t( count_ - directory_[ directory_.size() - 2 ] ) << ( 9 * ( j - 1 ) );
+        }
+    }
+
+    // count n set bits in word w, sampling the block of every select_sample-th one:
+
+    void add_ones( std::size_t n, std::size_t w )
+    {
+        while ( samples_.size() * select_sample < count_ + n )
+        {
+            samples_.push_back( w / block_words );
+        }
+        count_ += n;
+    }
+
+    std::vector<std::uint64_t> words_;
+    std::vector<std::uint64_t> directory_;
+    std::vector<std::size_t>   samples_;
+    std::size_t                size_  = 0;
+    std::size_t                count_ = 0;
+};
+
+template< typename T >
+class sparse_optional_vector
+{
+public:
+    using value_type = optional<T>;
+
+    // present element:
+
+    struct present_entry
+    {
+        std::size_t index;
+        T const &   value;
+    };
+
+    // iteration over all elements yields optional<T>:
+
+    class const_iterator
+    {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type        = optional<T>;
+        using difference_type   = std::ptrdiff_t;
+        using pointer           = void;
+        using reference         = optional<T>;
+
+        const_iterator() = default;
+
+        const_iterator( sparse_optional_vector const * v, std::size_t pos, std::size_t rank )
+        : v_( v ), pos_( pos ), rank_( rank ) {}
+
+        reference operator*() const
+        {
+            return v_->presence_.test( pos_ ) ? optional<T>( v_->values_[ rank_ ] ) : optional<T>();
+        }
+
+        const_iterator & operator++()
+        {
+            rank_ += v_->presence_.test( pos_ );
+            ++pos_;
+            return *this;
+        }
+
+        const_iterator operator++( int ) { const_iterator result( *this ); ++*this; return result; }
+
+        friend bool operator==( const_iterator a, const_iterator b ) { return a.pos_ == b.pos_; }
+        friend bool operator!=( const_iterator a, const_iterator b ) { return a.pos_ != b.pos_; }
+
+    private:
+        sparse_optional_vector const * v_ = nullptr;
+        std::size_t pos_  = 0;
+        std::size_t rank_ = 0;
+    };
+
+    // iteration over the present elements only, a word of the bitmap at a time:
+
+    class present_iterator
+    {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type        = present_entry;
+        using difference_type   = std::ptrdiff_t;
+        using pointer           = void;
+        using reference         = present_entry;
+
+        present_iterator() = default;
+
+        present_iterator( sparse_optional_vector const * v, std::size_t w, std::size_t rank )
+        : v_( v ), w_( w ), bits_( w < v->presence_.words().size() ? v->presence_.words()[w] : 0 ), rank_( rank )
+        {
+            skip_empty_words();
+        }
+
+        reference operator*() const
+        {
+            return { w_ * 64 + static_cast<std::size_t>( detail::countr_zero64( bits_ ) ), v_->values_[ rank_ ] };
+        }
+
+        present_iterator & operator++()
+        {
+            bits_ &= bits_ - 1;
+            ++rank_;
+            skip_empty_words();
+            return *this;
+        }
+
+        present_iterator operator++( int ) { present_iterator result( *this ); ++*this; return result; }
+
+        friend bool operator==( present_iterator const & a, present_iterator const & b ) { return a.rank_ == b.rank_; }
+        friend bool operator!=( present_iterator const & a, present_iterator const & b ) { return a.rank_ != b.rank_; }
+
+    private:
+        void skip_empty_words()
+        {
+            std::vector<std::uint64_t> const & words = v_->presence_.words();
+
+            while ( bits_ == 0 && w_ + 1 < words.size() )
+            {
+                bits_ = words[ ++w_ ];
+            }
+        }
+
+        sparse_optional_vector const * v_ = nullptr;
+        std::size_t   w_    = 0;
+        std::uint64_t bits_ = 0;
+        std::size_t   rank_ = 0;
+    };
+
+    struct present_range
+    {
+        present_iterator first;
+        present_iterator last;
+
+        present_iterator begin() const { return first; }
+        present_iterator end()   const { return last;  }
+    };
+
+    sparse_optional_vector() = default;
+
+    // presence and the present values, presence.count() == values.size():
+
+    sparse_optional_vector( rank_select_bitmap presence, std::vector<T> values )
+    : presence_( std::move( presence ) ), values_( std::move( values ) )
+    {
+        assert( presence_.count() == values_.size() );
+    }
+
+    // from a range of optionals, like a std::vector or a nullable_view:
+
+    template< typename R
+        , typename = std::enable_if_t< ! std::is_same_v< std::decay_t<R>, sparse_optional_vector > >
+    >
+    explicit sparse_optional_vector( R const & r )
+    {
+        for ( auto const & o : r )
+        {
+            if ( has_value( o ) )
+                push_back( *o );
+            else
+                push_back( nullopt );
+        }
+    }
+
+    void push_back( optional<T> const & o )
+    {
+        presence_.push_back( o.has_value() );
+
+        if ( o.has_value() )
+        {
+            values_.push_back( *o );
+        }
+    }
+
+    std::size_t size()  const { return presence_.size(); }
+    bool        empty() const { return presence_.size() == 0; }
+
+    // number of present elements:
+
+    std::size_t count() const { return values_.size(); }
+
+    optional<T> operator[]( std::size_t i ) const
+    {
+        return presence_.test( i ) ? optional<T>( values_[ presence_.rank( i ) ] ) : optional<T>();
+    }
+
+    const_iterator begin() const { return const_iterator( this, 0, 0 ); }
+    const_iterator end()   const { return const_iterator( this, size(), count() ); }
+
+    present_range present() const
+    {
+        return { present_iterator( this, 0, 0 ), present_iterator( this, presence_.words().size(), count() ) };
+    }
+
+    rank_select_bitmap const & presence() const { return presence_; }
+    std::vector<T>     const & values()   const { return values_;   }
+
+    // bytes of values, bitmap and directory:
+
+    std::size_t memory_bytes() const
+    {
+        return sizeof( T ) * values_.size() + presence_.memory_bytes();
+    }
+
+private:
+    rank_select_bitmap presence_;
+    std::vector<T>     values_;
+};
+
+template< typename R >
+sparse_optional_vector( R const & ) -> sparse_optional_vector< detail::range_value_t<R> >;
+
+// v | map(f): f on the present values, presence unchanged:
+
+template< typename T, typename F, typename H >
+auto operator|( sparse_optional_vector<T> const & v, map<F,H> const & m )
+{
+    using U = std::decay_t< detail::invoke_result_t< F, T const & > >;
+
+    std::vector<U> values;
+    values.reserve( v.count() );
+
+    for ( T const & x : v.values() )
+    {
+        values.push_back( detail::invoke( m.f, x ) );
+    }
+    return sparse_optional_vector<U>( v.presence(), std::move( values ) );
+}
+
+// v | map_or(f, u): f on the present values, u elsewhere:
+
+template< typename T, typename F, typename U, typename H >
+std::vector<U> operator|( sparse_optional_vector<T> const & v, map_or<F,U,H> const & m )
+{
+    std::vector<U> result( v.size(), m.u );
+
+    for ( auto const entry : v.present() )
+    {
+        result[ entry.index ] = detail::invoke( m.f, entry.value );
+    }
+    return result;
+}
+
+// v | and_then(f): f on the present values, present where its result is:
+
+template< typename T, typename F, typename H >
+auto operator|( sparse_optional_vector<T> const & v, and_then<F,H> const & a )
+{
+    using U = detail::optional_value_t< std::decay_t< detail::invoke_result_t< F, T const & > > >;
+
+    std::vector<std::uint64_t> words = v.presence().words();
+    std::vector<U> values;
+    values.reserve( v.count() );
+
+    for ( auto const entry : v.present() )
+    {
+        auto r = detail::invoke( a.f, entry.value );
+
+        if ( has_value( r ) )
+            values.push_back( *std::move( r ) );
+        else
+            words[ entry.index / 64 ] &= ~( std::uint64_t( 1 ) << ( entry.index % 64 ) );
+    }
+    return sparse_optional_vector<U>( rank_select_bitmap( std::move( words ), v.size() ), std::move( values ) );
+}
+
+}} // namespace nonstd::optfun_lite
+
+//
+// make sparse optional vector available in namespace nonstd:
+//
+
+namespace nonstd {
+
+using optfun_lite::rank_select_bitmap;
+using optfun_lite::sparse_optional_vector;
+
+} // namespace nonstd
+
+#endif // optfun_CPP17_OR_GREATER
+
+#endif // NONSTD_OPTIONAL_FUN_SPARSE_LITE_HPP
+
+// end of file
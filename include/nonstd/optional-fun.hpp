@@ -39,6 +39,37 @@
 #ifndef optfun_CONFIG_USE_STD_OPTIONAL
 #endif
 
+// Stage instrumentation (C++17 and later), see section 2:
+
+#ifndef  optfun_CONFIG_INSTRUMENT
+# define optfun_CONFIG_INSTRUMENT  0
+#endif
+
+// Disable SIMD paths of range kernels, e.g. to test the scalar path:
+
+#ifndef  optfun_CONFIG_NO_SIMD
+# define optfun_CONFIG_NO_SIMD  0
+#endif
+
+// Force inlining of adaptors and pipe operators, e.g. for debug builds:
+
+#ifndef  optfun_CONFIG_FORCE_INLINE
+# define optfun_CONFIG_FORCE_INLINE  0
+#endif
+
+// Control presence of exception handling (try and auto discover):
+
+#ifndef optfun_CONFIG_NO_EXCEPTIONS
+# if defined(_MSC_VER)
+#  include <cstddef>    // for _HAS_EXCEPTIONS
+# endif
+# if defined(__cpp_exceptions) || defined(__EXCEPTIONS) || (defined(_HAS_EXCEPTIONS) && (_HAS_EXCEPTIONS))
+#  define optfun_CONFIG_NO_EXCEPTIONS  0
+# else
+#  define optfun_CONFIG_NO_EXCEPTIONS  1
+# endif
+#endif
+
 // C++ language version detection (C++23 is speculative):
 // Note: VC14.0/1900 (VS2015) lacks too much from C++14.
 
@@ -72,7 +103,9 @@
 # define optfun_USES_BOOST_OPTIONAL  1
 # define optfun_USES_STD_OPTIONAL    0
 # include <boost/none.hpp>
-# include <boost/optional/bad_optional_access.hpp>
+# if ! optfun_CONFIG_NO_EXCEPTIONS
+#  include <boost/optional/bad_optional_access.hpp>
+# endif
 #elif optfun_CPP17_OR_GREATER
 # define optfun_USES_OPTIONAL_LITE   0
 # define optfun_USES_BOOST_OPTIONAL  0
@@ -82,6 +115,45 @@
 #endif
 #endif
 
+//
+// forced inlining:
+// - with optfun_CONFIG_FORCE_INLINE, adaptors are always inlined and marked artificial,
+//   operator| additionally inlines all it calls (flatten), also at -O0 and -Og,
+// - this removes the proxy, worker and pipe layers from debug builds and debugger step-into.
+//
+
+#if defined(__has_attribute)
+# define optfun_HAS_ATTRIBUTE( x )  __has_attribute( x )
+#else
+# define optfun_HAS_ATTRIBUTE( x )  0
+#endif
+
+#if optfun_CONFIG_FORCE_INLINE && ( defined(__GNUC__) || defined(__clang__) )
+# if optfun_HAS_ATTRIBUTE( artificial )
+#  define optfun_force_inline          inline __attribute__(( always_inline, artificial ))
+#  define optfun_force_inline_flatten  inline __attribute__(( always_inline, artificial, flatten ))
+# else
+#  define optfun_force_inline          inline __attribute__(( always_inline ))
+#  define optfun_force_inline_flatten  inline __attribute__(( always_inline, flatten ))
+# endif
+#elif optfun_CONFIG_FORCE_INLINE && defined(_MSC_VER)
+# define optfun_force_inline          __forceinline
+# define optfun_force_inline_flatten  __forceinline
+#else
+# define optfun_force_inline          inline
+# define optfun_force_inline_flatten  inline
+#endif
+
+// a function on a branch that a likely() or unlikely() hint expects not to be taken:
+
+#if defined(__GNUC__) || defined(__clang__)
+# define optfun_cold_path  __attribute__(( noinline, cold ))
+#elif defined(_MSC_VER)
+# define optfun_cold_path  __declspec( noinline )
+#else
+# define optfun_cold_path
+#endif
+
 // optonal functional extensions in three parts:
 // 1. nudge optional, common to all language versions
 // 2. C++17 and later
@@ -91,6 +163,8 @@
 // 1. nudge optional:
 // - provide optional used in namespace nonstd:
 // - provide has_value() free function to accommodate differences between optional-s
+// - adaptors access the content via unchecked operator*() after their own has_value() test,
+//   so they neither repeat the test nor contain a path that throws bad_optional_access
 //
 
 namespace nonstd {
@@ -102,7 +176,7 @@ namespace nonstd {
 namespace optfun_lite {
 
 template< typename T >
-inline bool has_value( nonstd::optional<T> const & o ) { return o.has_value(); }
+optfun_force_inline bool has_value( nonstd::optional<T> const & o ) { return o.has_value(); }
 
 template< typename T >
 inline bool value( nonstd::optional<T> const & o ) { return o.has_value(); }
@@ -113,13 +187,15 @@ inline bool value( nonstd::optional<T> const & o ) { return o.has_value(); }
 
 using std::optional;
 using std::nullopt;
-using std::bad_optional_access;
 using std::make_optional;
+#if ! optfun_CONFIG_NO_EXCEPTIONS
+using std::bad_optional_access;
+#endif
 
 namespace optfun_lite {
 
 template< typename T >
-inline bool has_value( std::optional<T> const & o ) { return o.has_value(); }
+optfun_force_inline bool has_value( std::optional<T> const & o ) { return o.has_value(); }
 
 template< typename T >
 inline bool value( nonstd::optional<T> const & o ) { return o.has_value(); }
@@ -129,15 +205,17 @@ inline bool value( nonstd::optional<T> const & o ) { return o.has_value(); }
 #elif optfun_USES_BOOST_OPTIONAL
 
 using boost::optional;
-using boost::bad_optional_access;
 using boost::make_optional;
+#if ! optfun_CONFIG_NO_EXCEPTIONS
+using boost::bad_optional_access;
+#endif
 
 namespace { boost::none_t const & nullopt = boost::none; }
 
 namespace optfun_lite {
 
 template< typename T >
-inline bool has_value( boost::optional<T> const & o ) { return !!o; }
+optfun_force_inline bool has_value( boost::optional<T> const & o ) { return !!o; }
 
 }
 
@@ -145,14 +223,208 @@ inline bool has_value( boost::optional<T> const & o ) { return !!o; }
 
 } // namespace nonstd
 
+//
+// presence hints:
+// - select the expected outcome of the has_value() test in an adaptor via
+//   `map(f).likely()` and `map(f).unlikely()`; default is no hint,
+// - the hint is passed to the compiler via __builtin_expect() or C++20 [[likely]],
+//   which places the unexpected branch out of the straight-line code path.
+//
+
+#if defined(__GNUC__) || defined(__clang__)
+# define optfun_HAVE_BUILTIN_EXPECT  1
+#else
+# define optfun_HAVE_BUILTIN_EXPECT  0
+#endif
+
+#if defined(__has_builtin)
+# define optfun_HAS_BUILTIN( x )  __has_builtin( x )
+#else
+# define optfun_HAS_BUILTIN( x )  0
+#endif
+
+namespace nonstd { namespace optfun_lite {
+
+struct hint_none     {};
+struct hint_likely   {};
+struct hint_unlikely {};
+
+namespace detail {
+
+optfun_force_inline bool present( bool b, hint_none )
+{
+    return b;
+}
+
+// the presence test with the hint's expectation; without __builtin_expect() the hint only
+// moves the unexpected branch out of line, see invoke_present() and invoke_empty() (C++17):
+
+optfun_force_inline bool present( bool b, hint_likely )
+{
+#if optfun_HAVE_BUILTIN_EXPECT
+    return __builtin_expect( b, 1 );
+#else
+    return b;
+#endif
+}
+
+optfun_force_inline bool present( bool b, hint_unlikely )
+{
+#if optfun_HAVE_BUILTIN_EXPECT
+    return __builtin_expect( b, 0 );
+#else
+    return b;
+#endif
+}
+
+// the presence test of an input that expects itself present, for a stage without a hint:
+// as sure as GCC is of a check it predicts itself, which keeps the branch over a conditional move:
+
+struct hint_expected {};
+
+optfun_force_inline bool present( bool b, hint_expected )
+{
+#if optfun_HAS_BUILTIN( __builtin_expect_with_probability )
+    return __builtin_expect_with_probability( b, 1, 0.99 );
+#else
+    return present( b, hint_likely() );
+#endif
+}
+
+} // namespace detail
+
+}} // namespace nonstd::optfun_lite
+
+//
+// optional references:
+// - optional_ref<T> refers to a T or to nothing, like the result of get(&A::b) and get_opt(&A::b),
+// - adaptors accept it in place of an optional and pass the referred-to T on without a copy,
+// - it converts to an optional<T> with a copy of the T.
+//
+
+namespace nonstd { namespace optfun_lite {
+
+template< typename T >
+class optional_ref
+{
+public:
+    typedef T value_type;
+
+    optional_ref()
+    : ptr_( 0 ) {}
+
+    explicit optional_ref( T & t )
+    : ptr_( &t ) {}
+
+    bool has_value() const { return ptr_ != 0; }
+
+    T & operator*()  const { return *ptr_; }
+    T * operator->() const { return  ptr_; }
+
+    template< typename U >
+    T value_or( U const & u ) const
+    {
+        return ptr_ ? *ptr_ : static_cast<T>( u );
+    }
+
+    template< typename U >
+    operator optional<U>() const
+    {
+        return ptr_ ? optional<U>( *ptr_ ) : optional<U>();
+    }
+
+private:
+    T * ptr_;
+};
+
+template< typename T >
+optfun_force_inline bool has_value( optional_ref<T> const & o ) { return o.has_value(); }
+
+namespace detail {
+
+// optional and optional_ref, the inputs of adaptors:
+
+template< typename O > struct is_optional_like                   { static const bool value = false; };
+template< typename T > struct is_optional_like< optional<T> >     { static const bool value = true;  };
+template< typename T > struct is_optional_like< optional_ref<T> > { static const bool value = true;  };
+
+} // namespace detail
+
+}} // namespace nonstd::optfun_lite
+
 //
 // 2. C++7 and later:
 //
 
 #if optfun_CPP17_OR_GREATER
 
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
 #include <functional>
+#include <initializer_list>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <new>
+#include <tuple>
 #include <type_traits>
+#include <utility>
+#include <vector>
+
+// memory resources for allocator-aware payloads, see with_resource():
+
+#if defined(__has_include)
+# if __has_include(<memory_resource>)
+#  include <memory_resource>
+# endif
+#endif
+
+#if defined(__cpp_lib_memory_resource)
+# define optfun_HAVE_MEMORY_RESOURCE  1
+#else
+# define optfun_HAVE_MEMORY_RESOURCE  0
+#endif
+
+// stateless callables take no room in adaptors, see composed:
+
+#if defined(_MSC_VER) && _MSC_VER >= 1929
+# define optfun_no_unique_address  [[msvc::no_unique_address]]
+#elif defined(__has_cpp_attribute)
+# if __has_cpp_attribute(no_unique_address)
+#  define optfun_no_unique_address  [[no_unique_address]]
+#  define optfun_HAVE_NO_UNIQUE_ADDRESS  1
+# endif
+#endif
+
+#ifndef  optfun_no_unique_address
+# define optfun_no_unique_address  /*[[no_unique_address]]*/
+#endif
+
+#ifndef  optfun_HAVE_NO_UNIQUE_ADDRESS
+# define optfun_HAVE_NO_UNIQUE_ADDRESS  0
+#endif
+
+// SIMD paths of stream compaction:
+
+#if ! optfun_CONFIG_NO_SIMD && defined(__AVX512F__)
+# define optfun_HAVE_AVX512F  1
+#else
+# define optfun_HAVE_AVX512F  0
+#endif
+
+#if ! optfun_CONFIG_NO_SIMD && defined(__AVX2__)
+# define optfun_HAVE_AVX2  1
+#else
+# define optfun_HAVE_AVX2  0
+#endif
+
+#if optfun_HAVE_AVX2 || optfun_HAVE_AVX512F
+# include <immintrin.h>
+#endif
 
 //
 // class monostate:
@@ -188,244 +460,3129 @@ public:
 } //namespace std
 
 //
-// functional algorithms:
+// stage instrumentation:
+// - enabled via optfun_CONFIG_INSTRUMENT, compiles to nothing otherwise,
+// - counts per stage name: applications, short-circuits, empty results and the time spent
+//   (rdtsc ticks if available, otherwise nanoseconds); a stage short-circuits on an empty
+//   input, or on a present one for or_() and or_else(), and never for map_or_else() and
+//   the branchless stages, per optfun_stage_skips(),
+// - each thread owns its counters, a mutex is only taken when a thread first meets a stage.
 //
 
-namespace nonstd { namespace optfun_lite {
-
-// map(f):
-// - perform operation `U f(T)` on optional's content if present and return an optional<U>.
-// - perform operation `void f(T)` on optional's content if present and return an optional<monostate>..
+#if optfun_CONFIG_INSTRUMENT
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <ostream>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+# if defined(_MSC_VER)
+#  include <intrin.h>
+# else
+#  include <x86intrin.h>
+# endif
+# define optfun_HAVE_RDTSC  1
+#else
+# define optfun_HAVE_RDTSC  0
+#endif
 
-template< typename F >
-struct map
-{
-    F f;
+namespace nonstd::optfun_lite::instrument {
 
-    map( F f_ )
-    : f( f_ ) {}
+// input on which a stage short-circuits, leaving its function or value unused:
 
-    // map(f): perform operation `U f(T)` on optional's
-    // content if present and return an optional<U>.
+enum class skips { on_empty, on_present, never };
 
-    template< typename T >
-    std::enable_if_t<
-        !std::is_void_v< std::invoke_result_t<F,T> >
-        , optional< std::invoke_result_t<F,T> >
-    >
-    operator()( optional<T> const & o ) const
-    {
-        if ( has_value( o ) )
-        {
-            return std::invoke( f, o.value() );
-        }
-        return nullopt;
-    }
+// aggregated counters of a stage:
 
-    // map(f): perform operation `void f(T)` on optional's
-    // content if present and return an optional<monostate>.
+struct stage_stats
+{
+    std::string   name;
+    std::uint64_t calls   = 0;  // operator| applications
+    std::uint64_t skipped = 0;  // applications that short-circuited, see skips
+    std::uint64_t empty   = 0;  // applications that produced an empty optional
+    std::uint64_t ticks   = 0;  // time spent in the stage
 
-    template< typename T >
-    std::enable_if_t<
-        std::is_void_v< std::invoke_result_t<F,T> >
-        , optional< monostate >
-    >
-    operator()( optional<T> const & o ) const
-    {
-        if ( has_value( o ) )
-        {
-            std::invoke( f, o.value() );
-            return monostate{};
-        }
-        return nullopt;
-    }
+    std::uint64_t ran() const noexcept { return calls - skipped; }
 };
 
-// map_or(f, u): perform operation `U f(T)` on optional's
-// content if present and return it, otherwise return u.
+namespace detail {
 
-template< typename F, typename U >
-struct map_or
+// counters of a stage in a single thread; only the owning thread writes them:
+
+struct counters
 {
-    F f;
-    U const & u;
+    char const *               name = "";
+    std::atomic<std::uint64_t> calls{0};
+    std::atomic<std::uint64_t> skipped{0};
+    std::atomic<std::uint64_t> empty{0};
+    std::atomic<std::uint64_t> ticks{0};
+};
 
-    map_or( F f_, U const & u_ )
-    : f( f_ ), u( u_) {}
+// counters of all threads, a deque keeps their addresses stable,
+// and the stage names given to named(), a set keeps their addresses stable:
 
-    template< typename T >
-    U
-    operator()( optional<T> const & o ) const
-    {
-        if ( has_value( o ) )
-        {
-            return std::invoke( f, o.value() );
-        }
-        return u;
-    }
+struct registry
+{
+    std::mutex             mutex;
+    std::deque<counters>   all;
+    std::set<std::string>  names;
 };
 
-// map_or_else(f, u): perform operation `U f(T)` on optional's
-// content if present and return it, otherwise return operation u().
+inline registry & global()
+{
+    static registry r;
+    return r;
+}
 
-template< typename F, typename U >
-struct map_or_else
+// a copy of name that lives as long as the program, one per distinct name, so that
+// named() accepts any string and lookup() may key on the address:
+
+inline char const * intern( char const * name )
 {
-    F f;
-    U u;
+    registry & r = global();
+    std::lock_guard<std::mutex> lock( r.mutex );
+
+    return r.names.insert( name ).first->c_str();
+}
 
-    map_or_else( F f_, U u_ )
-    : f( f_ ), u( u_) {}
+// counters of the stage with name, a string literal or interned:
 
-    template< typename T >
-    std::invoke_result_t<U>
-    operator()( optional<T> const & o ) const
+inline counters & lookup( char const * name )
+{
+    thread_local std::vector< std::pair<char const *, counters *> > cache;
+
+    for ( auto const & e : cache )
     {
-        if ( has_value( o ) )
-        {
-            return std::invoke( f, o.value() );
-        }
-        return u();
+        if ( e.first == name )
+            return *e.second;
     }
-};
 
-// and_then(f): return operation `optional<U> f(T)` on optional's
-// content if present and return an optional<U>.
+    registry & r = global();
+    std::lock_guard<std::mutex> lock( r.mutex );
 
-template< typename F >
-struct and_then
+    counters & c = r.all.emplace_back();
+    c.name = name;
+    cache.emplace_back( name, &c );
+    return c;
+}
+
+// only the owning thread writes a counter, so a plain load and store suffice,
+// without the locked read-modify-write of fetch_add():
+
+inline void bump( std::atomic<std::uint64_t> & counter, std::uint64_t n ) noexcept
 {
-    F f;
+    counter.store( counter.load( std::memory_order_relaxed ) + n, std::memory_order_relaxed );
+}
 
-    and_then( F f_ )
-    : f( f_ ) {}
+template< typename T >
+struct is_optional : std::false_type {};
 
-    template< typename T >
-    std::invoke_result_t<F,T>
-    operator()( optional<T> const & o ) const
-    {
-        if ( has_value( o ) )
-        {
-            return std::invoke( f, o.value() );
-        }
-        return nullopt;
-    }
-};
+template< typename T >
+struct is_optional< optional<T> > : std::true_type {};
 
-// alias then to and_then:
+template< typename F, typename = void >
+struct has_stage_name : std::false_type {};
 
 template< typename F >
-struct then : and_then<F>
-{
-    then( F f )
-    : and_then<F>( f ) {}
-};
+struct has_stage_name< F, std::void_t< decltype( std::declval<F const &>().stage_name ) > > : std::true_type {};
 
-// or_else(f):
-// - return the call `R f()` if optional is empty, otherwise return optional.
-// - call `void f()` and return nullopt if optional is empty, otherwise return optional.
+// input on which stage F short-circuits, on an empty one unless it says otherwise:
+
+template< typename F, typename = void >
+struct stage_skips : std::integral_constant< skips, skips::on_empty > {};
 
 template< typename F >
-struct or_else
+struct stage_skips< F, std::void_t< decltype( F::stage_skips ) > > : std::integral_constant< skips, F::stage_skips > {};
+
+} // namespace detail
+
+// current time in ticks:
+
+inline std::uint64_t now() noexcept
 {
-    F f;
+#if optfun_HAVE_RDTSC
+    return __rdtsc();
+#else
+    return static_cast<std::uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch() ).count() );
+#endif
+}
 
-    or_else( F f_ )
-    : f( f_ ) {}
+// unit of ticks:
 
-    // or_else(f): return the call `R f()` if optional is empty, otherwise return optional.
+inline char const * tick_unit() noexcept
+{
+    return optfun_HAVE_RDTSC ? "cycles" : "ns";
+}
 
-    template< typename T >
-    typename std::enable_if_t<
-        ! std::is_void_v< std::invoke_result_t<F> >
-        , optional<T>
-    >
-    operator()( optional<T> const & o ) const
+// apply stage f to optional o, counting the application:
+
+template< typename F, typename O >
+auto apply( F const & f, O && o )
+{
+    char const * name = "stage";
+
+    if constexpr ( detail::has_stage_name<F>::value )
     {
-        if ( has_value( o ) )
-        {
-            return o;
-        }
-        return f();
+        name = f.stage_name;
     }
 
-    // or_else(f): call `void f()` and return nullopt if optional is empty, otherwise return optional.
+    detail::counters & c = detail::lookup( name );
 
-    template< typename T >
-    typename std::enable_if_t<
-        std::is_void_v< std::invoke_result_t<F> >
-        , optional<T>
+    if constexpr ( detail::stage_skips<F>::value == skips::on_empty )
+    {
+        if ( ! has_value( o ) )
+            detail::bump( c.skipped, 1 );
+    }
+    else if constexpr ( detail::stage_skips<F>::value == skips::on_present )
+    {
+        if ( has_value( o ) )
+            detail::bump( c.skipped, 1 );
+    }
+
+    std::uint64_t const start = now();
+    auto result = std::invoke( f, std::forward<O>( o ) );
+    detail::bump( c.ticks, now() - start );
+    detail::bump( c.calls, 1 );
+
+    if constexpr ( detail::is_optional< decltype( result ) >::value )
+    {
+        if ( ! has_value( result ) )
+        {
+            detail::bump( c.empty, 1 );
+        }
+    }
+    return result;
+}
+
+// aggregate the counters of all threads per stage name, in order of first use:
+
+inline std::vector<stage_stats> snapshot()
+{
+    std::vector<stage_stats> result;
+
+    detail::registry & r = detail::global();
+    std::lock_guard<std::mutex> lock( r.mutex );
+
+    for ( auto const & c : r.all )
+    {
+        auto pos = result.begin();
+        while ( pos != result.end() && pos->name != c.name )
+            ++pos;
+
+        if ( pos == result.end() )
+        {
+            pos = result.insert( result.end(), stage_stats() );
+            pos->name = c.name;
+        }
+
+        pos->calls   += c.calls  .load( std::memory_order_relaxed );
+        pos->skipped += c.skipped.load( std::memory_order_relaxed );
+        pos->empty   += c.empty  .load( std::memory_order_relaxed );
+        pos->ticks   += c.ticks  .load( std::memory_order_relaxed );
+    }
+    return result;
+}
+
+// reset the counters of all threads; call it while no instrumented chain runs, as an owning
+// thread may otherwise overwrite a reset counter with its next update:
+
+inline void reset()
+{
+    detail::registry & r = detail::global();
+    std::lock_guard<std::mutex> lock( r.mutex );
+
+    for ( auto & c : r.all )
+    {
+        c.calls  .store( 0, std::memory_order_relaxed );
+        c.skipped.store( 0, std::memory_order_relaxed );
+        c.empty  .store( 0, std::memory_order_relaxed );
+        c.ticks  .store( 0, std::memory_order_relaxed );
+    }
+}
+
+// write the aggregated counters as a table:
+
+inline std::ostream & dump( std::ostream & os )
+{
+    os << "stage\tcalls\tran\tskipped\tempty\t" << tick_unit() << "\n";
+
+    for ( auto const & s : snapshot() )
+    {
+        os << s.name << "\t" << s.calls << "\t" << s.ran() << "\t" << s.skipped << "\t" << s.empty << "\t" << s.ticks << "\n";
+    }
+    return os;
+}
+
+} // namespace nonstd::optfun_lite::instrument
+
+// stage name with default, settable via named(), which keeps an interned copy of the name;
+// named() is a no-op when not instrumenting:
+
+# define optfun_stage_name( type, dflt )                   \
+    char const * stage_name = dflt;                         \
+    type named( char const * name ) const                   \
+    {                                                       \
+        type result( *this );                               \
+        result.stage_name = ::nonstd::optfun_lite::instrument::detail::intern( name ); \
+        return result;                                      \
+    }
+
+# define optfun_stage_name_from( other )  stage_name = other.stage_name;
+
+// input on which a stage short-circuits, if not on an empty one:
+
+# define optfun_stage_skips( when )  \
+    static constexpr ::nonstd::optfun_lite::instrument::skips stage_skips = ::nonstd::optfun_lite::instrument::skips::when;
+
+#else // optfun_CONFIG_INSTRUMENT
+
+# define optfun_stage_name( type, dflt )                   \
+    optfun_force_inline type named( char const * /*name*/ ) const \
+    {                                                       \
+        return *this;                                       \
+    }
+
+# define optfun_stage_name_from( other )  /*stage_name = other.stage_name;*/
+
+# define optfun_stage_skips( when )  /*stage_skips = when;*/
+
+#endif // optfun_CONFIG_INSTRUMENT
+
+//
+// functional algorithms:
+//
+
+namespace nonstd { namespace optfun_lite {
+
+#if optfun_HAVE_MEMORY_RESOURCE
+
+// allocator that a function `U f(T, resource_allocator)` receives in a with_resource() chain,
+// it allocates from the resource of that chain:
+
+using resource_allocator = std::pmr::polymorphic_allocator<std::byte>;
+
+namespace detail {
+
+inline std::pmr::memory_resource *& scoped_resource() noexcept
+{
+    thread_local std::pmr::memory_resource * resource = nullptr;
+    return resource;
+}
+
+} // namespace detail
+
+// resource of the with_resource() chain this thread evaluates, otherwise the default resource:
+
+inline std::pmr::memory_resource * current_resource() noexcept
+{
+    std::pmr::memory_resource * resource = detail::scoped_resource();
+    return resource != nullptr ? resource : std::pmr::get_default_resource();
+}
+
+#endif // optfun_HAVE_MEMORY_RESOURCE
+
+namespace detail {
+
+// invoke(f, args...): call f directly unless it is a member pointer, so that
+// a debug build does not add std::invoke()'s layers to every stage:
+
+template< typename F, typename... Args >
+optfun_force_inline decltype(auto) invoke( F && f, Args &&... args )
+{
+    if constexpr ( std::is_member_pointer_v< std::decay_t<F> > )
+        return std::invoke( std::forward<F>( f ), std::forward<Args>( args )... );
+    else
+        return static_cast<F &&>( f )( static_cast<Args &&>( args )... );  // not std::forward(), a call at -O0
+}
+
+// invoke(f, args...) out of line, for the branch a hint expects not to be taken:
+
+template< typename F, typename... Args >
+optfun_cold_path decltype(auto) invoke_cold( F const & f, Args &&... args )
+{
+    return detail::invoke( f, std::forward<Args>( args )... );
+}
+
+// invoke(f, args...) on the branch of a present input, out of line if Hint expects it empty:
+
+template< typename Hint, typename F, typename... Args >
+optfun_force_inline decltype(auto) invoke_present( F const & f, Args &&... args )
+{
+    if constexpr ( std::is_same_v< Hint, hint_unlikely > )
+        return invoke_cold( f, std::forward<Args>( args )... );
+    else
+        return detail::invoke( f, std::forward<Args>( args )... );
+}
+
+// invoke(f, args...) on the branch of an empty input, out of line if Hint expects it present:
+
+template< typename Hint, typename F, typename... Args >
+optfun_force_inline decltype(auto) invoke_empty( F const & f, Args &&... args )
+{
+    if constexpr ( std::is_same_v< Hint, hint_likely > )
+        return invoke_cold( f, std::forward<Args>( args )... );
+    else
+        return invoke( f, std::forward<Args>( args )... );
+}
+
+// an input that expects itself present, like the result of from_errno() (optional-fun-bridge.hpp):
+
+template< typename O > struct expects_present { static const bool value = false; };
+
+// the hint of an adaptor's presence test on input O: the adaptor's, or the input's expectation:
+
+template< typename Hint, typename O >
+using input_hint_t = std::conditional_t< std::is_same_v< Hint, hint_none > && expects_present<O>::value, hint_expected, Hint >;
+
+// result type of invoke(f, args...):
+
+template< typename F, typename... Args >
+struct invoke_result : std::invoke_result< F, Args... > {};
+
+template< typename F, typename... Args >
+using invoke_result_t = typename invoke_result< F, Args... >::type;
+
+// value type of an adaptor's input, an optional or an optional_ref, and the type its content is passed as:
+
+template< typename O >
+using optional_value_t = std::enable_if_t< is_optional_like<O>::value, std::remove_const_t< typename O::value_type > >;
+
+template< typename O >
+using content_t = decltype( *std::declval<O const &>() );
+
+// types that map_branchless() and map_or_branchless() may compute on without a test:
+
+template< typename T >
+struct is_branchless_safe : std::bool_constant<
+    std::is_trivially_copyable_v<T> && std::is_default_constructible_v<T> > {};
+
+// select a if c is true, otherwise b, via bit masks so that the compiler cannot turn it into a branch:
+
+template< std::size_t N > struct uint_of_size;
+template<> struct uint_of_size<1> { using type = std::uint8_t;  };
+template<> struct uint_of_size<2> { using type = std::uint16_t; };
+template<> struct uint_of_size<4> { using type = std::uint32_t; };
+template<> struct uint_of_size<8> { using type = std::uint64_t; };
+
+template< typename W >
+optfun_force_inline W select_bits( bool c, W a, W b )
+{
+    W const mask = static_cast<W>( W( 0 ) - W( c ) );
+    return static_cast<W>( ( a & mask ) | ( b & static_cast<W>( ~mask ) ) );
+}
+
+template< typename U >
+optfun_force_inline U select( bool c, U const & a, U const & b )
+{
+    if constexpr ( ! std::is_trivially_copyable_v<U> )
+    {
+        return c ? a : b;
+    }
+    else if constexpr ( sizeof( U ) == 1 || sizeof( U ) == 2 || sizeof( U ) == 4 )
+    {
+        using W = typename uint_of_size< sizeof( U ) >::type;
+
+        W wa, wb;
+        std::memcpy( &wa, &a, sizeof( W ) );
+        std::memcpy( &wb, &b, sizeof( W ) );
+
+        W const w = select_bits( c, wa, wb );
+
+        U result;
+        std::memcpy( &result, &w, sizeof( U ) );
+        return result;
+    }
+    else if constexpr ( sizeof( U ) % 8 == 0 )
+    {
+        std::uint64_t wa[ sizeof( U ) / 8 ], wb[ sizeof( U ) / 8 ];
+        std::memcpy( wa, &a, sizeof( U ) );
+        std::memcpy( wb, &b, sizeof( U ) );
+
+        for ( std::size_t i = 0; i != sizeof( U ) / 8; ++i )
+        {
+            wa[i] = select_bits( c, wa[i], wb[i] );
+        }
+
+        U result;
+        std::memcpy( &result, wa, sizeof( U ) );
+        return result;
+    }
+    else
+    {
+        return c ? a : b;
+    }
+}
+
+// optional's content if present, otherwise a value-initialized T, without a branch:
+// select the address to read from, the content or a local T{}, so that the indeterminate
+// bytes of an empty optional are never read.
+
+template< typename T >
+optfun_force_inline T value_or_default( optional<T> const & o, bool present )
+{
+    if constexpr ( std::is_trivially_copyable_v< optional<T> > )
+    {
+        // the offset of the content is the same for every optional<T>, it folds to a constant:
+
+        optional<T> const probe( T{} );
+
+        std::ptrdiff_t const offset =
+            reinterpret_cast<char const *>( std::addressof( *probe ) ) -
+            reinterpret_cast<char const *>( std::addressof(  probe ) );
+
+        T const zero{};
+
+        char const * const content = reinterpret_cast<char const *>( std::addressof( o ) ) + offset;
+        char const * const source  = select( present, content, reinterpret_cast<char const *>( std::addressof( zero ) ) );
+
+        T result;
+        std::memcpy( &result, source, sizeof( T ) );
+        return result;
+    }
+    else
+    {
+        return present ? *o : T{};
+    }
+}
+
+// an optional_ref's content if present; a null reference cannot be read unconditionally:
+
+template< typename T >
+optfun_force_inline std::remove_const_t<T> value_or_default( optional_ref<T> const & o, bool present )
+{
+    return present ? *o : std::remove_const_t<T>{};
+}
+
+} // namespace detail
+
+// function_ref<R(Args...)>: non-owning reference to a callable, two pointers in size;
+// pass it to an adaptor so that a large or stateful callable is never copied:
+// - the callable must outlive the function_ref, as with a reference,
+// - a function or a function pointer is stored as a pointer to the function, by value.
+
+template< typename Signature >
+class function_ref;
+
+template< typename R, typename... Args >
+class function_ref< R( Args... ) >
+{
+public:
+    template< typename F, typename = std::enable_if_t<
+        ! std::is_same_v< std::decay_t<F>, function_ref > && std::is_invocable_r_v< R, F &, Args... > >
+    >
+    function_ref( F && f ) noexcept
+    {
+        using Fn = std::remove_reference_t<F>;
+
+        if constexpr ( std::is_pointer_v< std::remove_cv_t<Fn> > && std::is_function_v< std::remove_pointer_t< std::remove_cv_t<Fn> > > )
+        {
+            // a function pointer, likely a temporary like &f, is stored by value:
+
+            using Fp = std::remove_cv_t<Fn>;
+
+            storage_.function = reinterpret_cast<void (*)()>( f );
+            call_ = []( storage s, Args... args ) -> R
+            {
+                return std::invoke( reinterpret_cast<Fp>( s.function ), std::forward<Args>( args )... );
+            };
+        }
+        else if constexpr ( std::is_function_v<Fn> )
+        {
+            storage_.function = reinterpret_cast<void (*)()>( &f );
+            call_ = []( storage s, Args... args ) -> R
+            {
+                return std::invoke( reinterpret_cast<Fn *>( s.function ), std::forward<Args>( args )... );
+            };
+        }
+        else
+        {
+            storage_.object = std::addressof( f );
+            call_ = []( storage s, Args... args ) -> R
+            {
+                return std::invoke( *static_cast<Fn *>( const_cast<void *>( s.object ) ), std::forward<Args>( args )... );
+            };
+        }
+    }
+
+    optfun_force_inline R operator()( Args... args ) const
+    {
+        return call_( storage_, std::forward<Args>( args )... );
+    }
+
+private:
+    union storage
+    {
+        void const * object;
+        void (*function)();
+    };
+
+    storage storage_;
+    R (*call_)( storage, Args... );
+};
+
+// map(f):
+// - perform operation `U f(T)` on optional's content if present and return an optional<U>.
+// - perform operation `void f(T)` on optional's content if present and return an optional<monostate>..
+
+template< typename F, typename Hint = hint_none >
+struct map
+{
+    optfun_no_unique_address F f;
+
+    optfun_force_inline map( F f_ )
+    : f( std::move( f_ ) ) {}
+
+    template< typename H >
+    optfun_force_inline map( map<F,H> const & other )
+    : f( other.f ) { optfun_stage_name_from( other ) }
+
+    optfun_stage_name( map, "map" )
+
+    optfun_force_inline map<F, hint_likely  > likely()   const { return *this; }
+    optfun_force_inline map<F, hint_unlikely> unlikely() const { return *this; }
+
+    // map(f): perform operation `U f(T)` on optional's
+    // content if present and return an optional<U>.
+
+    template< typename O, typename T = detail::optional_value_t<O> >
+    optfun_force_inline std::enable_if_t<
+        !std::is_void_v< detail::invoke_result_t< F, detail::content_t<O> > >
+        , optional< std::decay_t< detail::invoke_result_t< F, detail::content_t<O> > > >
     >
-    operator()( optional<T> const & o ) const
+    operator()( O const & o ) const
+    {
+        if ( detail::present( has_value( o ), detail::input_hint_t< Hint, O >() ) )
+        {
+            return detail::invoke_present<Hint>( f, *o );
+        }
+        return nullopt;
+    }
+
+    // map(f): perform operation `void f(T)` on optional's
+    // content if present and return an optional<monostate>.
+
+    template< typename O, typename T = detail::optional_value_t<O> >
+    optfun_force_inline std::enable_if_t<
+        std::is_void_v< detail::invoke_result_t< F, detail::content_t<O> > >
+        , optional< monostate >
+    >
+    operator()( O const & o ) const
+    {
+        if ( detail::present( has_value( o ), detail::input_hint_t< Hint, O >() ) )
+        {
+            detail::invoke_present<Hint>( f, *o );
+            return monostate{};
+        }
+        return nullopt;
+    }
+};
+
+// map_or(f, u): perform operation `U f(T)` on optional's
+// content if present and return it, otherwise return u.
+
+template< typename F, typename U, typename Hint = hint_none >
+struct map_or
+{
+    optfun_no_unique_address F f;
+    optfun_no_unique_address U u;
+
+    optfun_force_inline map_or( F f_, U const & u_ )
+    : f( std::move( f_ ) ), u( u_) {}
+
+    template< typename H >
+    optfun_force_inline map_or( map_or<F,U,H> const & other )
+    : f( other.f ), u( other.u ) { optfun_stage_name_from( other ) }
+
+    optfun_stage_name( map_or, "map_or" )
+    optfun_stage_skips( never )
+
+    optfun_force_inline map_or<F, U, hint_likely  > likely()   const { return *this; }
+    optfun_force_inline map_or<F, U, hint_unlikely> unlikely() const { return *this; }
+
+    template< typename O, typename T = detail::optional_value_t<O> >
+    optfun_force_inline U
+    operator()( O const & o ) const
+    {
+        if ( detail::present( has_value( o ), detail::input_hint_t< Hint, O >() ) )
+        {
+            return detail::invoke_present<Hint>( f, *o );
+        }
+        return u;
+    }
+};
+
+// map_branchless(f): perform operation `U f(T)` on optional's content
+// or on a default-constructed T and select the optional<U> result without a branch:
+// - for trivially copyable T and U and a cheap `U f(T)` without side effects,
+// - a win over map(f) if presence is unpredictable.
+
+template< typename F >
+struct map_branchless
+{
+    optfun_no_unique_address F f;
+
+    optfun_force_inline map_branchless( F f_ )
+    : f( std::move( f_ ) ) {}
+
+    optfun_stage_name( map_branchless, "map_branchless" )
+    optfun_stage_skips( never )
+
+    template< typename O, typename T = detail::optional_value_t<O> >
+    optfun_force_inline optional< std::decay_t< std::invoke_result_t<F,T> > >
+    operator()( O const & o ) const
+    {
+        using U = std::decay_t< std::invoke_result_t<F,T> >;
+
+        static_assert( detail::is_branchless_safe<T>::value, "map_branchless(f): T must be trivially copyable and default-constructible" );
+        static_assert( detail::is_branchless_safe<U>::value, "map_branchless(f): result of f must be trivially copyable and default-constructible" );
+
+        bool const present = has_value( o );
+
+        optional<U> const some( detail::invoke( f, detail::value_or_default( o, present ) ) );
+        optional<U>       none( some );
+        none.reset();
+
+        return detail::select( present, some, none );
+    }
+};
+
+// map_or_branchless(f, u): perform operation `U f(T)` on optional's content
+// or on a default-constructed T and select between its result and u without a branch:
+// - for trivially copyable T and U and a cheap `U f(T)` without side effects,
+// - a win over map_or(f, u) if presence is unpredictable.
+
+template< typename F, typename U >
+struct map_or_branchless
+{
+    optfun_no_unique_address F f;
+    optfun_no_unique_address U u;
+
+    optfun_force_inline map_or_branchless( F f_, U const & u_ )
+    : f( std::move( f_ ) ), u( u_) {}
+
+    optfun_stage_name( map_or_branchless, "map_or_branchless" )
+    optfun_stage_skips( never )
+
+    template< typename O, typename T = detail::optional_value_t<O> >
+    optfun_force_inline U
+    operator()( O const & o ) const
+    {
+        static_assert( detail::is_branchless_safe<T>::value, "map_or_branchless(f, u): T must be trivially copyable and default-constructible" );
+        static_assert( detail::is_branchless_safe<U>::value, "map_or_branchless(f, u): U must be trivially copyable and default-constructible" );
+
+        bool const present = has_value( o );
+
+        U const mapped = detail::invoke( f, detail::value_or_default( o, present ) );
+
+        return detail::select( present, mapped, u );
+    }
+};
+
+// map_or_else(f, u): perform operation `U f(T)` on optional's
+// content if present and return it, otherwise return operation u().
+
+template< typename F, typename U, typename Hint = hint_none >
+struct map_or_else
+{
+    optfun_no_unique_address F f;
+    optfun_no_unique_address U u;
+
+    optfun_force_inline map_or_else( F f_, U u_ )
+    : f( std::move( f_ ) ), u( std::move( u_ ) ) {}
+
+    template< typename H >
+    optfun_force_inline map_or_else( map_or_else<F,U,H> const & other )
+    : f( other.f ), u( other.u ) { optfun_stage_name_from( other ) }
+
+    optfun_stage_name( map_or_else, "map_or_else" )
+    optfun_stage_skips( never )
+
+    optfun_force_inline map_or_else<F, U, hint_likely  > likely()   const { return *this; }
+    optfun_force_inline map_or_else<F, U, hint_unlikely> unlikely() const { return *this; }
+
+    template< typename O, typename T = detail::optional_value_t<O> >
+    optfun_force_inline std::invoke_result_t<U>
+    operator()( O const & o ) const
+    {
+        if ( detail::present( has_value( o ), detail::input_hint_t< Hint, O >() ) )
+        {
+            return detail::invoke_present<Hint>( f, *o );
+        }
+        return detail::invoke_empty<Hint>( u );
+    }
+};
+
+// and_then(f): return operation `optional<U> f(T)` on optional's
+// content if present and return an optional<U>.
+
+template< typename F, typename Hint = hint_none >
+struct and_then
+{
+    optfun_no_unique_address F f;
+
+    optfun_force_inline and_then( F f_ )
+    : f( std::move( f_ ) ) {}
+
+    template< typename H >
+    optfun_force_inline and_then( and_then<F,H> const & other )
+    : f( other.f ) { optfun_stage_name_from( other ) }
+
+    optfun_stage_name( and_then, "and_then" )
+
+    optfun_force_inline and_then<F, hint_likely  > likely()   const { return *this; }
+    optfun_force_inline and_then<F, hint_unlikely> unlikely() const { return *this; }
+
+    template< typename O, typename T = detail::optional_value_t<O> >
+    optfun_force_inline detail::invoke_result_t< F, detail::content_t<O> >
+    operator()( O const & o ) const
+    {
+        if ( detail::present( has_value( o ), detail::input_hint_t< Hint, O >() ) )
+        {
+            return detail::invoke_present<Hint>( f, *o );
+        }
+        return nullopt;
+    }
+};
+
+// alias then to and_then:
+
+template< typename F, typename Hint = hint_none >
+struct then : and_then<F, Hint>
+{
+    optfun_force_inline then( F f )
+    : and_then<F, Hint>( f ) {}
+
+    template< typename H >
+    optfun_force_inline then( then<F,H> const & other )
+    : and_then<F, Hint>( other ) { optfun_stage_name_from( other ) }
+
+    optfun_stage_name( then, "then" )
+
+    optfun_force_inline then<F, hint_likely  > likely()   const { return *this; }
+    optfun_force_inline then<F, hint_unlikely> unlikely() const { return *this; }
+};
+
+// or_else(f):
+// - return the call `R f()` if optional is empty, otherwise return optional.
+// - call `void f()` and return nullopt if optional is empty, otherwise return optional.
+
+template< typename F, typename Hint = hint_none >
+struct or_else
+{
+    optfun_no_unique_address F f;
+
+    optfun_force_inline or_else( F f_ )
+    : f( std::move( f_ ) ) {}
+
+    template< typename H >
+    optfun_force_inline or_else( or_else<F,H> const & other )
+    : f( other.f ) { optfun_stage_name_from( other ) }
+
+    optfun_stage_name( or_else, "or_else" )
+    optfun_stage_skips( on_present )
+
+    optfun_force_inline or_else<F, hint_likely  > likely()   const { return *this; }
+    optfun_force_inline or_else<F, hint_unlikely> unlikely() const { return *this; }
+
+    // or_else(f): return the call `R f()` if optional is empty, otherwise return optional.
+
+    template< typename O, typename T = detail::optional_value_t<O> >
+    optfun_force_inline typename std::enable_if_t<
+        ! std::is_void_v< std::invoke_result_t<F> >
+        , optional<T>
+    >
+    operator()( O const & o ) const
+    {
+        if ( detail::present( has_value( o ), detail::input_hint_t< Hint, O >() ) )
+        {
+            return o;
+        }
+        return detail::invoke_empty<Hint>( f );
+    }
+
+    // or_else(f): call `void f()` and return nullopt if optional is empty, otherwise return optional.
+
+    template< typename O, typename T = detail::optional_value_t<O> >
+    optfun_force_inline typename std::enable_if_t<
+        std::is_void_v< std::invoke_result_t<F> >
+        , optional<T>
+    >
+    operator()( O const & o ) const
+    {
+        if ( detail::present( has_value( o ), detail::input_hint_t< Hint, O >() ) )
+        {
+            return o;
+        }
+
+        detail::invoke_empty<Hint>( f );
+        return nullopt;
+    }
+};
+
+// and_(): return `u` if optional has content, otherwise return an empty optional.
+
+template< typename U, typename Hint = hint_none >
+struct and_
+{
+    optfun_no_unique_address U u;
+
+    optfun_force_inline and_( U const & u_ )
+    : u( u_ ) {}
+
+    template< typename H >
+    optfun_force_inline and_( and_<U,H> const & other )
+    : u( other.u ) { optfun_stage_name_from( other ) }
+
+    optfun_stage_name( and_, "and_" )
+
+    optfun_force_inline and_<U, hint_likely  > likely()   const { return *this; }
+    optfun_force_inline and_<U, hint_unlikely> unlikely() const { return *this; }
+
+    template< typename O, typename T = detail::optional_value_t<O> >
+    optfun_force_inline optional< typename std::decay<U>::type >
+    operator()( O const & o ) const
+    {
+        if ( detail::present( has_value( o ), detail::input_hint_t< Hint, O >() ) )
+        {
+            return u;
+        }
+
+        return nullopt;
+    }
+};
+
+// or_(): return the current value if non-empty, otherwise return `rhs`.
+
+template< typename U, typename Hint = hint_none >
+struct or_
+{
+    optfun_no_unique_address U u;
+
+    optfun_force_inline or_( U const & u_ )
+    : u( u_ ) {}
+
+    template< typename H >
+    optfun_force_inline or_( or_<U,H> const & other )
+    : u( other.u ) { optfun_stage_name_from( other ) }
+
+    optfun_stage_name( or_, "or_" )
+    optfun_stage_skips( on_present )
+
+    optfun_force_inline or_<U, hint_likely  > likely()   const { return *this; }
+    optfun_force_inline or_<U, hint_unlikely> unlikely() const { return *this; }
+
+    template< typename O, typename T = detail::optional_value_t<O> >
+    optfun_force_inline auto operator()( O const & o ) const
+    {
+        if ( detail::present( has_value( o ), detail::input_hint_t< Hint, O >() ) )
+        {
+            return *o;
+        }
+        return u;
+    }
+};
+
+// filter(p): return optional's content if present and `bool p(T)` holds for it,
+// otherwise return an empty optional.
+
+template< typename F, typename Hint = hint_none >
+struct filter
+{
+    optfun_no_unique_address F f;
+
+    optfun_force_inline filter( F f_ )
+    : f( std::move( f_ ) ) {}
+
+    template< typename H >
+    optfun_force_inline filter( filter<F,H> const & other )
+    : f( other.f ) { optfun_stage_name_from( other ) }
+
+    optfun_stage_name( filter, "filter" )
+
+    optfun_force_inline filter<F, hint_likely  > likely()   const { return *this; }
+    optfun_force_inline filter<F, hint_unlikely> unlikely() const { return *this; }
+
+    template< typename O, typename T = detail::optional_value_t<O> >
+    optfun_force_inline optional<T>
+    operator()( O const & o ) const
+    {
+        if ( detail::present( has_value( o ), detail::input_hint_t< Hint, O >() ) && detail::invoke_present<Hint>( f, *o ) )
+        {
+            return *o;
+        }
+        return nullopt;
+    }
+};
+
+//// take(): Take the value out of the optional, leaving it empty and return it:
+//
+//optional_f take()
+//{
+//    optional_f result; result.swap( *this );
+//    return result;
+//}
+
+namespace detail {
+
+template< typename O >
+struct is_optional_ref : std::false_type {};
+
+template< typename T >
+struct is_optional_ref< optional_ref<T> > : std::true_type {};
+
+// an rvalue optional that owns its content, like a temporary, which a reference would outlive:
+
+template< typename O >
+constexpr bool is_owning_rvalue_v = ! std::is_lvalue_reference_v<O> && ! is_optional_ref< std::decay_t<O> >::value;
+
+} // namespace detail
+
+// get(&C::m): member m of the optional's content as an optional_ref, without a copy;
+// as const as the input, like `o | get( &A::b ) | get( &B::c )`; of an rvalue optional,
+// like a temporary, an optional of the member moved out of it instead:
+
+template< typename M, typename C >
+struct get
+{
+    static_assert( ! std::is_function_v<M>, "get(&C::m): m must be a data member" );
+
+    M C::* member;
+
+    optfun_force_inline get( M C::* member_ )
+    : member( member_ ) {}
+
+    optfun_stage_name( get, "get" )
+
+    template< typename O, typename = detail::optional_value_t< std::decay_t<O> > >
+    optfun_force_inline auto operator()( O && o ) const
+    {
+        using R = std::remove_reference_t< decltype( (*o).*member ) >;
+
+        if constexpr ( detail::is_owning_rvalue_v<O> )
+        {
+            using V = std::remove_const_t<R>;
+
+            if ( has_value( o ) )
+            {
+                return optional<V>( std::move( (*o).*member ) );
+            }
+            return optional<V>();
+        }
+        else
+        {
+            if ( has_value( o ) )
+            {
+                return optional_ref<R>( (*o).*member );
+            }
+            return optional_ref<R>();
+        }
+    }
+};
+
+// get_opt(&C::m): the content of optional member m of the optional's content
+// as an optional_ref, without a copy; empty if either is empty; of an rvalue optional,
+// an optional of the content moved out of it instead:
+
+template< typename M, typename C >
+struct get_opt
+{
+    static_assert( detail::is_optional_like<M>::value, "get_opt(&C::m): m must be an optional" );
+
+    M C::* member;
+
+    optfun_force_inline get_opt( M C::* member_ )
+    : member( member_ ) {}
+
+    optfun_stage_name( get_opt, "get_opt" )
+
+    template< typename O, typename = detail::optional_value_t< std::decay_t<O> > >
+    optfun_force_inline auto operator()( O && o ) const
+    {
+        using R = std::remove_reference_t< decltype( *( (*o).*member ) ) >;
+
+        if constexpr ( detail::is_owning_rvalue_v<O> )
+        {
+            using V = std::remove_const_t<R>;
+
+            if ( has_value( o ) && has_value( (*o).*member ) )
+            {
+                return optional<V>( std::move( *( (*o).*member ) ) );
+            }
+            return optional<V>();
+        }
+        else
+        {
+            if ( has_value( o ) && has_value( (*o).*member ) )
+            {
+                return optional_ref<R>( *( (*o).*member ) );
+            }
+            return optional_ref<R>();
+        }
+    }
+};
+
+// composed(a, b): apply stage a, then stage b, like `a | b` of two stages:
+// - a pipeline to store and apply later, like `auto const p = map( f ) | and_then( g ); o | p`,
+// - stateless stages take no room, so a pipeline of distinct stateless stages is empty.
+
+template< typename A, typename B >
+struct composed
+{
+    optfun_no_unique_address A first;
+    optfun_no_unique_address B second;
+
+    optfun_force_inline composed( A a, B b )
+    : first( std::move( a ) ), second( std::move( b ) ) {}
+
+    optfun_force_inline composed named( char const * /*name*/ ) const { return *this; }
+
+    template< typename O, typename T = detail::optional_value_t<O> >
+    optfun_force_inline auto operator()( O const & o ) const
+    {
+        return o | first | second;
+    }
+};
+
+namespace detail {
+
+// stages that apply to an optional, as opposed to range stages:
+
+template< typename S, typename = void >
+struct is_stage : std::false_type {};
+
+template< typename S >
+struct is_stage< S, std::void_t< decltype( std::declval<S const &>().named( "" ) ) > > : std::true_type {};
+
+template< typename S > struct is_composed                  : std::false_type {};
+template< typename A, typename B > struct is_composed< composed<A,B> > : std::true_type {};
+
+// chains whose stages count themselves when instrumenting, see pipeline below:
+
+template< typename S > struct is_chain : is_composed<S> {};
+
+} // namespace detail
+
+// operator|(stage, stage): compose two stages:
+
+template< typename A, typename B
+    , typename = std::enable_if_t< detail::is_stage<A>::value && detail::is_stage<B>::value >
+>
+optfun_force_inline composed<A,B> operator|( A const & a, B const & b )
+{
+    return composed<A,B>( a, b );
+}
+
+// operator|(optional, algorithm): connect operation to optional, without copying it:
+
+template< typename O, typename F
+    , std::enable_if_t< detail::is_optional_like< std::decay_t<O> >::value, int > = 0
+>
+optfun_force_inline_flatten auto operator|( O && o, F const & f )
+{
+#if optfun_CONFIG_INSTRUMENT
+    if constexpr ( detail::is_chain<F>::value )
+        return detail::invoke( f, std::forward<O>( o ) );  // its stages count themselves
+    else
+        return instrument::apply( f, std::forward<O>( o ) );
+#else
+    return detail::invoke( f, std::forward<O>( o ) );
+#endif
+}
+
+//
+// pipeline:
+// - pipeline<T,U>: any chain of stages from an optional<T> to an optional<U>, chosen at runtime,
+//   like `pipeline<int, int> p = map( f ) | filter( g ); o | p`, without std::function's allocation,
+// - the chain lives in an inline buffer of Capacity bytes if it fits and moves without throwing,
+//   otherwise on the heap; the default capacity makes a pipeline one cache line in size,
+// - an evaluation is a single indirect call, apply() makes that one call per batch,
+// - an empty pipeline yields an empty optional.
+//
+
+namespace detail {
+
+template< typename S, typename T, typename U, typename = void >
+struct is_chain_of : std::false_type {};
+
+template< typename S, typename T, typename U >
+struct is_chain_of< S, T, U, std::void_t< decltype( std::declval< optional<T> const & >() | std::declval< S const & >() ) > >
+    : std::is_convertible< decltype( std::declval< optional<T> const & >() | std::declval< S const & >() ), optional<U> > {};
+
+} // namespace detail
+
+template< typename T, typename U, std::size_t Capacity = 6 * sizeof( void * ) >
+class pipeline
+{
+    static_assert( Capacity >= sizeof( void * ), "pipeline requires a capacity of at least a pointer" );
+
+public:
+    pipeline() noexcept = default;
+
+    template< typename S, typename = std::enable_if_t< std::conjunction_v<
+        std::negation< std::is_same< std::decay_t<S>, pipeline > >, detail::is_chain_of< std::decay_t<S>, T, U > > >
+    >
+    pipeline( S && s )
+    {
+        using C = std::decay_t<S>;
+
+        static_assert( std::is_copy_constructible_v<C>, "pipeline<T,U>: the chain must be copy-constructible like the pipeline itself; pass a move-only callable via function_ref" );
+
+        if constexpr ( fits_inline<C>() )
+        {
+            ::new( static_cast<void *>( buffer_ ) ) C( std::forward<S>( s ) );
+            ops_ = &inline_ops<C>;
+        }
+        else
+        {
+            ::new( static_cast<void *>( buffer_ ) ) C *( new C( std::forward<S>( s ) ) );
+            ops_ = &heap_ops<C>;
+        }
+    }
+
+    pipeline( pipeline const & other )
+    : ops_( other.ops_ )
+    {
+        ops_->copy( other.buffer_, buffer_ );
+    }
+
+    pipeline( pipeline && other ) noexcept
+    : ops_( other.ops_ )
+    {
+        ops_->move( other.buffer_, buffer_ );
+        other.ops_ = &empty_ops;
+    }
+
+    pipeline & operator=( pipeline const & other )
+    {
+        if ( this != &other )
+        {
+            pipeline copy( other );
+            *this = std::move( copy );
+        }
+        return *this;
+    }
+
+    pipeline & operator=( pipeline && other ) noexcept
+    {
+        if ( this != &other )
+        {
+            ops_->destroy( buffer_ );
+            ops_ = other.ops_;
+            ops_->move( other.buffer_, buffer_ );
+            other.ops_ = &empty_ops;
+        }
+        return *this;
+    }
+
+    ~pipeline()
+    {
+        ops_->destroy( buffer_ );
+    }
+
+    explicit operator bool() const noexcept { return ops_ != &empty_ops; }
+
+    // true if the chain is held in the inline buffer, or if there is none:
+
+    bool is_inline() const noexcept { return ops_->is_inline; }
+
+    optfun_force_inline pipeline named( char const * /*name*/ ) const { return *this; }
+
+    optfun_force_inline optional<U> operator()( optional<T> const & o ) const
+    {
+        return ops_->call( buffer_, o );
+    }
+
+    // apply(in, size, out): out[i] = in[i] | chain for all i < size;
+    // in may be out to apply the chain in place:
+
+    void apply( optional<T> const * in, std::size_t size, optional<U> * out ) const
+    {
+        ops_->apply( buffer_, in, size, out );
+    }
+
+    // apply(in, out): the same for contiguous ranges, like std::vector or std::span,
+    // out must be at least as large as in:
+
+    template< typename In, typename Out >
+    void apply( In const & in, Out && out ) const
+    {
+        assert( std::size( out ) >= std::size( in ) );
+
+        apply( std::data( in ), std::size( in ), std::data( out ) );
+    }
+
+private:
+    struct operations
+    {
+        optional<U> (*call)( void const * chain, optional<T> const & o );
+        void (*apply)( void const * chain, optional<T> const * in, std::size_t size, optional<U> * out );
+        void (*copy)( void const * from, void * to );
+        void (*move)( void * from, void * to ) noexcept;
+        void (*destroy)( void * chain ) noexcept;
+        bool is_inline;
+    };
+
+    template< typename C >
+    static constexpr bool fits_inline()
+    {
+        return sizeof( C ) <= Capacity && alignof( C ) <= alignof( std::max_align_t )
+            && std::is_nothrow_move_constructible_v<C>;
+    }
+
+    // the chain in the buffer, or a pointer to it in the buffer:
+
+    template< typename C >
+    static C const & chain( void const * buffer )
+    {
+        if constexpr ( fits_inline<C>() )
+            return *std::launder( static_cast<C const *>( buffer ) );
+        else
+            return **std::launder( static_cast<C * const *>( buffer ) );
+    }
+
+    template< typename C >
+    static optional<U> call( void const * buffer, optional<T> const & o )
+    {
+        return o | chain<C>( buffer );
+    }
+
+    template< typename C >
+    static void apply_n( void const * buffer, optional<T> const * in, std::size_t size, optional<U> * out )
+    {
+        C const & c = chain<C>( buffer );
+
+        for ( std::size_t i = 0; i != size; ++i )
+        {
+            out[i] = in[i] | c;
+        }
+    }
+
+    // the constructor asserts that C is copyable; the test keeps that assertion the only error:
+
+    template< typename C >
+    static void copy_inline( void const * from, void * to )
+    {
+        if constexpr ( std::is_copy_constructible_v<C> )
+            ::new( to ) C( chain<C>( from ) );
+    }
+
+    template< typename C >
+    static void move_inline( void * from, void * to ) noexcept
+    {
+        C * const c = std::launder( static_cast<C *>( from ) );
+        ::new( to ) C( std::move( *c ) );
+        c->~C();
+    }
+
+    template< typename C >
+    static void destroy_inline( void * buffer ) noexcept
+    {
+        std::launder( static_cast<C *>( buffer ) )->~C();
+    }
+
+    template< typename C >
+    static void copy_heap( void const * from, void * to )
+    {
+        if constexpr ( std::is_copy_constructible_v<C> )
+            ::new( to ) C *( new C( chain<C>( from ) ) );
+    }
+
+    static void move_pointer( void * from, void * to ) noexcept
+    {
+        std::memcpy( to, from, sizeof( void * ) );
+    }
+
+    template< typename C >
+    static void destroy_heap( void * buffer ) noexcept
+    {
+        delete *std::launder( static_cast<C **>( buffer ) );
+    }
+
+    static optional<U> call_empty( void const *, optional<T> const & )
+    {
+        return nullopt;
+    }
+
+    static void apply_empty( void const *, optional<T> const *, std::size_t size, optional<U> * out )
+    {
+        std::fill_n( out, size, optional<U>() );
+    }
+
+    static void copy_empty( void const *, void * ) {}
+    static void move_empty( void *, void * ) noexcept {}
+    static void destroy_empty( void * ) noexcept {}
+
+    template< typename C >
+    static constexpr operations inline_ops = { &call<C>, &apply_n<C>, &copy_inline<C>, &move_inline<C>, &destroy_inline<C>, true };
+
+    template< typename C >
+    static constexpr operations heap_ops = { &call<C>, &apply_n<C>, &copy_heap<C>, &move_pointer, &destroy_heap<C>, false };
+
+    static constexpr operations empty_ops = { &call_empty, &apply_empty, &copy_empty, &move_empty, &destroy_empty, true };
+
+    alignas( std::max_align_t ) unsigned char buffer_[ Capacity ];
+
+    operations const * ops_ = &empty_ops;
+};
+
+namespace detail {
+
+template< typename T, typename U, std::size_t N > struct is_chain< pipeline<T,U,N> > : std::true_type {};
+
+} // namespace detail
+
+//
+// null-skipping aggregates:
+// - terminal stages over a range of optionals, like a std::vector or std::span of them,
+//   or over a nullable_view: values plus an Arrow-compatible validity bitmap,
+// - use as `v | sum_present()` or `sum_present()( v )`,
+// - min_present(), max_present() and mean_present() yield an empty optional if no value is present.
+//
+
+// nullable_view: values with a validity bitmap, bit i of byte i/8 (LSB first)
+// set if value i is present; a null bitmap means all values are present.
+
+template< typename T >
+class nullable_view
+{
+public:
+    using value_type = T;
+
+    nullable_view( T const * values, std::uint8_t const * validity, std::size_t size )
+    : values_( values ), validity_( validity ), size_( size ) {}
+
+    std::size_t          size()     const { return size_; }
+    T const *            values()   const { return values_; }
+    std::uint8_t const * validity() const { return validity_; }
+
+    bool valid( std::size_t i ) const
+    {
+        return validity_ == nullptr || ( ( unsigned( validity_[ i / 8 ] ) >> ( i % 8 ) ) & 1u );
+    }
+
+    optional<T> operator[]( std::size_t i ) const
+    {
+        return valid( i ) ? optional<T>( values_[i] ) : optional<T>();
+    }
+
+    // random-access iteration yields optional<T>, like `for ( optional<T> o : v )`:
+
+    class const_iterator
+    {
+    public:
+        using iterator_category = std::random_access_iterator_tag;
+        using value_type        = optional<T>;
+        using difference_type   = std::ptrdiff_t;
+        using pointer           = void;
+        using reference         = optional<T>;
+
+        const_iterator() = default;
+
+        const_iterator( nullable_view const & view, std::size_t pos )
+        : view_( view ), pos_( pos ) {}
+
+        reference operator*() const { return view_[ pos_ ]; }
+        reference operator[]( difference_type n ) const { return view_[ pos_ + static_cast<std::size_t>( n ) ]; }
+
+        const_iterator & operator++() { ++pos_; return *this; }
+        const_iterator & operator--() { --pos_; return *this; }
+        const_iterator   operator++( int ) { const_iterator result( *this ); ++pos_; return result; }
+        const_iterator   operator--( int ) { const_iterator result( *this ); --pos_; return result; }
+
+        const_iterator & operator+=( difference_type n ) { pos_ += static_cast<std::size_t>( n ); return *this; }
+        const_iterator & operator-=( difference_type n ) { pos_ -= static_cast<std::size_t>( n ); return *this; }
+
+        friend const_iterator  operator+( const_iterator it, difference_type n ) { return it += n; }
+        friend const_iterator  operator+( difference_type n, const_iterator it ) { return it += n; }
+        friend const_iterator  operator-( const_iterator it, difference_type n ) { return it -= n; }
+        friend difference_type operator-( const_iterator a, const_iterator b ) { return static_cast<difference_type>( a.pos_ - b.pos_ ); }
+
+        friend bool operator==( const_iterator a, const_iterator b ) { return a.pos_ == b.pos_; }
+        friend bool operator!=( const_iterator a, const_iterator b ) { return a.pos_ != b.pos_; }
+        friend bool operator< ( const_iterator a, const_iterator b ) { return a.pos_ <  b.pos_; }
+        friend bool operator> ( const_iterator a, const_iterator b ) { return a.pos_ >  b.pos_; }
+        friend bool operator<=( const_iterator a, const_iterator b ) { return a.pos_ <= b.pos_; }
+        friend bool operator>=( const_iterator a, const_iterator b ) { return a.pos_ >= b.pos_; }
+
+    private:
+        nullable_view<T> view_ = nullable_view<T>( nullptr, nullptr, 0 );
+        std::size_t      pos_  = 0;
+    };
+
+    const_iterator begin() const { return const_iterator( *this, 0 ); }
+    const_iterator end()   const { return const_iterator( *this, size_ ); }
+
+private:
+    T const *            values_;
+    std::uint8_t const * validity_;
+    std::size_t          size_;
+};
+
+namespace detail {
+
+// tag of stages that take a range instead of an optional:
+
+struct range_stage {};
+
+template< typename T > struct is_optional              : std::false_type {};
+template< typename T > struct is_optional< optional<T> > : std::true_type {};
+
+// type of the optionals' content of a range:
+
+template< typename R >
+struct range_value
+{
+    using type = typename std::decay_t< decltype( *std::begin( std::declval<R const &>() ) ) >::value_type;
+};
+
+template< typename T >
+struct range_value< nullable_view<T> >
+{
+    using type = T;
+};
+
+template< typename R >
+using range_value_t = typename range_value<R>::type;
+
+template< typename T >
+using sum_t = decltype( std::declval<T>() + std::declval<T>() );
+
+inline int popcount64( std::uint64_t w )
+{
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_popcountll( w );
+#else
+    w = w - ( ( w >> 1 ) & 0x5555555555555555ull );
+    w = ( w & 0x3333333333333333ull ) + ( ( w >> 2 ) & 0x3333333333333333ull );
+    w = ( w + ( w >> 4 ) ) & 0x0f0f0f0f0f0f0f0full;
+    return static_cast<int>( ( w * 0x0101010101010101ull ) >> 56 );
+#endif
+}
+
+// 64 validity bits starting at byte p, bit i of the result is value i; independent of endianness:
+
+inline std::uint64_t load_bits64( std::uint8_t const * p )
+{
+    std::uint64_t w = 0;
+    for ( int k = 0; k != 8; ++k )
+    {
+        w |= std::uint64_t( p[k] ) << ( 8 * k );
+    }
+    return w;
+}
+
+// feed the present values of a range of optionals to an accumulator and return it; an accumulator
+// with a branchless add_masked() gets every element, selecting a neutral value for absent ones.
+// The accumulator is taken by value, so that it cannot alias the values and stays in registers:
+
+template< typename Acc, typename R >
+Acc accumulate( Acc acc, R const & r )
+{
+    using T = range_value_t<R>;
+
+    for ( auto const & o : r )
+    {
+        bool const present = has_value( o );
+
+        if constexpr ( Acc::branchless && is_branchless_safe<T>::value )
+        {
+            acc.add_masked( value_or_default( o, present ), present );
+        }
+        else if ( present )
+        {
+            acc.add( *o );
+        }
+    }
+    return acc;
+}
+
+// feed the present values of a nullable_view to an accumulator, 64 at a time: dense
+// runs without a branch per element, so they vectorize, empty runs are skipped:
+
+template< typename Acc, typename T >
+Acc accumulate( Acc acc, nullable_view<T> const & v )
+{
+    T const * const x = v.values();
+    std::size_t const n = v.size();
+
+    if ( v.validity() == nullptr )
+    {
+        for ( std::size_t i = 0; i != n; ++i )
+            acc.add( x[i] );
+        return acc;
+    }
+
+    std::size_t i = 0;
+
+    for ( ; i + 64 <= n; i += 64 )
+    {
+        std::uint64_t const w = load_bits64( v.validity() + i / 8 );
+
+        if ( w == ~std::uint64_t( 0 ) )
+        {
+            for ( std::size_t k = 0; k != 64; ++k )
+                acc.add( x[i + k] );
+        }
+        else if ( w != 0 )
+        {
+            for ( std::size_t k = 0; k != 64; ++k )
+            {
+                bool const present = ( w >> k ) & 1u;
+
+                if constexpr ( Acc::branchless && is_branchless_safe<T>::value )
+                    acc.add_masked( x[i + k], present );
+                else if ( present )
+                    acc.add( x[i + k] );
+            }
+        }
+    }
+
+    for ( ; i != n; ++i )
+    {
+        if ( v.valid( i ) )
+            acc.add( x[i] );
+    }
+    return acc;
+}
+
+template< typename S >
+struct sum_acc
+{
+    static constexpr bool branchless = std::is_arithmetic_v<S>;
+
+    S sum = S();
+
+    template< typename T >
+    void add( T const & x ) { sum += x; }
+
+    template< typename T >
+    void add_masked( T const & x, bool present ) { sum += select( present, S( x ), S() ); }
+};
+
+struct count_acc
+{
+    static constexpr bool branchless = true;
+
+    std::size_t count = 0;
+
+    template< typename T >
+    void add( T const & ) { ++count; }
+
+    template< typename T >
+    void add_masked( T const &, bool present ) { count += present; }
+};
+
+// running minimum or maximum; for arithmetic types seeded with the extreme value,
+// infinity for floating point, so that there is no first-value branch, and with the
+// count to tell if any was present; a present NaN makes the result NaN:
+
+template< typename T, typename Less >
+struct extreme_acc
+{
+    static constexpr bool branchless = std::is_arithmetic_v<T>;
+
+    T           best  = seed();
+    std::size_t count = 0;
+
+    static T seed()
+    {
+        if constexpr ( std::is_floating_point_v<T> )
+            return Less()( 0, 1 ) ? std::numeric_limits<T>::infinity() : -std::numeric_limits<T>::infinity();
+        else if constexpr ( std::is_arithmetic_v<T> )
+            return Less()( 0, 1 ) ? std::numeric_limits<T>::max() : std::numeric_limits<T>::lowest();
+        else
+            return T();
+    }
+
+    // x replaces best if it is better or NaN; a NaN best is never replaced, as no comparison holds:
+
+    static bool better( T const & x, T const & best_ )
+    {
+        if constexpr ( std::is_floating_point_v<T> )
+            return Less()( x, best_ ) || x != x;
+        else
+            return Less()( x, best_ );
+    }
+
+    void add( T const & x )
+    {
+        if constexpr ( std::is_arithmetic_v<T> )
+            best = better( x, best ) ? x : best;
+        else
+            best = count == 0 || Less()( x, best ) ? x : best;
+        ++count;
+    }
+
+    void add_masked( T const & x, bool present )
+    {
+        best   = select( present && better( x, best ), x, best );
+        count += present;
+    }
+
+    optional<T> result() const
+    {
+        return count ? optional<T>( best ) : optional<T>();
+    }
+};
+
+template< typename S >
+struct mean_acc
+{
+    static constexpr bool branchless = true;
+
+    sum_acc<S> sum;
+    count_acc  count;
+
+    template< typename T >
+    void add( T const & x ) { sum.add( x ); count.add( x ); }
+
+    template< typename T >
+    void add_masked( T const & x, bool present ) { sum.add_masked( x, present ); count.add_masked( x, present ); }
+};
+
+template< typename U, typename Op >
+struct fold_acc
+{
+    static constexpr bool branchless = false;
+
+    U  acc;
+    Op op;
+
+    template< typename T >
+    void add( T const & x ) { acc = detail::invoke( op, acc, x ); }
+};
+
+} // namespace detail
+
+// count_present(): number of present values:
+
+struct count_present : detail::range_stage
+{
+    template< typename R >
+    std::size_t operator()( R const & r ) const
+    {
+        auto const acc = detail::accumulate( detail::count_acc(), r );
+        return acc.count;
+    }
+
+    template< typename T >
+    std::size_t operator()( nullable_view<T> const & v ) const
+    {
+        if ( v.validity() == nullptr )
+            return v.size();
+
+        std::size_t count = 0;
+        std::size_t i = 0;
+
+        for ( ; i + 64 <= v.size(); i += 64 )
+        {
+            count += static_cast<std::size_t>( detail::popcount64( detail::load_bits64( v.validity() + i / 8 ) ) );
+        }
+        for ( ; i != v.size(); ++i )
+        {
+            count += v.valid( i );
+        }
+        return count;
+    }
+};
+
+// sum_present(): sum of present values, zero if none:
+
+struct sum_present : detail::range_stage
+{
+    template< typename R >
+    detail::sum_t< detail::range_value_t<R> > operator()( R const & r ) const
+    {
+        auto const acc = detail::accumulate( detail::sum_acc< detail::sum_t< detail::range_value_t<R> > >(), r );
+        return acc.sum;
+    }
+};
+
+// min_present(), max_present(): smallest, largest present value, if any:
+
+struct min_present : detail::range_stage
+{
+    template< typename R >
+    optional< detail::range_value_t<R> > operator()( R const & r ) const
+    {
+        auto const acc = detail::accumulate( detail::extreme_acc< detail::range_value_t<R>, std::less<> >(), r );
+        return acc.result();
+    }
+};
+
+struct max_present : detail::range_stage
+{
+    template< typename R >
+    optional< detail::range_value_t<R> > operator()( R const & r ) const
+    {
+        auto const acc = detail::accumulate( detail::extreme_acc< detail::range_value_t<R>, std::greater<> >(), r );
+        return acc.result();
+    }
+};
+
+// mean_present(): arithmetic mean of present values, if any; integers are summed
+// in a 64-bit integer, floating point values in a double:
+
+struct mean_present : detail::range_stage
+{
+    template< typename R >
+    optional<double> operator()( R const & r ) const
+    {
+        using T = detail::range_value_t<R>;
+
+        static_assert( std::is_arithmetic_v<T>, "mean_present() requires an arithmetic value type" );
+
+        using S = std::conditional_t< std::is_floating_point_v<T>, double
+                , std::conditional_t< std::is_signed_v<T>, long long, unsigned long long > >;
+
+        auto const acc = detail::accumulate( detail::mean_acc<S>(), r );
+
+        return acc.count.count
+            ? optional<double>( static_cast<double>( acc.sum.sum ) / static_cast<double>( acc.count.count ) )
+            : optional<double>();
+    }
+};
+
+// fold_present(op, init): left fold `U op(U, T)` over the present values, starting with init:
+
+template< typename Op, typename U >
+struct fold_present : detail::range_stage
+{
+    Op op;
+    U  init;
+
+    fold_present( Op op_, U init_ )
+    : op( op_ ), init( init_ ) {}
+
+    template< typename R >
+    U operator()( R const & r ) const
+    {
+        auto const acc = detail::accumulate( detail::fold_acc<U, Op>{ init, op }, r );
+        return acc.acc;
+    }
+};
+
+//
+// collect:
+// - collect<Container>(r), r | collect<Container>(): optional container with the
+//   values of range r if all are present, nullopt at the first empty optional,
+// - reserves once if the range and the container allow, moves values out of an rvalue range,
+// - Container defaults to std::vector<T>; use small_vector<T,N> to avoid allocation for short ranges.
+//
+
+// small_vector<T,N>: vector with inline capacity for N elements, which
+// continues on the heap like std::vector if it grows beyond N:
+
+template< typename T, std::size_t N >
+class small_vector
+{
+    static_assert( N > 0, "small_vector requires an inline capacity of at least one element" );
+
+public:
+    using value_type      = T;
+    using size_type       = std::size_t;
+    using reference       = T &;
+    using const_reference = T const &;
+    using iterator        = T *;
+    using const_iterator  = T const *;
+
+    small_vector() = default;
+
+    small_vector( std::initializer_list<T> il )
+    {
+        reserve( il.size() );
+        for ( auto const & x : il )
+            emplace_back( x );
+    }
+
+    small_vector( small_vector const & other )
+    {
+        reserve( other.size() );
+        for ( auto const & x : other )
+            emplace_back( x );
+    }
+
+    small_vector( small_vector && other ) noexcept( std::is_nothrow_move_constructible_v<T> )
+    {
+        take( other );
+    }
+
+    small_vector & operator=( small_vector const & other )
+    {
+        if ( this != &other )
+        {
+            clear();
+            reserve( other.size() );
+            for ( auto const & x : other )
+                emplace_back( x );
+        }
+        return *this;
+    }
+
+    small_vector & operator=( small_vector && other ) noexcept( std::is_nothrow_move_constructible_v<T> )
+    {
+        if ( this != &other )
+        {
+            clear();
+            release();
+            take( other );
+        }
+        return *this;
+    }
+
+    ~small_vector()
+    {
+        clear();
+        release();
+    }
+
+    size_type size()      const { return size_; }
+    size_type capacity()  const { return capacity_; }
+    bool      empty()     const { return size_ == 0; }
+    bool      is_inline() const { return data_ == inline_data(); }
+
+    T       * data()       { return data_; }
+    T const * data() const { return data_; }
+
+    iterator       begin()       { return data_; }
+    iterator       end()         { return data_ + size_; }
+    const_iterator begin() const { return data_; }
+    const_iterator end()   const { return data_ + size_; }
+
+    reference       operator[]( size_type i )       { return data_[i]; }
+    const_reference operator[]( size_type i ) const { return data_[i]; }
+
+    reference       back()       { return data_[ size_ - 1 ]; }
+    const_reference back() const { return data_[ size_ - 1 ]; }
+
+    void reserve( size_type n )
+    {
+        if ( n > capacity_ )
+        {
+            T * const p = std::allocator<T>().allocate( n );
+            relocate( p, n );
+        }
+    }
+
+    template< typename... Args >
+    reference emplace_back( Args &&... args )
+    {
+        if ( size_ == capacity_ )
+        {
+            // construct first, args may refer to an element:
+            size_type const n = 2 * capacity_;
+            T * const p = std::allocator<T>().allocate( n );
+            ::new( static_cast<void *>( p + size_ ) ) T( std::forward<Args>( args )... );
+            relocate( p, n );
+        }
+        else
+        {
+            ::new( static_cast<void *>( data_ + size_ ) ) T( std::forward<Args>( args )... );
+        }
+        return data_[ size_++ ];
+    }
+
+    void push_back( T const & x ) { emplace_back( x ); }
+    void push_back( T &&      x ) { emplace_back( std::move( x ) ); }
+
+    void pop_back()
+    {
+        data_[ --size_ ].~T();
+    }
+
+    void resize( size_type n )
+    {
+        reserve( n );
+        if ( n < size_ )
+            std::destroy( data_ + n, data_ + size_ );
+        else
+            std::uninitialized_value_construct( data_ + size_, data_ + n );
+        size_ = n;
+    }
+
+    void clear()
+    {
+        std::destroy( begin(), end() );
+        size_ = 0;
+    }
+
+    friend bool operator==( small_vector const & a, small_vector const & b )
+    {
+        return a.size() == b.size() && std::equal( a.begin(), a.end(), b.begin() );
+    }
+
+    friend bool operator!=( small_vector const & a, small_vector const & b )
+    {
+        return !( a == b );
+    }
+
+private:
+    T       * inline_data()       { return reinterpret_cast<T       *>( buffer_ ); }
+    T const * inline_data() const { return reinterpret_cast<T const *>( buffer_ ); }
+
+    // move elements to new heap storage p of capacity n:
+
+    void relocate( T * p, size_type n )
+    {
+        std::uninitialized_move( begin(), end(), p );
+        std::destroy( begin(), end() );
+        release();
+        data_     = p;
+        capacity_ = n;
+    }
+
+    void release()
+    {
+        if ( ! is_inline() )
+        {
+            std::allocator<T>().deallocate( data_, capacity_ );
+            data_     = inline_data();
+            capacity_ = N;
+        }
+    }
+
+    // steal heap storage, or move inline elements; leaves other empty and inline:
+
+    void take( small_vector & other )
+    {
+        if ( other.is_inline() )
+        {
+            std::uninitialized_move( other.begin(), other.end(), inline_data() );
+            size_ = other.size_;
+            other.clear();
+        }
+        else
+        {
+            data_     = other.data_;
+            size_     = other.size_;
+            capacity_ = other.capacity_;
+
+            other.data_     = other.inline_data();
+            other.size_     = 0;
+            other.capacity_ = N;
+        }
+    }
+
+    alignas( T ) unsigned char buffer_[ N * sizeof( T ) ];
+
+    T *       data_     = inline_data();
+    size_type size_     = 0;
+    size_type capacity_ = N;
+};
+
+namespace detail {
+
+template< typename T > struct is_nullable_view                     : std::false_type {};
+template< typename T > struct is_nullable_view< nullable_view<T> > : std::true_type {};
+
+template< typename C, typename = void >
+struct has_reserve : std::false_type {};
+
+template< typename C >
+struct has_reserve< C, std::void_t< decltype( std::declval<C &>().reserve( std::size_t() ) ) > > : std::true_type {};
+
+template< typename R, typename = void >
+struct is_sized_range : std::false_type {};
+
+template< typename R >
+struct is_sized_range< R, std::void_t< decltype( std::size( std::declval<R const &>() ) ) > > : std::true_type {};
+
+// a range that owns its elements, so that they may be moved out of an rvalue of it:
+// an allocator-aware container, a small_vector or an array; the elements of a view,
+// like std::span, belong to someone else and are copied:
+
+template< typename R, typename = void >
+struct is_owning_range : std::is_array<R> {};
+
+template< typename R >
+struct is_owning_range< R, std::void_t< typename R::allocator_type > > : std::true_type {};
+
+template< typename T, std::size_t N >
+struct is_owning_range< std::array<T, N> > : std::true_type {};
+
+template< typename T, std::size_t N >
+struct is_owning_range< small_vector<T, N> > : std::true_type {};
+
+template< typename Container >
+struct collect_t : range_stage
+{
+    template< typename R >
+    auto operator()( R && r ) const
+    {
+        using T = range_value_t< std::decay_t<R> >;
+        using C = std::conditional_t< std::is_void_v<Container>, std::vector<T>, Container >;
+
+        C result;
+
+        if constexpr ( is_nullable_view< std::decay_t<R> >::value )
+        {
+            if ( count_present()( r ) != r.size() )
+                return optional<C>();
+
+            if constexpr ( has_reserve<C>::value )
+                result.reserve( r.size() );
+
+            for ( std::size_t i = 0; i != r.size(); ++i )
+                result.push_back( r.values()[i] );
+        }
+        else
+        {
+            if constexpr ( has_reserve<C>::value && is_sized_range< std::decay_t<R> >::value )
+                result.reserve( static_cast<std::size_t>( std::size( r ) ) );
+
+            for ( auto && o : r )
+            {
+                if ( ! has_value( o ) )
+                    return optional<C>();
+
+                if constexpr ( ! std::is_lvalue_reference_v<R> && is_owning_range< std::decay_t<R> >::value )
+                    result.push_back( std::move( *o ) );
+                else
+                    result.push_back( *o );
+            }
+        }
+        return optional<C>( std::move( result ) );
+    }
+};
+
+} // namespace detail
+
+template< typename Container = void >
+detail::collect_t<Container> collect()
+{
+    return detail::collect_t<Container>();
+}
+
+template< typename Container = void, typename R >
+auto collect( R && r )
+{
+    return detail::collect_t<Container>()( std::forward<R>( r ) );
+}
+
+//
+// stream compaction:
+// - compact_values(r, out[, indices]): write the present values of r densely to out,
+//   and their positions in r to indices, if given; return the number of values written,
+// - out and indices must have room for as many elements as r has, as the kernels
+//   write whole vectors or every element, not only the present ones,
+// - indices are 32-bit, like the lanes of the vector kernels: with indices, r may have
+//   at most 2^32 elements, which is asserted,
+// - values<Container>(): stage yielding the present values, like `v | values()`,
+// - with a nullable_view of 4-byte (AVX2, AVX-512F) or 8-byte (AVX-512F) values, eight or
+//   sixteen values are compacted at a time via a permutation table or compress-store;
+//   otherwise, trivially copyable values are compacted without a branch per element.
+//
+
+namespace detail {
+
+// compress_lut[m]: lanes of the set bits of m, in order; fills up with lane 0:
+
+struct compress_table
+{
+    std::uint8_t lane[256][8];
+};
+
+constexpr compress_table make_compress_table()
+{
+    compress_table t{};
+    for ( unsigned m = 0; m != 256; ++m )
+    {
+        unsigned k = 0;
+        for ( unsigned b = 0; b != 8; ++b )
+        {
+            if ( m & ( 1u << b ) )
+                t.lane[m][k++] = static_cast<std::uint8_t>( b );
+        }
+    }
+    return t;
+}
+
+inline constexpr compress_table compress_lut = make_compress_table();
+
+template< typename T >
+std::size_t compact( nullable_view<T> const & v, T * out, std::uint32_t * indices )
+{
+    T const * const            x    = v.values();
+    std::uint8_t const * const bits = v.validity();
+    std::size_t const          n    = v.size();
+
+    assert( indices == nullptr || n == 0 || n - 1 <= std::numeric_limits<std::uint32_t>::max() );
+
+    if ( bits == nullptr )
+    {
+        std::copy( x, x + n, out );
+        if ( indices )
+        {
+            for ( std::size_t i = 0; i != n; ++i )
+                indices[i] = static_cast<std::uint32_t>( i );
+        }
+        return n;
+    }
+
+    std::size_t i = 0;
+    std::size_t k = 0;
+
+#if optfun_HAVE_AVX512F
+    if constexpr ( std::is_trivially_copyable_v<T> && sizeof( T ) == 4 )
+    {
+        __m512i const iota = _mm512_setr_epi32( 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15 );
+
+        for ( ; i + 16 <= n; i += 16 )
+        {
+            __mmask16 const m = static_cast<__mmask16>( bits[ i / 8 ] | bits[ i / 8 + 1 ] << 8 );
+
+            _mm512_mask_compressstoreu_epi32( out + k, m, _mm512_loadu_si512( x + i ) );
+            if ( indices )
+                _mm512_mask_compressstoreu_epi32( indices + k, m, _mm512_add_epi32( iota, _mm512_set1_epi32( static_cast<int>( i ) ) ) );
+
+            k += static_cast<std::size_t>( popcount64( m ) );
+        }
+    }
+    else if constexpr ( std::is_trivially_copyable_v<T> && sizeof( T ) == 8 )
+    {
+        __m512i const iota = _mm512_setr_epi32( 0, 1, 2, 3, 4, 5, 6, 7, 0, 0, 0, 0, 0, 0, 0, 0 );
+
+        for ( ; i + 8 <= n; i += 8 )
+        {
+            __mmask8 const m = bits[ i / 8 ];
+
+            _mm512_mask_compressstoreu_epi64( out + k, m, _mm512_loadu_si512( x + i ) );
+            if ( indices )
+                _mm512_mask_compressstoreu_epi32( indices + k, m, _mm512_add_epi32( iota, _mm512_set1_epi32( static_cast<int>( i ) ) ) );
+
+            k += static_cast<std::size_t>( popcount64( m ) );
+        }
+    }
+#elif optfun_HAVE_AVX2
+    if constexpr ( std::is_trivially_copyable_v<T> && sizeof( T ) == 4 )
+    {
+        // the permutation also is the lane of each value written, so it yields the indices:
+
+        for ( ; i + 8 <= n; i += 8 )
+        {
+            unsigned const m = bits[ i / 8 ];
+
+            __m256i const perm = _mm256_cvtepu8_epi32( _mm_loadl_epi64( reinterpret_cast<__m128i const *>( compress_lut.lane[m] ) ) );
+            __m256i const vals = _mm256_loadu_si256( reinterpret_cast<__m256i const *>( x + i ) );
+
+            _mm256_storeu_si256( reinterpret_cast<__m256i *>( out + k ), _mm256_permutevar8x32_epi32( vals, perm ) );
+            if ( indices )
+                _mm256_storeu_si256( reinterpret_cast<__m256i *>( indices + k ), _mm256_add_epi32( perm, _mm256_set1_epi32( static_cast<int>( i ) ) ) );
+
+            k += static_cast<std::size_t>( popcount64( m ) );
+        }
+    }
+#endif
+
+    for ( ; i != n; ++i )
+    {
+        bool const present = v.valid( i );
+
+        if constexpr ( std::is_trivially_copyable_v<T> )
+        {
+            out[k] = x[i];
+            if ( indices )
+                indices[k] = static_cast<std::uint32_t>( i );
+            k += present;
+        }
+        else if ( present )
+        {
+            out[k] = x[i];
+            if ( indices )
+                indices[k] = static_cast<std::uint32_t>( i );
+            ++k;
+        }
+    }
+    return k;
+}
+
+template< typename R, typename T >
+std::size_t compact( R const & r, T * out, std::uint32_t * indices )
+{
+    std::size_t i = 0;
+    std::size_t k = 0;
+
+    for ( auto const & o : r )
+    {
+        assert( indices == nullptr || i <= std::numeric_limits<std::uint32_t>::max() );
+
+        bool const present = has_value( o );
+
+        if constexpr ( is_branchless_safe< range_value_t<R> >::value && std::is_trivially_copyable_v<T> )
+        {
+            out[k] = value_or_default( o, present );
+            if ( indices )
+                indices[k] = static_cast<std::uint32_t>( i );
+            k += present;
+        }
+        else if ( present )
+        {
+            out[k] = *o;
+            if ( indices )
+                indices[k] = static_cast<std::uint32_t>( i );
+            ++k;
+        }
+        ++i;
+    }
+    return k;
+}
+
+template< typename Container >
+struct values_t : range_stage
+{
+    template< typename R >
+    auto operator()( R const & r ) const
+    {
+        using T = range_value_t<R>;
+        using C = std::conditional_t< std::is_void_v<Container>, std::vector<T>, Container >;
+
+        C result;
+        result.resize( static_cast<std::size_t>( std::size( r ) ) );
+        result.resize( compact( r, result.data(), nullptr ) );
+        return result;
+    }
+};
+
+} // namespace detail
+
+template< typename R, typename T >
+std::size_t compact_values( R const & r, T * out )
+{
+    return detail::compact( r, out, nullptr );
+}
+
+template< typename R, typename T >
+std::size_t compact_values( R const & r, T * out, std::uint32_t * indices )
+{
+    return detail::compact( r, out, indices );
+}
+
+template< typename Container = void >
+detail::values_t<Container> values()
+{
+    return detail::values_t<Container>();
+}
+
+//
+// coalesce:
+// - coalesce(a, b, ...): the first present of optionals a, b, ..., constructed
+//   directly from it; an alternative may be a lazy(f) thunk, called only if reached,
+// - the result is a plain value if the last alternative is, an optional otherwise,
+// - coalesce_columns(out, validity, a, b, ...): per element the first present of
+//   nullable_views of equal size; validity is the bitwise or of the inputs' validity.
+//
+
+template< typename F >
+struct lazy_t
+{
+    F f;
+};
+
+template< typename F >
+lazy_t<F> lazy( F f )
+{
+    return lazy_t<F>{ f };
+}
+
+namespace detail {
+
+template< typename A >
+A const & force( A const & a )
+{
+    return a;
+}
+
+template< typename F >
+auto force( lazy_t<F> const & a )
+{
+    return detail::invoke( a.f );
+}
+
+template< typename A >
+using forced_t = std::decay_t< decltype( force( std::declval<A const &>() ) ) >;
+
+template< typename A, bool = is_optional< forced_t<A> >::value >
+struct alternative_value
+{
+    using type = typename forced_t<A>::value_type;
+};
+
+template< typename A >
+struct alternative_value< A, false >
+{
+    using type = forced_t<A>;
+};
+
+template< typename Result, typename A, typename... Rest >
+Result coalesce( A const & a, Rest const &... rest )
+{
+    if constexpr ( sizeof...( Rest ) == 0 )
+    {
+        return Result( force( a ) );
+    }
+    else if constexpr ( ! is_optional< forced_t<A> >::value )
+    {
+        return Result( force( a ) );
+    }
+    else
+    {
+        decltype(auto) o = force( a );
+
+        if ( has_value( o ) )
+            return Result( *o );
+
+        return coalesce<Result>( rest... );
+    }
+}
+
+} // namespace detail
+
+template< typename A, typename... Rest >
+auto coalesce( A const & a, Rest const &... rest )
+{
+    using Last = std::tuple_element_t< sizeof...( Rest ), std::tuple< A, Rest... > >;
+    using T    = typename detail::alternative_value<A>::type;
+
+    using Result = std::conditional_t< detail::is_optional< detail::forced_t<Last> >::value, optional<T>, T >;
+
+    return detail::coalesce<Result>( a, rest... );
+}
+
+template< typename T, typename... Views >
+nullable_view<T> coalesce_columns( T * out, std::uint8_t * validity, nullable_view<T> const & first, Views const &... rest )
+{
+    std::array< nullable_view<T> const *, 1 + sizeof...( Views ) > const columns = {{ &first, &rest... }};
+
+    std::size_t const n     = first.size();
+    std::size_t const bytes = ( n + 7 ) / 8;
+
+    for ( std::size_t b = 0; b != bytes; ++b )
+    {
+        unsigned v = 0;
+        for ( auto c : columns )
+            v |= c->validity() ? c->validity()[b] : 0xffu;
+
+        validity[b] = static_cast<std::uint8_t>( v );
+    }
+
+    if ( n % 8 )
+        validity[ bytes - 1 ] = static_cast<std::uint8_t>( validity[ bytes - 1 ] & ( ( 1u << ( n % 8 ) ) - 1 ) );
+
+    // blend from the last column to the first, so that earlier columns win:
+
+    std::copy( columns.back()->values(), columns.back()->values() + n, out );
+
+    for ( std::size_t c = columns.size() - 1; c-- != 0; )
+    {
+        T const * const x = columns[c]->values();
+
+        if ( columns[c]->validity() == nullptr )
+        {
+            std::copy( x, x + n, out );
+            continue;
+        }
+
+        std::size_t i = 0;
+
+        for ( ; i + 64 <= n; i += 64 )
+        {
+            std::uint64_t const w = detail::load_bits64( columns[c]->validity() + i / 8 );
+
+            if ( w == ~std::uint64_t( 0 ) )
+            {
+                std::copy( x + i, x + i + 64, out + i );
+            }
+            else if ( w != 0 )
+            {
+                for ( std::size_t k = 0; k != 64; ++k )
+                    out[i + k] = detail::select( ( w >> k ) & 1u, x[i + k], out[i + k] );
+            }
+        }
+
+        for ( ; i != n; ++i )
+        {
+            if ( columns[c]->valid( i ) )
+                out[i] = x[i];
+        }
+    }
+
+    return nullable_view<T>( out, validity, n );
+}
+
+//
+// gap filling:
+// - stages fill_forward(max_gap), fill_backward(max_gap) and fill_with(f, max_gap) over a range
+//   of optionals or a nullable_view, like `v | fill_forward(3)`, yield a std::vector<optional<T>>;
+//   each fills gaps of at most max_gap empty elements and leaves a longer gap empty as a whole,
+// - fill_forward() fills a gap with the present value before it (last observation carried
+//   forward), fill_backward() with the one after it,
+// - fill_with(f) fills a gap with `f(before, after, offset, length)`, where before and after
+//   are the optional values around the gap; f may return T or optional<T>,
+// - fill_column(out, validity, view, stage) fills a nullable_view into out and bitmap validity,
+//   a run of present or of empty values at a time, found by scanning the bitmap a word at a time,
+// - forward_filler<T> and backward_filler<T> fill an unbounded stream with constant state,
+//   holding back at most max_gap empty elements until it is known whether their gap is filled.
+//
+
+namespace detail {
+
+inline int countr_zero64( std::uint64_t w )
+{
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_ctzll( w );
+#else
+    int n = 0;
+    for ( ; ( w & 1u ) == 0; w >>= 1 )
+        ++n;
+    return n;
+#endif
+}
+
+// position of the first bit at or after i that equals set, or n:
+
+inline std::size_t find_bit( std::uint8_t const * bits, std::size_t n, std::size_t i, bool set )
+{
+    std::size_t const bytes = ( n + 7 ) / 8;
+
+    while ( i < n )
+    {
+        std::size_t const b     = i / 8;
+        std::size_t const avail = (std::min)( std::size_t( 8 ), bytes - b );
+
+        std::uint64_t w = 0;
+        for ( std::size_t k = 0; k != avail; ++k )
+            w |= std::uint64_t( bits[b + k] ) << ( 8 * k );
+
+        w >>= i % 8;
+        if ( ! set )
+            w = ~w;
+
+        std::size_t const valid = 8 * avail - i % 8;
+        if ( valid < 64 )
+            w &= ( std::uint64_t( 1 ) << valid ) - 1;
+
+        if ( w != 0 )
+            return (std::min)( n, i + static_cast<std::size_t>( countr_zero64( w ) ) );
+
+        i += valid;
+    }
+    return n;
+}
+
+inline void set_bits( std::uint8_t * bits, std::size_t i, std::size_t j )
+{
+    for ( ; i < j && i % 8 != 0; ++i )
+        bits[ i / 8 ] = static_cast<std::uint8_t>( bits[ i / 8 ] | ( 1u << ( i % 8 ) ) );
+
+    for ( ; i + 8 <= j; i += 8 )
+        bits[ i / 8 ] = 0xff;
+
+    for ( ; i < j; ++i )
+        bits[ i / 8 ] = static_cast<std::uint8_t>( bits[ i / 8 ] | ( 1u << ( i % 8 ) ) );
+}
+
+// up to 64 bits of a bitmap of n bits, starting at bit i, a multiple of 8:
+
+inline std::uint64_t load_bits( std::uint8_t const * bits, std::size_t n, std::size_t i )
+{
+    std::size_t const bytes = (std::min)( std::size_t( 8 ), ( n - i + 7 ) / 8 );
+
+    std::uint64_t w = 0;
+    for ( std::size_t k = 0; k != bytes; ++k )
+        w |= std::uint64_t( bits[ i / 8 + k ] ) << ( 8 * k );
+    return w;
+}
+
+inline void store_bits( std::uint8_t * bits, std::size_t n, std::size_t i, std::uint64_t w )
+{
+    std::size_t const bytes = (std::min)( std::size_t( 8 ), ( n - i + 7 ) / 8 );
+
+    for ( std::size_t k = 0; k != bytes; ++k )
+        bits[ i / 8 + k ] = static_cast<std::uint8_t>( w >> ( 8 * k ) );
+}
+
+// call present(i, j) and gap(i, j) for the alternating runs of set and clear bits:
+
+template< typename Present, typename Gap >
+void for_each_run( std::uint8_t const * bits, std::size_t n, Present present, Gap gap )
+{
+    std::size_t i = 0;
+
+    while ( i < n )
+    {
+        std::size_t const j = find_bit( bits, n, i, false );
+        if ( j > i )
+            present( i, j );
+        if ( j == n )
+            break;
+
+        std::size_t const k = find_bit( bits, n, j, true );
+        gap( j, k );
+        i = k;
+    }
+}
+
+// forward and backward fill of a bitmap column as a scan without a branch per element;
+// whole words of present values are copied; the validity of a gap follows from its length:
+
+template< typename T >
+void fill_scan( T * out, std::uint8_t * validity, nullable_view<T> const & v, std::size_t max_gap, bool forward )
+{
+    T const * const            x    = v.values();
+    std::uint8_t const * const bits = v.validity();
+    std::size_t const          n    = v.size();
+    std::size_t const          blocks = ( n + 63 ) / 64;
+
+    T last = T();
+
+    for ( std::size_t b = 0; b != blocks; ++b )
+    {
+        std::size_t const   i = 64 * ( forward ? b : blocks - 1 - b );
+        std::size_t const   m = (std::min)( std::size_t( 64 ), n - i );
+        std::uint64_t const w = load_bits( bits, n, i );
+
+        if ( m == 64 && w == ~std::uint64_t( 0 ) )
+        {
+            std::copy( x + i, x + i + 64, out + i );
+            store_bits( validity, n, i, w );
+            last = x[ forward ? i + 63 : i ];
+            continue;
+        }
+
+        for ( std::size_t s = 0; s != m; ++s )
+        {
+            std::size_t const k = forward ? s : m - 1 - s;
+            bool const        p = ( w >> k ) & 1u;
+
+            last = select( p, x[i + k], last );
+            out[i + k] = last;
+        }
+        store_bits( validity, n, i, m == 64 ? w : w & ( ( std::uint64_t( 1 ) << m ) - 1 ) );
+    }
+
+    // gaps of at most max_gap elements with a value on the side they are filled from:
+
+    for_each_run( bits, n
+        , []( std::size_t, std::size_t ) {}
+        , [&]( std::size_t j, std::size_t k )
+        {
+            if ( k - j <= max_gap && ( forward ? j > 0 : k < n ) )
+                set_bits( validity, j, k );
+        }
+    );
+}
+
+template< typename Stage, typename R >
+auto fill_range( Stage const & stage, R const & r )
+{
+    using T = range_value_t<R>;
+
+    std::vector< optional<T> > result;
+
+    if constexpr ( is_nullable_view<R>::value )
+    {
+        result.reserve( r.size() );
+        for ( std::size_t i = 0; i != r.size(); ++i )
+            result.push_back( r[i] );
+    }
+    else
+    {
+        result.assign( std::begin( r ), std::end( r ) );
+    }
+
+    std::size_t const n = result.size();
+    std::size_t       i = 0;
+
+    while ( i < n )
+    {
+        while ( i < n && has_value( result[i] ) )
+            ++i;
+
+        std::size_t const j = i;
+
+        while ( i < n && ! has_value( result[i] ) )
+            ++i;
+
+        if ( j == i )
+            break;
+
+        stage.gap( j, i, j > 0 ? result[j - 1] : optional<T>(), i < n ? result[i] : optional<T>()
+            , [&]( std::size_t first, std::size_t last, T const & value )
+        {
+            std::fill( result.begin() + static_cast<std::ptrdiff_t>( first ), result.begin() + static_cast<std::ptrdiff_t>( last ), optional<T>( value ) );
+        });
+    }
+    return result;
+}
+
+} // namespace detail
+
+struct fill_forward : detail::range_stage
+{
+    std::size_t max_gap;
+
+    explicit fill_forward( std::size_t max_gap_ = (std::numeric_limits<std::size_t>::max)() )
+    : max_gap( max_gap_ ) {}
+
+    template< typename T, typename Emit >
+    void gap( std::size_t j, std::size_t k, optional<T> const & before, optional<T> const &, Emit emit ) const
+    {
+        if ( has_value( before ) && k - j <= max_gap )
+            emit( j, k, *before );
+    }
+
+    template< typename R >
+    auto operator()( R const & r ) const
+    {
+        return detail::fill_range( *this, r );
+    }
+};
+
+struct fill_backward : detail::range_stage
+{
+    std::size_t max_gap;
+
+    explicit fill_backward( std::size_t max_gap_ = (std::numeric_limits<std::size_t>::max)() )
+    : max_gap( max_gap_ ) {}
+
+    template< typename T, typename Emit >
+    void gap( std::size_t j, std::size_t k, optional<T> const &, optional<T> const & after, Emit emit ) const
+    {
+        if ( has_value( after ) && k - j <= max_gap )
+            emit( j, k, *after );
+    }
+
+    template< typename R >
+    auto operator()( R const & r ) const
+    {
+        return detail::fill_range( *this, r );
+    }
+};
+
+template< typename F >
+struct fill_with : detail::range_stage
+{
+    F           f;
+    std::size_t max_gap;
+
+    explicit fill_with( F f_, std::size_t max_gap_ = (std::numeric_limits<std::size_t>::max)() )
+    : f( std::move( f_ ) ), max_gap( max_gap_ ) {}
+
+    template< typename T, typename Emit >
+    void gap( std::size_t j, std::size_t k, optional<T> const & before, optional<T> const & after, Emit emit ) const
+    {
+        if ( k - j > max_gap )
+            return;
+
+        for ( std::size_t p = j; p != k; ++p )
+        {
+            auto const value = detail::invoke( f, before, after, p - j, k - j );
+
+            if constexpr ( detail::is_optional< std::decay_t< decltype( value ) > >::value )
+            {
+                if ( has_value( value ) )
+                    emit( p, p + 1, *value );
+            }
+            else
+            {
+                emit( p, p + 1, value );
+            }
+        }
+    }
+
+    template< typename R >
+    auto operator()( R const & r ) const
+    {
+        return detail::fill_range( *this, r );
+    }
+};
+
+template< typename T, typename Stage >
+nullable_view<T> fill_column( T * out, std::uint8_t * validity, nullable_view<T> const & v, Stage const & stage )
+{
+    T const * const   x = v.values();
+    std::size_t const n = v.size();
+
+    if ( v.validity() == nullptr )
+    {
+        std::copy( x, x + n, out );
+        detail::set_bits( validity, 0, n );
+        return nullable_view<T>( out, validity, n );
+    }
+
+    if constexpr ( std::is_same_v< Stage, fill_forward > || std::is_same_v< Stage, fill_backward > )
+    {
+        detail::fill_scan( out, validity, v, stage.max_gap, std::is_same_v< Stage, fill_forward > );
+        return nullable_view<T>( out, validity, n );
+    }
+
+    std::fill( validity, validity + ( n + 7 ) / 8, std::uint8_t( 0 ) );
+
+    detail::for_each_run( v.validity(), n
+        , [&]( std::size_t i, std::size_t j )
+        {
+            std::copy( x + i, x + j, out + i );
+            detail::set_bits( validity, i, j );
+        }
+        , [&]( std::size_t j, std::size_t k )
+        {
+            std::fill( out + j, out + k, T() );
+
+            stage.gap( j, k, j > 0 ? optional<T>( x[j - 1] ) : optional<T>(), k < n ? optional<T>( x[k] ) : optional<T>()
+                , [&]( std::size_t first, std::size_t last, T const & value )
+            {
+                std::fill( out + first, out + last, value );
+                detail::set_bits( validity, first, last );
+            });
+        }
+    );
+    return nullable_view<T>( out, validity, n );
+}
+
+// forward_filler: last observation carried forward over a stream into gaps of at most
+// max_gap elements; only counts the pending empty elements of a gap, and passes them on
+// when a value or flush() arrives, or as empty once the gap is longer than max_gap:
+
+template< typename T >
+class forward_filler
+{
+public:
+    explicit forward_filler( std::size_t max_gap = (std::numeric_limits<std::size_t>::max)() )
+    : max_gap_( max_gap ) {}
+
+    template< typename Sink >
+    void push( optional<T> const & o, Sink sink )
     {
         if ( has_value( o ) )
         {
-            return o;
+            release( sink );
+            sink( o );
+            last_ = o;
+            long_ = false;
+            return;
+        }
+
+        // no value to fill with, a gap already too long, or one that is filled anyway:
+
+        if ( ! has_value( last_ ) || long_ )
+        {
+            sink( optional<T>() );
+        }
+        else if ( max_gap_ == (std::numeric_limits<std::size_t>::max)() )
+        {
+            sink( last_ );
+        }
+        else if ( pending_ == max_gap_ )
+        {
+            for ( ; pending_ != 0; --pending_ )
+                sink( optional<T>() );
+            sink( optional<T>() );
+            long_ = true;
+        }
+        else
+        {
+            ++pending_;
+        }
+    }
+
+    // a gap at the end is filled like one before a value:
+
+    template< typename Sink >
+    void flush( Sink sink )
+    {
+        release( sink );
+    }
+
+private:
+    template< typename Sink >
+    void release( Sink & sink )
+    {
+        for ( ; pending_ != 0; --pending_ )
+            sink( last_ );
+    }
+
+    optional<T> last_;
+    std::size_t pending_ = 0;
+    std::size_t max_gap_;
+    bool        long_ = false;
+};
+
+// backward_filler: next observation carried backward over a stream into gaps of at most
+// max_gap elements; only counts the pending empty elements of a gap, and passes them on
+// when a value or flush() arrives, or as empty once the gap is longer than max_gap:
+
+template< typename T >
+class backward_filler
+{
+public:
+    explicit backward_filler( std::size_t max_gap = (std::numeric_limits<std::size_t>::max)() )
+    : max_gap_( max_gap ) {}
+
+    template< typename Sink >
+    void push( optional<T> const & o, Sink sink )
+    {
+        if ( has_value( o ) )
+        {
+            for ( ; pending_ != 0; --pending_ )
+                sink( o );
+            sink( o );
+            long_ = false;
+            return;
+        }
+
+        if ( long_ )
+        {
+            sink( optional<T>() );
+        }
+        else if ( pending_ == max_gap_ )
+        {
+            flush( sink );
+            sink( optional<T>() );
+            long_ = true;
+        }
+        else
+        {
+            ++pending_;
         }
+    }
+
+    // a gap at the end has no value after it and stays empty:
+
+    template< typename Sink >
+    void flush( Sink sink )
+    {
+        for ( ; pending_ != 0; --pending_ )
+            sink( optional<T>() );
+    }
+
+private:
+    std::size_t pending_ = 0;
+    std::size_t max_gap_;
+    bool        long_ = false;
+};
+
+#if optfun_HAVE_MEMORY_RESOURCE
+
+//
+// memory resource of a chain:
+// - `o | with_resource( &arena ) | map( f ) | and_then( g )` builds each stage's
+//   allocator-aware payload, like a std::pmr::string, in memory of `arena`,
+// - in map(f), map_or(f, u), map_or_else(f, u), and_then(f) and or_else(f), a function
+//   `U f(T, resource_allocator)` receives an allocator of that resource; outside a chain,
+//   f is called as is, without an allocator,
+// - a function `U f(T)` may allocate its payload from current_resource(), the payload is then
+//   moved without a copy; otherwise it is copied into the resource via its allocator-extended
+//   constructor, an allocation in the resource besides the one of f,
+// - the chain yields a resourced<T>, which converts to an optional<T> as an rvalue.
+//
+
+namespace detail {
+
+// make resource the current one of this thread while a stage runs:
+
+class resource_scope
+{
+public:
+    explicit resource_scope( std::pmr::memory_resource * resource ) noexcept
+    : previous_( scoped_resource() )
+    {
+        scoped_resource() = resource;
+    }
+
+    ~resource_scope()
+    {
+        scoped_resource() = previous_;
+    }
+
+    resource_scope( resource_scope const & ) = delete;
+    resource_scope & operator=( resource_scope const & ) = delete;
+
+private:
+    std::pmr::memory_resource * previous_;
+};
+
+// f(args..., resource_allocator) if f accepts it, otherwise f(args...):
+
+template< typename F >
+struct allocating
+{
+    F const &                   f;
+    std::pmr::memory_resource * resource;
+
+    template< typename... Args >
+    decltype(auto) operator()( Args &&... args ) const
+    {
+        if constexpr ( std::is_invocable_v< F const &, Args..., resource_allocator > )
+            return detail::invoke( f, std::forward<Args>( args )..., resource_allocator( resource ) );
+        else
+            return detail::invoke( f, std::forward<Args>( args )... );
+    }
+};
+
+// a stage's function as allocating<F>; a stage without a function producing a payload is kept:
+
+template< typename S >
+S const & with_allocator( S const & s, std::pmr::memory_resource * )
+{
+    return s;
+}
+
+template< typename Stage, typename Original >
+Stage named_as( Stage stage, Original const & original )
+{
+#if optfun_CONFIG_INSTRUMENT
+    stage.stage_name = original.stage_name;
+#else
+    (void) original;
+#endif
+    return stage;
+}
+
+template< typename F, typename H >
+auto with_allocator( map<F,H> const & s, std::pmr::memory_resource * resource )
+{
+    return named_as( map< allocating<F>, H >( allocating<F>{ s.f, resource } ), s );
+}
+
+template< typename F, typename U, typename H >
+auto with_allocator( map_or<F,U,H> const & s, std::pmr::memory_resource * resource )
+{
+    return named_as( map_or< allocating<F>, U, H >( allocating<F>{ s.f, resource }, s.u ), s );
+}
+
+template< typename F, typename U, typename H >
+auto with_allocator( map_or_else<F,U,H> const & s, std::pmr::memory_resource * resource )
+{
+    return named_as( map_or_else< allocating<F>, allocating<U>, H >( allocating<F>{ s.f, resource }, allocating<U>{ s.u, resource } ), s );
+}
+
+template< typename F, typename H >
+auto with_allocator( and_then<F,H> const & s, std::pmr::memory_resource * resource )
+{
+    return named_as( and_then< allocating<F>, H >( allocating<F>{ s.f, resource } ), s );
+}
+
+template< typename F, typename H >
+auto with_allocator( then<F,H> const & s, std::pmr::memory_resource * resource )
+{
+    return named_as( then< allocating<F>, H >( allocating<F>{ s.f, resource } ), s );
+}
+
+template< typename F, typename H >
+auto with_allocator( or_else<F,H> const & s, std::pmr::memory_resource * resource )
+{
+    return named_as( or_else< allocating<F>, H >( allocating<F>{ s.f, resource } ), s );
+}
+
+// U from v, in memory of resource if U is allocator-aware:
+
+template< typename U, typename V >
+U rebind( V && v, std::pmr::memory_resource * resource )
+{
+    if constexpr ( std::uses_allocator_v< U, resource_allocator > && std::is_constructible_v< U, V &&, resource_allocator > )
+        return U( std::forward<V>( v ), resource_allocator( resource ) );
+    else
+        return U( std::forward<V>( v ) );
+}
+
+template< typename T, typename O >
+optional<T> rebind_optional( O && o, std::pmr::memory_resource * resource )
+{
+    if ( has_value( o ) )
+    {
+        return rebind<T>( *std::forward<O>( o ), resource );
+    }
+    return nullopt;
+}
+
+} // namespace detail
+
+// resourced: optional of a with_resource() chain and the memory resource of its payload:
+
+template< typename T >
+class resourced
+{
+public:
+    resourced( optional<T> value, std::pmr::memory_resource * resource )
+    : value_( std::move( value ) ), resource_( resource ) {}
+
+    optional<T> const & get() const & { return value_; }
+    optional<T>         get() &&      { return std::move( value_ ); }
 
-        f();
-        return nullopt;
-    }
+    std::pmr::memory_resource * resource() const { return resource_; }
+
+    // move out the optional, a copy would allocate from the default resource:
+
+    operator optional<T>() && { return std::move( value_ ); }
+
+private:
+    optional<T>                 value_;
+    std::pmr::memory_resource * resource_;
 };
 
-// and_(): return `u` if optional has content, otherwise return an empty optional.
+// with_resource(resource): start a chain that builds payloads in memory of resource:
 
-template< typename U >
-struct and_
+struct with_resource
 {
-    U const & u;
+    std::pmr::memory_resource * resource;
 
-    and_( U const & u_ )
-    : u( u_ ) {}
+    explicit with_resource( std::pmr::memory_resource * resource_ )
+    : resource( resource_ ) {}
+
+    optfun_stage_name( with_resource, "with_resource" )
 
     template< typename T >
-    optional< typename std::decay<U>::type >
-    operator()( optional<T> const & o ) const
+    resourced<T> operator()( optional<T> const & o ) const
     {
-        if ( has_value( o ) )
-        {
-            return u;
-        }
-
-        return nullopt;
+        return resourced<T>( detail::rebind_optional<T>( o, resource ), resource );
     }
 };
 
-// or_(): return the current value if non-empty, otherwise return `rhs`.
+// operator|(resourced, algorithm): apply stage with the chain's resource current,
+// an optional result continues the chain, any other result ends it:
 
-template< typename U >
-struct or_
+template< typename T, typename F >
+auto operator|( resourced<T> r, F const & f )
 {
-    U const & u;
+    std::pmr::memory_resource * const resource = r.resource();
 
-    or_( U const & u_ )
-    : u( u_ ) {}
+    detail::resource_scope scope( resource );
 
-    template< typename T >
-    auto operator()( optional<T> const & o ) const
+    auto result = std::move( r ).get() | detail::with_allocator( f, resource );
+
+    using R = decltype( result );
+
+    if constexpr ( detail::is_optional<R>::value )
     {
-        if ( has_value( o ) )
-        {
-            return o.value();
-        }
-        return u;
+        using U = typename R::value_type;
+        return resourced<U>( detail::rebind_optional<U>( std::move( result ), resource ), resource );
     }
-};
+    else
+    {
+        return detail::rebind<R>( std::move( result ), resource );
+    }
+}
 
-//// take(): Take the value out of the optional, leaving it empty and return it:
-//
-//optional_f take()
-//{
-//    optional_f result; result.swap( *this );
-//    return result;
-//}
+#endif // optfun_HAVE_MEMORY_RESOURCE
 
-// operator|(optional, algorithm): connect operation to optional:
+// operator|(range, aggregate): apply terminal stage to range of optionals:
 
-template< typename T, typename F >
-auto operator|( optional<T> o, F f )
+template< typename R, typename S
+    , typename = std::enable_if_t<
+        std::is_base_of_v< detail::range_stage, S > && ! detail::is_optional_like< std::decay_t<R> >::value >
+>
+optfun_force_inline_flatten auto operator|( R && r, S const & s )
 {
-    return std::invoke( f, o );
+    return s( std::forward<R>( r ) );
 }
 
 } // namespace optfun_lite
@@ -435,16 +3592,56 @@ auto operator|( optional<T> o, F f )
 
 using optfun_lite::map;
 using optfun_lite::map_or;
+using optfun_lite::map_branchless;
+using optfun_lite::map_or_branchless;
 using optfun_lite::map_or_else;
 using optfun_lite::then;
 using optfun_lite::and_then;
 using optfun_lite::or_else;
 using optfun_lite::and_;
 using optfun_lite::or_;
+using optfun_lite::filter;
+using optfun_lite::function_ref;
+using optfun_lite::composed;
+using optfun_lite::pipeline;
+using optfun_lite::optional_ref;
+using optfun_lite::get;
+using optfun_lite::get_opt;
 //using optfun_lite::take;
 
+using optfun_lite::nullable_view;
+using optfun_lite::count_present;
+using optfun_lite::sum_present;
+using optfun_lite::min_present;
+using optfun_lite::max_present;
+using optfun_lite::mean_present;
+using optfun_lite::fold_present;
+using optfun_lite::small_vector;
+using optfun_lite::collect;
+using optfun_lite::compact_values;
+using optfun_lite::values;
+using optfun_lite::lazy;
+using optfun_lite::coalesce;
+using optfun_lite::coalesce_columns;
+using optfun_lite::fill_forward;
+using optfun_lite::fill_backward;
+using optfun_lite::fill_with;
+using optfun_lite::fill_column;
+using optfun_lite::forward_filler;
+using optfun_lite::backward_filler;
+#if optfun_HAVE_MEMORY_RESOURCE
+using optfun_lite::resource_allocator;
+using optfun_lite::current_resource;
+using optfun_lite::resourced;
+using optfun_lite::with_resource;
+#endif
+
 using optfun_lite::operator|;
 
+#if optfun_CONFIG_INSTRUMENT
+namespace instrument = optfun_lite::instrument;
+#endif
+
 } // namespace nonstd
 
 #else // optfun_CPP17_OR_GREATER
@@ -559,15 +3756,19 @@ using optfun_lite::operator|;
 
 // additional includes:
 
+#include <cstddef>
+
 #if optfun_CPP11_OR_GREATER
 # include <functional>
+# include <type_traits>
+# include <utility>
 #endif
 
 //
 // type traits:
 //
 
-#define  optfun_INVOKE(f,t)           f(t)
+#define  optfun_INVOKE(f,t)           ::nonstd::optfun_lite::detail::invoke( f, t )
 
 # define optfun_INVOKE_RESULT_T(F,T)  typename ::nonstd::optfun_lite::detail::result_of<F>::type
 # define optfun_RESULT_OF_T(F)        typename ::nonstd::optfun_lite::detail::result_of<F>::type
@@ -667,11 +3868,51 @@ public:
     >::type type;
 };
 
-template< typename F >              struct result_of;
+template< typename F >              struct result_of { typedef typename F::result_type type; };
 template< typename R, typename T1 > struct result_of<R (*)(T1)> { typedef R type; };
 template< typename R, typename T1 > struct result_of<R (&)(T1)> { typedef R type; };
 template< typename R >              struct result_of<R (*)()>   { typedef R type; };
 template< typename R >              struct result_of<R (&)()>   { typedef R type; };
+template< typename M, typename C >  struct result_of<M C::*>    { typedef M type; };
+template< typename R, typename C >  struct result_of<R (C::*)()>       { typedef R type; };
+template< typename R, typename C >  struct result_of<R (C::*)() const> { typedef R type; };
+
+template< typename T >              struct is_member_pointer         : false_type {};
+template< typename M, typename C >  struct is_member_pointer<M C::*> : true_type  {};
+
+// invoke(f, t): f(t), or for a member pointer f, t.*f or (t.*f)():
+
+template< typename F, typename T >
+optfun_force_inline typename enable_if< ! is_member_pointer<F>::value, typename result_of<F>::type >::type
+invoke( F const & f, T & t )
+{
+    return f( t );
+}
+
+template< typename F, typename T >
+optfun_force_inline typename enable_if< ! is_member_pointer<F>::value, typename result_of<F>::type >::type
+invoke( F const & f, T const & t )
+{
+    return f( t );
+}
+
+template< typename M, typename C, typename T >
+optfun_force_inline M invoke( M C::* m, T const & t )
+{
+    return t.*m;
+}
+
+template< typename R, typename C, typename T >
+optfun_force_inline R invoke( R (C::* m)() const, T const & t )
+{
+    return (t.*m)();
+}
+
+template< typename R, typename C, typename T >
+optfun_force_inline R invoke( R (C::* m)(), T & t )
+{
+    return (t.*m)();
+}
 
 }}} // namespace nonstd::optfun_lite::detail
 
@@ -720,41 +3961,168 @@ public:
 
 namespace nonstd { namespace optfun_lite {
 
+// function_ref<R(A)>, function_ref<R()>: non-owning reference to a callable, two pointers in size;
+// pass it to an adaptor so that a large or stateful callable is never copied:
+// - the callable must outlive the function_ref, as with a reference.
+
+template< typename Signature >
+class function_ref;
+
+template< typename R, typename A >
+class function_ref< R( A ) >
+{
+public:
+    typedef R result_type;
+
+    function_ref( R (*f)( A ) )
+    : call_( &call_function )
+    {
+        storage_.function = f;
+    }
+
+    template< typename F >
+    function_ref( F & f, typename detail::enable_if< ! detail::is_same< typename detail::remove_cv<F>::type, function_ref >::value >::type * = 0 )
+    : call_( &call_object<F> )
+    {
+        storage_.object = &f;
+    }
+
+    template< typename F >
+    function_ref( F const & f, typename detail::enable_if< ! detail::is_same< F, function_ref >::value >::type * = 0 )
+    : call_( &call_object<F const> )
+    {
+        storage_.object = &f;
+    }
+
+    optfun_force_inline R operator()( A a ) const
+    {
+        return call_( storage_, a );
+    }
+
+private:
+    union storage
+    {
+        void const * object;
+        R (*function)( A );
+    };
+
+    static R call_function( storage s, A a )
+    {
+        return s.function( a );
+    }
+
+    template< typename F >
+    static R call_object( storage s, A a )
+    {
+        return (*static_cast<F *>( const_cast<void *>( s.object ) ))( a );
+    }
+
+    storage storage_;
+    R (*call_)( storage, A );
+};
+
+template< typename R >
+class function_ref< R() >
+{
+public:
+    typedef R result_type;
+
+    function_ref( R (*f)() )
+    : call_( &call_function )
+    {
+        storage_.function = f;
+    }
+
+    template< typename F >
+    function_ref( F & f, typename detail::enable_if< ! detail::is_same< typename detail::remove_cv<F>::type, function_ref >::value >::type * = 0 )
+    : call_( &call_object<F> )
+    {
+        storage_.object = &f;
+    }
+
+    template< typename F >
+    function_ref( F const & f, typename detail::enable_if< ! detail::is_same< F, function_ref >::value >::type * = 0 )
+    : call_( &call_object<F const> )
+    {
+        storage_.object = &f;
+    }
+
+    optfun_force_inline R operator()() const
+    {
+        return call_( storage_ );
+    }
+
+private:
+    union storage
+    {
+        void const * object;
+        R (*function)();
+    };
+
+    static R call_function( storage s )
+    {
+        return s.function();
+    }
+
+    template< typename F >
+    static R call_object( storage s )
+    {
+        return (*static_cast<F *>( const_cast<void *>( s.object ) ))();
+    }
+
+    storage storage_;
+    R (*call_)( storage );
+};
+
 namespace detail {
 
+// Note: stage instrumentation requires C++17, named() is accepted for portability.
+
 #define optfun_mk_proxy( name )     \
-    template< typename F >          \
+    template< typename F, typename H = hint_none > \
     struct name                     \
     {                               \
         F f;                        \
-        name( F f_ ) : f( f_ ) {}   \
+        optfun_force_inline name( F const & f_ ) : f( f_ ) {} \
+        optfun_force_inline name named( char const * ) const { return *this; } \
+        optfun_force_inline name<F, hint_likely  > likely()   const { return name<F, hint_likely  >( f ); } \
+        optfun_force_inline name<F, hint_unlikely> unlikely() const { return name<F, hint_unlikely>( f ); } \
     };
 
 #define optfun_mk_proxy_arg( name )     \
-    template< typename F, typename U >  \
+    template< typename F, typename U, typename H = hint_none > \
     struct name                         \
     {                                   \
         F f; U const & u;               \
-        name( F f_, U const & u_)       \
+        optfun_force_inline name( F const & f_, U const & u_) \
         : f( f_), u( u_) {}             \
+        optfun_force_inline name named( char const * ) const { return *this; } \
+        optfun_force_inline name<F, U, hint_likely  > likely()   const { return name<F, U, hint_likely  >( f, u ); } \
+        optfun_force_inline name<F, U, hint_unlikely> unlikely() const { return name<F, U, hint_unlikely>( f, u ); } \
     };
 
 #define optfun_mk_proxy_fun( name )     \
-    template< typename F, typename U >  \
+    template< typename F, typename U, typename H = hint_none > \
     struct name                         \
     {                                   \
         F f; U u;                       \
-        name( F f_, U u_)               \
+        optfun_force_inline name( F const & f_, U const & u_) \
         : f( f_), u( u_) {}             \
+        optfun_force_inline name named( char const * ) const { return *this; } \
+        optfun_force_inline name<F, U, hint_likely  > likely()   const { return name<F, U, hint_likely  >( f, u ); } \
+        optfun_force_inline name<F, U, hint_unlikely> unlikely() const { return name<F, U, hint_unlikely>( f, u ); } \
     };
 
 optfun_mk_proxy(     map )
 optfun_mk_proxy_arg( map_or )
+optfun_mk_proxy(     map_branchless )
+optfun_mk_proxy_arg( map_or_branchless )
 optfun_mk_proxy_fun( map_or_else )
 optfun_mk_proxy(     and_then    )
 optfun_mk_proxy(     or_else     )
 optfun_mk_proxy(     and_ )
 optfun_mk_proxy(     or_ )
+optfun_mk_proxy(     filter )
 //optfun_mk_proxy(     take )
 
 #undef optfun_mk_proxy
@@ -765,28 +4133,29 @@ optfun_mk_proxy(     or_ )
 // - perform operation `U f(T)` on optional's content if present and return an optional<U>.
 // - perform operation `void f(T)` on optional's content if present and return an optional<monostate>..
 
-template< typename F, typename T, typename Enable = void >
+template< typename F, typename T, typename H, typename Enable = void >
 struct map_t;
 
 // map(f): perform operation `U f(T)` on optional's
 // content if present and return an optional<U>.
 
-template< typename F, typename T >
-struct map_t<F, T, typename enable_if< ! is_void< optfun_RESULT_OF_T(F) >::value >::type >
+template< typename F, typename T, typename H >
+struct map_t<F, T, H, typename enable_if< ! is_void< optfun_RESULT_OF_T(F) >::value >::type >
 {
     typedef optional< optfun_INVOKE_RESULT_T(F,T) > result_t;
 
-    F f;
+    F const & f;
 
-    map_t( map<F> proxy )
+    optfun_force_inline map_t( map<F,H> const & proxy )
     : f( proxy.f ) {}
 
-    result_t
-    operator()( optional<T> const & o ) const
+    template< typename O >
+    optfun_force_inline result_t
+    operator()( O const & o ) const
     {
-        if ( has_value( o ) )
+        if ( present( has_value( o ), H() ) )
         {
-            return optfun_INVOKE( f, o.value() );
+            return optfun_INVOKE( f, *o );
         }
         return nonstd::nullopt;
     }
@@ -796,22 +4165,23 @@ struct map_t<F, T, typename enable_if< ! is_void< optfun_RESULT_OF_T(F) >::value
 // map(f): perform operation `void f(T)` on optional's
 // content if present and return an optional<monostate>.
 
-template< typename F, typename T >
-struct map_t<F, T, typename enable_if< is_void< optfun_RESULT_OF_T(F) >::value >::type >
+template< typename F, typename T, typename H >
+struct map_t<F, T, H, typename enable_if< is_void< optfun_RESULT_OF_T(F) >::value >::type >
 {
     typedef optional< monostate > result_t;
 
-    F f;
+    F const & f;
 
-    map_t( map<F> proxy )
+    optfun_force_inline map_t( map<F,H> const & proxy )
     : f( proxy.f ) {}
 
-    result_t
-    operator()( optional<T> const & o ) const
+    template< typename O >
+    optfun_force_inline result_t
+    operator()( O const & o ) const
     {
-        if ( has_value( o ) )
+        if ( present( has_value( o ), H() ) )
         {
-            optfun_INVOKE( f, o.value() );
+            optfun_INVOKE( f, *o );
             return monostate();
         }
         return nullopt;
@@ -821,48 +4191,117 @@ struct map_t<F, T, typename enable_if< is_void< optfun_RESULT_OF_T(F) >::value >
 // map_or(f, u): perform operation `U f(T)` on optional's
 // content if present and return it, otherwise return u.
 
-template< typename F, typename T, typename U >
+template< typename F, typename T, typename U, typename H >
 struct map_or_t
 {
     typedef U result_t;
 
-    F f;
+    F const & f;
     U const & u;
 
-    map_or_t( map_or<F,U> proxy )
+    optfun_force_inline map_or_t( map_or<F,U,H> const & proxy )
     : f( proxy.f ), u( proxy.u ) {}
 
-    result_t
-    operator()( optional<T> const & o ) const
+    template< typename O >
+    optfun_force_inline result_t
+    operator()( O const & o ) const
     {
-        if ( has_value( o ) )
+        if ( present( has_value( o ), H() ) )
         {
-            return optfun_INVOKE( f, o.value() );
+            return optfun_INVOKE( f, *o );
         }
         return u;
     }
 };
 
+// map_branchless(f): perform operation `U f(T)` on optional's content
+// or on a default-constructed T and select the optional<U> result.
+// Note: selection without a branch is guaranteed for C++17 and later only.
+
+template< typename F, typename T, typename H >
+struct map_branchless_t
+{
+    typedef optional< optfun_INVOKE_RESULT_T(F,T) > result_t;
+
+#if optfun_CPP11_OR_GREATER
+    static_assert( std::is_trivially_copyable<T>::value && std::is_default_constructible<T>::value
+        , "map_branchless(f): T must be trivially copyable and default-constructible" );
+    static_assert( std::is_trivially_copyable< optfun_INVOKE_RESULT_T(F,T) >::value && std::is_default_constructible< optfun_INVOKE_RESULT_T(F,T) >::value
+        , "map_branchless(f): result of f must be trivially copyable and default-constructible" );
+#endif
+
+    F const & f;
+
+    optfun_force_inline map_branchless_t( map_branchless<F,H> const & proxy )
+    : f( proxy.f ) {}
+
+    template< typename O >
+    optfun_force_inline result_t
+    operator()( O const & o ) const
+    {
+        bool const present = has_value( o );
+
+        result_t const some( optfun_INVOKE( f, present ? *o : T() ) );
+
+        return present ? some : result_t();
+    }
+};
+
+// map_or_branchless(f, u): perform operation `U f(T)` on optional's content
+// or on a default-constructed T and select between its result and u.
+// Note: selection without a branch is guaranteed for C++17 and later only.
+
+template< typename F, typename T, typename U, typename H >
+struct map_or_branchless_t
+{
+    typedef U result_t;
+
+#if optfun_CPP11_OR_GREATER
+    static_assert( std::is_trivially_copyable<T>::value && std::is_default_constructible<T>::value
+        , "map_or_branchless(f, u): T must be trivially copyable and default-constructible" );
+    static_assert( std::is_trivially_copyable<U>::value && std::is_default_constructible<U>::value
+        , "map_or_branchless(f, u): U must be trivially copyable and default-constructible" );
+#endif
+
+    F const & f;
+    U const & u;
+
+    optfun_force_inline map_or_branchless_t( map_or_branchless<F,U,H> const & proxy )
+    : f( proxy.f ), u( proxy.u ) {}
+
+    template< typename O >
+    optfun_force_inline result_t
+    operator()( O const & o ) const
+    {
+        bool const present = has_value( o );
+
+        result_t const mapped = optfun_INVOKE( f, present ? *o : T() );
+
+        return present ? mapped : u;
+    }
+};
+
 // map_or_else(f, u): perform operation `U f(T)` on optional's
 // content if present and return it, otherwise return operation u().
 
-template< typename F, typename T, typename U >
+template< typename F, typename T, typename U, typename H >
 struct map_or_else_t
 {
     typedef optfun_RESULT_OF_T(U) result_t;
 
-    F f;
-    U u;
+    F const & f;
+    U const & u;
 
-    map_or_else_t( map_or_else<F,U> proxy )
+    optfun_force_inline map_or_else_t( map_or_else<F,U,H> const & proxy )
     : f( proxy.f ), u( proxy.u ) {}
 
-    result_t
-    operator()( optional<T> const & o ) const
+    template< typename O >
+    optfun_force_inline result_t
+    operator()( O const & o ) const
     {
-        if ( has_value( o ) )
+        if ( present( has_value( o ), H() ) )
         {
-            return f( o.value() );
+            return optfun_INVOKE( f, *o );
         }
         return u();
     }
@@ -871,21 +4310,22 @@ struct map_or_else_t
 // and_then(f): return operation `optional<U> f(T)` on optional's
 // content if present and return an optional<U>.
 
-template< typename F, typename T >
+template< typename F, typename T, typename H >
 struct and_then_t
 {
     typedef optional<T> result_t;
 
-    F f;
+    F const & f;
 
-    and_then_t( and_then<F> proxy )
+    optfun_force_inline and_then_t( and_then<F,H> const & proxy )
     : f( proxy.f ) {}
 
-    result_t operator()( optional<T> const & o ) const
+    template< typename O >
+    optfun_force_inline result_t operator()( O const & o ) const
     {
-        if ( has_value( o ) )
+        if ( present( has_value( o ), H() ) )
         {
-            return optfun_INVOKE( f, o.value() );
+            return optfun_INVOKE( f, *o );
         }
         return nonstd::nullopt;
     }
@@ -895,25 +4335,26 @@ struct and_then_t
 // - return the call `R f()` if optional is empty, otherwise return optional.
 // - call `void f()` and return nullopt if optional is empty, otherwise return optional.
 
-template< typename F, typename T, typename Enable = void >
+template< typename F, typename T, typename H, typename Enable = void >
 struct or_else_t;
 
 // or_else(f): return the call `R f()` if optional is empty, otherwise return optional.
 
-template< typename F, typename T >
-struct or_else_t<F, T, typename enable_if< ! is_void< optfun_RESULT_OF_T(F) >::value >::type >
+template< typename F, typename T, typename H >
+struct or_else_t<F, T, H, typename enable_if< ! is_void< optfun_RESULT_OF_T(F) >::value >::type >
 {
     typedef optional< optfun_RESULT_OF_T(F) > result_t;
 
-    F f;
+    F const & f;
 
-    or_else_t( or_else<F> proxy )
+    optfun_force_inline or_else_t( or_else<F,H> const & proxy )
     : f( proxy.f ) {}
 
-    result_t 
-    operator()( optional<T> const & o ) const
+    template< typename O >
+    optfun_force_inline result_t
+    operator()( O const & o ) const
     {
-        if ( has_value( o ) )
+        if ( present( has_value( o ), H() ) )
         {
             return o;
         }
@@ -923,19 +4364,20 @@ struct or_else_t<F, T, typename enable_if< ! is_void< optfun_RESULT_OF_T(F) >::v
 
 // or_else(f): call `void f()` and return nullopt if optional is empty, otherwise return optional.
 
-template< typename F, typename T >
-struct or_else_t<F, T, typename enable_if< is_void< optfun_RESULT_OF_T(F) >::value >::type >
+template< typename F, typename T, typename H >
+struct or_else_t<F, T, H, typename enable_if< is_void< optfun_RESULT_OF_T(F) >::value >::type >
 {
     typedef optional<T> result_t;
 
-    F f;
+    F const & f;
 
-    or_else_t( or_else<F> proxy )
+    optfun_force_inline or_else_t( or_else<F,H> const & proxy )
     : f( proxy.f ) {}
 
-    result_t operator()( optional<T> const & o ) const
+    template< typename O >
+    optfun_force_inline result_t operator()( O const & o ) const
     {
-        if ( has_value( o ) )
+        if ( present( has_value( o ), H() ) )
         {
             return o;
         }
@@ -947,19 +4389,20 @@ struct or_else_t<F, T, typename enable_if< is_void< optfun_RESULT_OF_T(F) >::val
 
 // and_(): return `u` if `*this` has a value, otherwise return an empty optional.
 
-template< typename U, typename T >
+template< typename U, typename T, typename H >
 struct and__t
 {
     typedef optional<U> result_t;
 
-    U u;
+    U const & u;
 
-    and__t( and_<U> proxy )
+    optfun_force_inline and__t( and_<U,H> const & proxy )
     : u( proxy.f ) {}
 
-    result_t operator()( optional<T> const & o ) const
+    template< typename O >
+    optfun_force_inline result_t operator()( O const & o ) const
     {
-        if ( has_value( o ) )
+        if ( present( has_value( o ), H() ) )
         {
             return u;
         }
@@ -969,26 +4412,75 @@ struct and__t
 
 // or_(): return the current value if non-empty, otherwise return `u`.
 
-template< typename U, typename T >
+template< typename U, typename T, typename H >
 struct or__t
 {
     typedef U result_t;
 
-    U u;
+    U const & u;
 
-    or__t( or_<U> proxy )
+    optfun_force_inline or__t( or_<U,H> const & proxy )
     : u( proxy.f ) {}
 
-    result_t operator()( optional<T> const & o ) const
+    template< typename O >
+    optfun_force_inline result_t operator()( O const & o ) const
     {
-        if ( has_value( o ) )
+        if ( present( has_value( o ), H() ) )
         {
-            return o.value();
+            return *o;
         }
         return u;
     }
 };
 
+// filter(p): return optional's content if present and `bool p(T)` holds for it,
+// otherwise return an empty optional.
+
+template< typename F, typename T, typename H >
+struct filter_t
+{
+    typedef optional<T> result_t;
+
+    F const & f;
+
+    optfun_force_inline filter_t( filter<F,H> const & proxy )
+    : f( proxy.f ) {}
+
+    template< typename O >
+    optfun_force_inline result_t operator()( O const & o ) const
+    {
+        if ( present( has_value( o ), H() ) && optfun_INVOKE( f, *o ) )
+        {
+            return *o;
+        }
+        return nullopt;
+    }
+};
+
+// get(&C::m), get_opt(&C::m): member of a projection:
+
+template< typename M, typename C >
+struct get
+{
+    M C::* member;
+
+    optfun_force_inline get( M C::* member_ )
+    : member( member_ ) {}
+
+    optfun_force_inline get named( char const * ) const { return *this; }
+};
+
+template< typename M, typename C >
+struct get_opt
+{
+    M C::* member;
+
+    optfun_force_inline get_opt( M C::* member_ )
+    : member( member_ ) {}
+
+    optfun_force_inline get_opt named( char const * ) const { return *this; }
+};
+
 //// take(): Take the value out of the optional, leaving it empty and return it:
 //
 //optfun_f take()
@@ -1003,21 +4495,21 @@ struct or__t
 
 #define optfun_mk_alg_alias( alias, name )  \
     template< typename F >                  \
-    detail::name<F> alias( F f )            \
+    optfun_force_inline detail::name<F> alias( F f )            \
     {                                       \
         return detail::name<F>( f );        \
     }
 
 #define optfun_mk_alg_arg_alias( alias, name )  \
     template< typename F, typename U >          \
-    detail::name<F,U> alias( F f, U const & u ) \
+    optfun_force_inline detail::name<F,U> alias( F f, U const & u ) \
     {                                           \
         return detail::name<F,U>( f, u );       \
     }
 
 #define optfun_mk_alg_fun_alias( alias, name )  \
     template< typename F, typename U >          \
-    detail::name<F,U> alias( F f, U u ) \
+    optfun_force_inline detail::name<F,U> alias( F f, U u ) \
     {                                           \
         return detail::name<F,U>( f, u );       \
     }
@@ -1033,12 +4525,15 @@ struct or__t
 
 optfun_mk_algorithm(     map )
 optfun_mk_algorithm_arg( map_or )
+optfun_mk_algorithm(     map_branchless )
+optfun_mk_algorithm_arg( map_or_branchless )
 optfun_mk_algorithm_fun( map_or_else )
 optfun_mk_algorithm(     and_then )
 optfun_mk_alg_alias(     then, and_then )
 optfun_mk_algorithm(     or_else )
 optfun_mk_algorithm(     and_ )
 optfun_mk_algorithm(     or_ )
+optfun_mk_algorithm(     filter )
 //optfun_mk_algorithm( take )
 
 #undef optfun_mk_alg_alias
@@ -1051,33 +4546,147 @@ optfun_mk_algorithm(     or_ )
 // create the pipe operators:
 
 #define optfun_mk_pipe( name )                      \
-    template< typename T, typename F >              \
-    typename detail::name##_t<F,T>::result_t        \
-    operator|( optional<T> o, detail::name<F> f )   \
+    template< typename T, typename F, typename H >  \
+    optfun_force_inline_flatten                     \
+    typename detail::name##_t<F,T,H>::result_t      \
+    operator|( optional<T> o, detail::name<F,H> const & f ) \
+    {                                               \
+        return detail::name##_t<F,T,H>( f )( o );   \
+    }                                               \
+    template< typename T, typename F, typename H >  \
+    optfun_force_inline_flatten                     \
+    typename detail::name##_t<F,typename detail::remove_const<T>::type,H>::result_t \
+    operator|( optional_ref<T> o, detail::name<F,H> const & f ) \
     {                                               \
-        return detail::name##_t<F,T>( f )( o );     \
+        return detail::name##_t<F,typename detail::remove_const<T>::type,H>( f )( o ); \
     }
 
 #define optfun_mk_pipe_arg( name )                  \
-    template< typename T, typename F, typename U >  \
-    typename detail::name##_t<F,T,U>::result_t      \
-    operator|( optional<T> o, detail::name<F,U> f ) \
+    template< typename T, typename F, typename U, typename H > \
+    optfun_force_inline_flatten                     \
+    typename detail::name##_t<F,T,U,H>::result_t    \
+    operator|( optional<T> o, detail::name<F,U,H> const & f ) \
     {                                               \
-        return detail::name##_t<F,T,U>( f )( o );   \
+        return detail::name##_t<F,T,U,H>( f )( o ); \
+    }                                               \
+    template< typename T, typename F, typename U, typename H > \
+    optfun_force_inline_flatten                     \
+    typename detail::name##_t<F,typename detail::remove_const<T>::type,U,H>::result_t \
+    operator|( optional_ref<T> o, detail::name<F,U,H> const & f ) \
+    {                                               \
+        return detail::name##_t<F,typename detail::remove_const<T>::type,U,H>( f )( o ); \
     }
 
 optfun_mk_pipe(     map )
 optfun_mk_pipe_arg( map_or )
+optfun_mk_pipe(     map_branchless )
+optfun_mk_pipe_arg( map_or_branchless )
 optfun_mk_pipe_arg( map_or_else )
 optfun_mk_pipe(     and_then )
 optfun_mk_pipe(     or_else )
 optfun_mk_pipe(     and_ )
 optfun_mk_pipe(     or_ )
+optfun_mk_pipe(     filter )
 //optfun_mk_pipe( take )
 
 #undef optfun_mk_pipe
 #undef optfun_mk_pipe_arg
 
+// get(&C::m): member m of the optional's content as an optional_ref, without a copy;
+// as const as the input, like `o | get( &A::b ) | get( &B::c )`:
+
+template< typename M, typename C >
+optfun_force_inline detail::get<M,C> get( M C::* member )
+{
+    return detail::get<M,C>( member );
+}
+
+template< typename T, typename M, typename C >
+optfun_force_inline optional_ref<M const> operator|( optional<T> const & o, detail::get<M,C> const & g )
+{
+    return has_value( o ) ? optional_ref<M const>( (*o).*g.member ) : optional_ref<M const>();
+}
+
+template< typename T, typename M, typename C >
+optfun_force_inline optional_ref<M> operator|( optional<T> & o, detail::get<M,C> const & g )
+{
+    return has_value( o ) ? optional_ref<M>( (*o).*g.member ) : optional_ref<M>();
+}
+
+template< typename T, typename M, typename C >
+optfun_force_inline optional_ref<M> operator|( optional_ref<T> o, detail::get<M,C> const & g )
+{
+    return has_value( o ) ? optional_ref<M>( (*o).*g.member ) : optional_ref<M>();
+}
+
+template< typename T, typename M, typename C >
+optfun_force_inline optional_ref<M const> operator|( optional_ref<T const> o, detail::get<M,C> const & g )
+{
+    return has_value( o ) ? optional_ref<M const>( (*o).*g.member ) : optional_ref<M const>();
+}
+
+#if optfun_CPP11_OR_GREATER
+
+// of an rvalue optional, like a temporary, an optional of the member moved out of it;
+// C++98 cannot tell a temporary, which then yields an optional_ref that outlives it:
+
+template< typename T, typename M, typename C >
+optfun_force_inline optional< typename detail::remove_const<M>::type > operator|( optional<T> && o, detail::get<M,C> const & g )
+{
+    typedef optional< typename detail::remove_const<M>::type > result_t;
+    return has_value( o ) ? result_t( std::move( (*o).*g.member ) ) : result_t();
+}
+
+#endif // optfun_CPP11_OR_GREATER
+
+// get_opt(&C::m): the content of optional member m of the optional's content
+// as an optional_ref, without a copy; empty if either is empty:
+
+template< typename M, typename C >
+optfun_force_inline detail::get_opt<M,C> get_opt( M C::* member )
+{
+    return detail::get_opt<M,C>( member );
+}
+
+template< typename T, typename M, typename C >
+optfun_force_inline optional_ref<typename M::value_type const> operator|( optional<T> const & o, detail::get_opt<M,C> const & g )
+{
+    typedef optional_ref<typename M::value_type const> result_t;
+    return has_value( o ) && has_value( (*o).*g.member ) ? result_t( *( (*o).*g.member ) ) : result_t();
+}
+
+template< typename T, typename M, typename C >
+optfun_force_inline optional_ref<typename M::value_type> operator|( optional<T> & o, detail::get_opt<M,C> const & g )
+{
+    typedef optional_ref<typename M::value_type> result_t;
+    return has_value( o ) && has_value( (*o).*g.member ) ? result_t( *( (*o).*g.member ) ) : result_t();
+}
+
+template< typename T, typename M, typename C >
+optfun_force_inline optional_ref<typename M::value_type> operator|( optional_ref<T> o, detail::get_opt<M,C> const & g )
+{
+    typedef optional_ref<typename M::value_type> result_t;
+    return has_value( o ) && has_value( (*o).*g.member ) ? result_t( *( (*o).*g.member ) ) : result_t();
+}
+
+template< typename T, typename M, typename C >
+optfun_force_inline optional_ref<typename M::value_type const> operator|( optional_ref<T const> o, detail::get_opt<M,C> const & g )
+{
+    typedef optional_ref<typename M::value_type const> result_t;
+    return has_value( o ) && has_value( (*o).*g.member ) ? result_t( *( (*o).*g.member ) ) : result_t();
+}
+
+#if optfun_CPP11_OR_GREATER
+
+template< typename T, typename M, typename C >
+optfun_force_inline optional<typename M::value_type> operator|( optional<T> && o, detail::get_opt<M,C> const & g )
+{
+    typedef optional<typename M::value_type> result_t;
+    return has_value( o ) && has_value( (*o).*g.member ) ? result_t( std::move( *( (*o).*g.member ) ) ) : result_t();
+}
+
+#endif // optfun_CPP11_OR_GREATER
+
 }} // namespace nonstd::optfun_lite
 
 //
@@ -1088,12 +4697,19 @@ namespace nonstd {
 
 using optfun_lite::map;
 using optfun_lite::map_or;
+using optfun_lite::map_branchless;
+using optfun_lite::map_or_branchless;
 using optfun_lite::map_or_else;
 using optfun_lite::then;
 using optfun_lite::and_then;
 using optfun_lite::or_else;
 using optfun_lite::and_;
 using optfun_lite::or_;
+using optfun_lite::filter;
+using optfun_lite::function_ref;
+using optfun_lite::optional_ref;
+using optfun_lite::get;
+using optfun_lite::get_opt;
 //using optfun_lite::take;
 
 using optfun_lite::operator|;
@@ -0,0 +1,78 @@
+# Copyright 2017-2018 by Martin Moene
+#
+# https://github.com/martinmoene/optional-fun-lite
+#
+# Distributed under the Boost Software License, Version 1.0.
+# (See accompanying file LICENSE.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+# Compile SOURCE to assembly and require each function piped_x to consist of the
+# same instructions as function hand_x, local labels aside; run as:
+#
+#   cmake -DCXX=<compiler> -DSOURCE=<file> -DINCLUDE=<dir> -DOUTPUT=<file.s> [-DFLAGS=<flags>] -P asm-compare.cmake
+
+foreach( var CXX SOURCE INCLUDE OUTPUT )
+    if( NOT DEFINED ${var} )
+        message( FATAL_ERROR "asm-compare: ${var} not defined" )
+    endif()
+endforeach()
+
+separate_arguments( FLAGS )
+
+execute_process(
+    COMMAND ${CXX} -std=c++17 -O2 -S -fno-asynchronous-unwind-tables ${FLAGS} -I${INCLUDE} ${SOURCE} -o ${OUTPUT}
+    RESULT_VARIABLE result
+    ERROR_VARIABLE  errors )
+
+if( NOT result EQUAL 0 )
+    message( FATAL_ERROR "asm-compare: cannot compile ${SOURCE}:\n${errors}" )
+endif()
+
+# instructions per function, local labels as '.L:':
+
+file( STRINGS ${OUTPUT} lines )
+
+set( functions "" )
+set( current   "" )
+
+foreach( line IN LISTS lines )
+    if( line MATCHES "^_?((piped|hand)_[A-Za-z0-9_]+):" )
+        set( current ${CMAKE_MATCH_1} )
+        list( APPEND functions ${current} )
+        set( body_${current} "" )
+    elseif( current AND line MATCHES "^[A-Za-z_]" )
+        set( current "" )
+    elseif( current AND line MATCHES "^[.]?L[A-Za-z0-9_$]*:" )
+        string( APPEND body_${current} ".L:\n" )
+    elseif( current AND line MATCHES "^[ \t]+([^.].*)$" )
+        string( STRIP "${CMAKE_MATCH_1}" instruction )
+        string( REGEX REPLACE "[.]?L[A-Za-z0-9_$]+" ".L" instruction "${instruction}" )
+        string( REGEX REPLACE "[ \t]+" " " instruction "${instruction}" )
+        string( APPEND body_${current} "${instruction}\n" )
+    endif()
+endforeach()
+
+set( compared 0 )
+
+foreach( function IN LISTS functions )
+    if( function MATCHES "^piped_(.*)$" )
+        set( hand hand_${CMAKE_MATCH_1} )
+
+        if( NOT DEFINED body_${hand} )
+            message( FATAL_ERROR "asm-compare: ${function} without ${hand}" )
+        endif()
+
+        if( NOT body_${function} STREQUAL body_${hand} )
+            message( FATAL_ERROR "asm-compare: ${function} differs from ${hand}:\n${function}:\n${body_${function}}\n${hand}:\n${body_${hand}}" )
+        endif()
+
+        math( EXPR compared "${compared} + 1" )
+    endif()
+endforeach()
+
+if( compared EQUAL 0 )
+    message( FATAL_ERROR "asm-compare: no function piped_x found in ${OUTPUT}" )
+endif()
+
+message( STATUS "asm-compare: ${compared} functions piped_x as hand_x" )
+
+# end of file
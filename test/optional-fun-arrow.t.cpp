@@ -0,0 +1,207 @@
+//
+// Copyright 2014-2017 by Martin Moene
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+#include "optional-fun-main.t.hpp"
+#include "nonstd/optional-fun-arrow.hpp"
+
+#if optfun_CPP17_OR_GREATER
+
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+using namespace nonstd;
+
+namespace {
+
+//
+// Arrow C data interface:
+//
+
+// values 0..n-1 with every third element null:
+
+struct some_column
+{
+    explicit some_column( std::size_t n )
+    : values( n ), validity( ( n + 7 ) / 8 )
+    {
+        for ( std::size_t i = 0; i != n; ++i )
+        {
+            values[i] = static_cast<int>( i );
+
+            if ( i % 3 != 1 )
+            {
+                validity[ i / 8 ] = static_cast<std::uint8_t>( validity[ i / 8 ] | ( 1u << ( i % 8 ) ) );
+            }
+        }
+    }
+
+    nullable_view<int> view() const
+    {
+        return nullable_view<int>( values.data(), validity.data(), values.size() );
+    }
+
+    std::vector<int>          values;
+    std::vector<std::uint8_t> validity;
+};
+
+CASE( "arrow: export describes a nullable_view as a primitive array, without a copy" "[arrow]")
+{
+    some_column const c( 10 );
+
+    ArrowArray  array;
+    ArrowSchema schema;
+
+    export_arrow( c.view(), &array, &schema );
+
+    EXPECT( array.length     == 10 );
+    EXPECT( array.null_count == -1 );
+    EXPECT( array.offset     ==  0 );
+    EXPECT( array.n_buffers  ==  2 );
+    EXPECT( array.n_children ==  0 );
+    EXPECT( array.buffers[0] == static_cast<void const *>( c.validity.data() ) );
+    EXPECT( array.buffers[1] == static_cast<void const *>( c.values.data() ) );
+
+    EXPECT( std::strcmp( schema.format, "i" ) == 0 );
+    EXPECT( schema.flags == ARROW_FLAG_NULLABLE );
+
+    array.release( &array );
+    schema.release( &schema );
+
+    EXPECT( ( array.release  == nullptr ) );
+    EXPECT( ( schema.release == nullptr ) );
+}
+
+CASE( "arrow: format follows the value type, no validity bitmap means no nulls" "[arrow]")
+{
+    double const values[] = { 1.5, 2.5 };
+
+    ArrowArray  array;
+    ArrowSchema schema;
+
+    export_arrow( nullable_view<double>( values, nullptr, 2 ), &array, &schema );
+
+    EXPECT( std::strcmp( schema.format, "g" ) == 0 );
+    EXPECT( array.null_count == 0 );
+    EXPECT( array.buffers[0] == nullptr );
+
+    array.release( &array );
+    schema.release( &schema );
+}
+
+CASE( "arrow: import views the exported buffers, for the adaptors and range stages" "[arrow]")
+{
+    some_column const c( 10 );
+
+    ArrowArray  array;
+    ArrowSchema schema;
+
+    export_arrow( c.view(), &array, &schema );
+
+    std::error_code ec;
+    optional< arrow_column<int> > const col = import_arrow<int>( &array, &schema, ec );
+    schema.release( &schema );
+
+    EXPECT_NOT( ec );
+    EXPECT( col.has_value() );
+    EXPECT( ( array.release == nullptr ) );
+    EXPECT( col->view().values() == c.values.data() );
+    EXPECT( col->size() == 10u );
+
+    EXPECT( 42 == ( (*col)[6] | map( []( int x ) { return x * 7; } ) ).value() );
+    EXPECT_NOT( (*col)[7].has_value() );
+    EXPECT( 0 + 2 + 3 + 5 + 6 + 8 + 9 == ( col->view() | sum_present() ) );
+
+    std::vector< optional<int> > v( col->begin(), col->end() );
+
+    EXPECT( ( v == std::vector< optional<int> >{ 0, nullopt, 2, 3, nullopt, 5, 6, nullopt, 8, 9 } ) );
+}
+
+CASE( "arrow: the owner lives until the imported column releases the array" "[arrow]")
+{
+    auto owner = std::make_shared<some_column>( 20 );
+    std::weak_ptr<some_column> const watch = owner;
+
+    ArrowArray  array;
+    ArrowSchema schema;
+
+    nullable_view<int> const view = owner->view();
+    export_arrow( view, &array, &schema, std::move( owner ) );
+
+    std::error_code ec;
+    {
+        optional< arrow_column<int> > col = import_arrow<int>( &array, &schema, ec );
+        schema.release( &schema );
+
+        arrow_column<int> const moved = std::move( *col );
+        col.reset();
+
+        EXPECT_NOT( watch.expired() );
+        EXPECT( 18 == moved[18].value() );
+    }
+    EXPECT( watch.expired() );
+}
+
+CASE( "arrow: import of an offset that is a multiple of 8" "[arrow]")
+{
+    some_column const c( 20 );
+
+    ArrowArray  array;
+    ArrowSchema schema;
+
+    export_arrow( c.view(), &array, &schema );
+    array.offset  = 8;
+    array.length -= 8;
+
+    std::error_code ec;
+    optional< arrow_column<int> > const col = import_arrow<int>( &array, &schema, ec );
+    schema.release( &schema );
+
+    EXPECT( col->size() == 12u );
+    EXPECT(  8 == (*col)[0].value() );
+    EXPECT_NOT( (*col)[2].has_value() );
+    EXPECT( 18 == (*col)[10].value() );
+    EXPECT_NOT( (*col)[11].has_value() );
+}
+
+CASE( "arrow: import rejects another format, layout or offset and leaves the array to the caller" "[arrow]")
+{
+    some_column const c( 10 );
+
+    ArrowArray  array;
+    ArrowSchema schema;
+
+    export_arrow( c.view(), &array, &schema );
+
+    std::error_code ec;
+
+    EXPECT_NOT( import_arrow<std::int64_t>( &array, &schema, ec ).has_value() );
+    EXPECT( ( ec == arrow_errc::format_mismatch ) );
+
+    array.offset = 3;
+    EXPECT_NOT( import_arrow<int>( &array, &schema, ec ).has_value() );
+    EXPECT( ( ec == arrow_errc::unsupported_offset ) );
+
+    array.offset    = 0;
+    array.n_buffers = 3;
+    EXPECT_NOT( import_arrow<int>( &array, &schema, ec ).has_value() );
+    EXPECT( ( ec == arrow_errc::unsupported_layout ) );
+
+    EXPECT( ( array.release != nullptr ) );
+
+    array.release( &array );
+    EXPECT_NOT( import_arrow<int>( &array, &schema, ec ).has_value() );
+    EXPECT( ( ec == arrow_errc::released ) );
+
+    schema.release( &schema );
+}
+
+} // anonymous namespace
+
+#endif // optfun_CPP17_OR_GREATER
+
+// end of file
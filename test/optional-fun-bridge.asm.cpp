@@ -0,0 +1,87 @@
+//
+// Copyright 2014-2017 by Martin Moene
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+// Compiled to assembly by asm-compare.cmake, which requires each function
+// piped_x to compile to the same instructions as its hand-written hand_x.
+
+#include <optional>
+#include "nonstd/optional-fun-bridge.hpp"
+
+#include <cmath>
+#include <cstdio>
+
+using namespace nonstd;
+
+extern "C" {
+
+void report();
+
+// from_sentinel:
+
+int piped_sentinel( int c )
+{
+    return from_sentinel( c, EOF ) | map_or( []( int x ) { return x + 1; }, 0 );
+}
+
+int hand_sentinel( int c )
+{
+    return c != EOF ? c + 1 : 0;
+}
+
+// from_errno:
+
+long piped_errno( long r )
+{
+    return from_errno( r ) | map_or( []( long n ) { return 2 * n; }, -1L );
+}
+
+long hand_errno( long r )
+{
+    return r >= 0 ? 2 * r : -1L;
+}
+
+bool piped_errno_or_else( long r )
+{
+    return ( from_errno( r ) | or_else( [] { report(); } ) ).has_value();
+}
+
+bool hand_errno_or_else( long r )
+{
+    if ( r < 0 )
+    {
+        report();
+        return false;
+    }
+    return true;
+}
+
+// from_nullable:
+
+int piped_nullable( int const * p )
+{
+    return from_nullable( p ) | map_or( []( int x ) { return x + 1; }, 0 );
+}
+
+int hand_nullable( int const * p )
+{
+    return p != nullptr ? *p + 1 : 0;
+}
+
+// from_predicate:
+
+double piped_predicate( double x )
+{
+    return from_predicate( x, []( double d ) { return ! std::isnan( d ); } ) | map_or( []( double d ) { return 2 * d; }, 0.0 );
+}
+
+double hand_predicate( double x )
+{
+    return ! std::isnan( x ) ? 2 * x : 0.0;
+}
+
+} // extern "C"
+
+// end of file
@@ -0,0 +1,87 @@
+//
+// Copyright 2014-2017 by Martin Moene
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+#include "optional-fun-main.t.hpp"
+#include "nonstd/optional-fun-bridge.hpp"
+
+#if optfun_CPP17_OR_GREATER
+
+#include <cerrno>
+#include <cmath>
+#include <cstdio>
+#include <string>
+
+using namespace nonstd;
+
+namespace {
+
+//
+// Bridges:
+//
+
+long read_some( long result, int error )
+{
+    errno = error;
+    return result;
+}
+
+CASE( "from_sentinel: a value unless it is the sentinel" "[bridge]")
+{
+    auto const next = []( int c ) { return char( c ); };
+
+    EXPECT( ( ( from_sentinel( int( 'a' ), EOF ) | map( next ) ) == 'a' ) );
+    EXPECT_NOT( ( from_sentinel( EOF, EOF ) | map( next ) ).has_value() );
+    EXPECT( ( ( from_sentinel( EOF, EOF ) | or_else( [] { return optional<int>( '\n' ); } ) ) == '\n' ) );
+    EXPECT( ( from_sentinel( std::string( "x" ), "" ) | map_or( []( std::string const & s ) { return s.size(); }, std::size_t( 0 ) ) ) == 1u );
+}
+
+CASE( "from_errno: a result unless negative, with errno for or_else" "[bridge]")
+{
+    int error = 0;
+    auto const remember = [&] { error = errno; };
+
+    EXPECT( ( ( from_errno( read_some( 42, 0 ) ) | or_else( remember ) ) == 42L ) );
+    EXPECT( error == 0 );
+    EXPECT_NOT( ( from_errno( read_some( -1, EAGAIN ) ) | or_else( remember ) ).has_value() );
+    EXPECT( error == EAGAIN );
+    EXPECT( ( ( from_errno( -EINVAL ) | and_then( []( int n ) { return optional<int>( n ); } ) ) == nullopt ) );
+    EXPECT( ( from_errno( 0 ) | map_or( []( int n ) { return n + 1; }, -1 ) ) == 1 );
+}
+
+CASE( "from_nullable: the pointee as an optional reference, without a copy" "[bridge]")
+{
+    int x = 7;
+    int * const none = nullptr;
+
+    EXPECT( ( from_nullable( &x ) | map_or( []( int v ) { return 2 * v; }, 0 ) ) == 14 );
+    EXPECT( ( from_nullable( none ) | map_or( []( int v ) { return 2 * v; }, 0 ) ) == 0 );
+
+    *from_nullable( &x ) = 8;
+
+    EXPECT( x == 8 );
+}
+
+CASE( "from_predicate: a value if the predicate holds, like not NaN" "[bridge]")
+{
+    auto const is_number = []( double d ) { return ! std::isnan( d ); };
+
+    EXPECT( ( from_predicate( std::sqrt( 4.0 ), is_number ) | map_or( []( double d ) { return d + 1; }, 0.0 ) ) == 3.0 );
+    EXPECT( ( from_predicate( std::nan( "" ), is_number ) | map_or( []( double d ) { return d + 1; }, 0.0 ) ) == 0.0 );
+    EXPECT( ( ( from_predicate( 5, []( int v ) { return v % 2 == 1; } ) | filter( []( int v ) { return v > 3; } ) ) == 5 ) );
+}
+
+CASE( "bridges: hold the raw result only, no presence flag" "[bridge]")
+{
+    EXPECT( sizeof( from_errno( 1L ) ) == sizeof( long ) );
+    EXPECT( sizeof( from_sentinel( 1, EOF ) ) == 2 * sizeof( int ) );
+    EXPECT( sizeof( from_nullable( static_cast<int *>( nullptr ) ) ) == sizeof( int * ) );
+}
+
+} // anonymous namespace
+
+#endif // optfun_CPP17_OR_GREATER
+
+// end of file
@@ -0,0 +1,175 @@
+//
+// Copyright 2014-2017 by Martin Moene
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+#include "optional-fun-main.t.hpp"
+#include "nonstd/optional-fun-codec.hpp"
+
+#if optfun_CPP17_OR_GREATER
+
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+using namespace nonstd;
+
+namespace {
+
+//
+// Optional codec:
+//
+
+std::vector< optional<int> > mixed()
+{
+    return { 1, -1, nullopt, nullopt, 300, -70000, nullopt, 0, 42 };
+}
+
+CASE( "codec: round trip of a range of optionals" "[codec]")
+{
+    std::vector<std::uint8_t> const bytes = encode_optionals( mixed() );
+
+    optional< std::vector< optional<int> > > const v = decode_optionals<int>( bytes.data(), bytes.size() );
+
+    EXPECT( v.has_value() );
+    EXPECT( ( *v == mixed() ) );
+}
+
+CASE( "codec: varint payload zigzag-encodes signed values, full range" "[codec]")
+{
+    std::vector< optional<std::int64_t> > const in = {
+        (std::numeric_limits<std::int64_t>::min)(), -1, 0, 1, (std::numeric_limits<std::int64_t>::max)() };
+
+    std::vector<std::uint8_t> const bytes = encode_optionals( in );
+
+    EXPECT( bytes.size() == 1u + 10u + 1u + 1u + 1u + 10u );
+    EXPECT( ( *decode_optionals<std::int64_t>( bytes.data(), bytes.size() ) == in ) );
+}
+
+CASE( "codec: fixed payload for floating point, and on request for integers" "[codec]")
+{
+    std::vector< optional<double> > const d = { 1.5, nullopt, -2.25 };
+    std::vector< optional<int>    > const i = { 1, nullopt, -2 };
+
+    std::vector<std::uint8_t> const bd = encode_optionals( d );
+    std::vector<std::uint8_t> const bi = encode_optionals<fixed_payload>( i );
+
+    EXPECT( bd.size() == 1u + 8u + 1u + 1u + 8u );
+    EXPECT( bi.size() == 1u + 4u + 1u + 1u + 4u );
+    EXPECT( ( *decode_optionals<double>( bd.data(), bd.size() ) == d ) );
+    EXPECT( ( *decode_optionals<int, fixed_payload>( bi.data(), bi.size() ) == i ) );
+}
+
+CASE( "codec: a run of empty optionals takes a few bytes" "[codec]")
+{
+    std::vector< optional<int> > v( 100000 );
+    v[ 50000 ] = 7;
+
+    std::vector<std::uint8_t> const bytes = encode_optionals( v );
+
+    EXPECT( bytes.size() == 3u + 1u + 1u + 3u );
+    EXPECT( ( *decode_optionals<int>( bytes.data(), bytes.size() ) == v ) );
+}
+
+CASE( "codec: encoder and decoder stream through small buffers" "[codec]")
+{
+    std::vector< optional<int> > in;
+    for ( int i = 0; i != 1000; ++i )
+    {
+        in.push_back( i % 7 < 3 ? optional<int>() : optional<int>( i * 1000 - 500000 ) );
+    }
+
+    std::vector< std::vector<std::uint8_t> > chunks;
+    auto sink = [&]( std::uint8_t const * data, std::size_t size ) { chunks.emplace_back( data, data + size ); };
+
+    optional_encoder<int> encoder( sink, 64 );
+    encoder.push_range( in );
+    encoder.finish();
+
+    EXPECT( chunks.size() > 10u );
+
+    // feed a byte at a time, so that tokens span buffers:
+
+    std::vector< optional<int> > out;
+    optional_decoder<int> decoder;
+
+    for ( auto const & chunk : chunks )
+    {
+        for ( std::uint8_t const b : chunk )
+        {
+            EXPECT( decoder.feed( &b, 1, [&]( optional<int> const & o ) { out.push_back( o ); } ) );
+        }
+    }
+
+    EXPECT( decoder.done() );
+    EXPECT( ( out == in ) );
+}
+
+CASE( "codec: decoder | stages applies them to each decoded optional" "[codec]")
+{
+    std::vector<std::uint8_t> const bytes = encode_optionals( mixed() );
+
+    auto decoder = optional_decoder<int>() | filter( []( int x ) { return x >= 0; } ) | map_or( []( int x ) { return 2 * x; }, -1 );
+
+    std::vector<int> out;
+
+    EXPECT( decoder.feed( bytes.data(), bytes.size(), [&]( int x ) { out.push_back( x ); } ) );
+    EXPECT( ( out == std::vector<int>{ 2, -1, -1, -1, 600, -1, -1, 0, 84 } ) );
+}
+
+CASE( "codec: malformed or incomplete input is rejected" "[codec]")
+{
+    std::vector<std::uint8_t> const bytes = encode_optionals( mixed() );
+
+    EXPECT_NOT( decode_optionals<int>( bytes.data(), bytes.size() - 1 ).has_value() );
+
+    std::vector<std::uint8_t> const overlong( 11, 0x80 );
+
+    EXPECT_NOT( decode_optionals<int>( overlong.data(), overlong.size() ).has_value() );
+
+    // a run of one present value, whose 10th varint byte holds only bit 63:
+
+    std::vector<std::uint8_t> top = { 0x03 };
+    top.insert( top.end(), 9, 0xff );
+    top.push_back( 0x01 );
+
+    EXPECT( ( decode_optionals<std::uint64_t>( top.data(), top.size() ).value()
+        == std::vector< optional<std::uint64_t> >{ std::numeric_limits<std::uint64_t>::max() } ) );
+
+    top.back() = 0x02;
+
+    EXPECT_NOT( decode_optionals<std::uint64_t>( top.data(), top.size() ).has_value() );
+}
+
+CASE( "codec: a decoder rejects a run beyond its maximum number of elements" "[codec]")
+{
+    std::vector< optional<int> > const v( 1000 );
+    std::vector<std::uint8_t> const bytes = encode_optionals( v );
+
+    EXPECT( decode_optionals<int>( bytes.data(), bytes.size(), 1000 ).has_value() );
+    EXPECT_NOT( decode_optionals<int>( bytes.data(), bytes.size(), 999 ).has_value() );
+
+    // an empty run of 2^62 elements in a header of 10 bytes:
+
+    std::vector<std::uint8_t> huge( 9, 0x80 );
+    huge.push_back( 0x01 );
+
+    std::size_t n = 0;
+    optional_decoder<int> decoder( 1u << 20 );
+
+    EXPECT_NOT( decoder.feed( huge.data(), huge.size(), [&]( optional<int> const & ) { ++n; } ) );
+    EXPECT( n == 0u );
+
+    std::vector< optional<int> > const mix = mixed();
+    std::vector<std::uint8_t> const mixed_bytes = encode_optionals( mix );
+
+    EXPECT_NOT( decode_optionals<int>( mixed_bytes.data(), mixed_bytes.size(), mix.size() - 1 ).has_value() );
+    EXPECT( ( decode_optionals<int>( mixed_bytes.data(), mixed_bytes.size(), mix.size() ).value() == mix ) );
+}
+
+} // anonymous namespace
+
+#endif // optfun_CPP17_OR_GREATER
+
+// end of file
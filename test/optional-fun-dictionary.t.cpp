@@ -0,0 +1,156 @@
+//
+// Copyright 2014-2017 by Martin Moene
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+#include "optional-fun-main.t.hpp"
+#include "nonstd/optional-fun-dictionary.hpp"
+
+#if optfun_CPP17_OR_GREATER
+
+#include <cctype>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using namespace nonstd;
+
+namespace {
+
+//
+// Dictionary column:
+//
+
+std::vector< optional<std::string> > cities()
+{
+    return { std::string( "Oslo" ), nullopt, std::string( "Lima" ), std::string( "Oslo" ), nullopt, std::string( "Rome" ), std::string( "Lima" ) };
+}
+
+CASE( "dictionary_column: rows are codes into the distinct strings" "[dictionary]")
+{
+    auto const rows = cities();
+    dictionary_column const c( rows );
+
+    EXPECT( c.size() == rows.size() );
+    EXPECT( c.dictionary().size() == 3u );
+    EXPECT( c.codes()[0] == c.codes()[3] );
+    EXPECT( c.codes()[1] == dictionary_column::empty_code );
+
+    for ( std::size_t i = 0; i != rows.size(); ++i )
+    {
+        EXPECT( ( c[i] == rows[i] ) );
+    }
+}
+
+CASE( "dictionary_column: iteration yields optional string views" "[dictionary]")
+{
+    dictionary_column c;
+
+    c.push_back( std::string_view( "a" ) );
+    c.push_back( nullopt );
+    c.push_back( std::string_view( "" ) );
+
+    std::vector< optional<std::string_view> > const rows( c.begin(), c.end() );
+
+    EXPECT( ( rows == std::vector< optional<std::string_view> >{ std::string_view( "a" ), nullopt, std::string_view( "" ) } ) );
+    EXPECT( c.dictionary().size() == 2u );
+}
+
+CASE( "dictionary_column: map invokes its function once per distinct string" "[dictionary]")
+{
+    dictionary_column const c( cities() );
+    int calls = 0;
+
+    std::vector< optional<std::size_t> > const lengths = c | map( [&]( std::string_view s ) { ++calls; return s.size(); } );
+
+    EXPECT( calls == 3 );
+    EXPECT( ( lengths == std::vector< optional<std::size_t> >{ 4u, nullopt, 4u, 4u, nullopt, 4u, 4u } ) );
+}
+
+CASE( "dictionary_column: and_then invokes its function once per distinct string" "[dictionary]")
+{
+    dictionary_column const c( cities() );
+    int calls = 0;
+
+    auto const romans = c | and_then( [&]( std::string_view s ) { ++calls; return s == "Rome" ? optional<int>( 1 ) : optional<int>(); } );
+
+    EXPECT( calls == 3 );
+    EXPECT( ( romans == std::vector< optional<int> >{ nullopt, nullopt, nullopt, nullopt, nullopt, 1, nullopt } ) );
+}
+
+CASE( "dictionary_column: a string result stays dictionary encoded" "[dictionary]")
+{
+    dictionary_column const c( cities() );
+
+    dictionary_column const initials = c | map( []( std::string_view s ) { return std::string( s.substr( 0, 1 ) ); } );
+
+    EXPECT( initials.dictionary().size() == 3u );
+    EXPECT( ( initials[0] == std::string_view( "O" ) ) );
+    EXPECT( ( initials[4] == nullopt ) );
+
+    dictionary_column const other = c | and_then( []( std::string_view s ) { return s == "Lima" ? optional<std::string_view>() : optional<std::string_view>( "x" ); } );
+
+    EXPECT( other.dictionary().size() == 1u );
+    EXPECT( ( std::vector< optional<std::string_view> >( other.begin(), other.end() )
+        == std::vector< optional<std::string_view> >{ std::string_view( "x" ), nullopt, nullopt, std::string_view( "x" ), nullopt, std::string_view( "x" ), nullopt } ) );
+}
+
+CASE( "dictionary_column: interned strings stay valid as the arena grows and the column moves" "[dictionary]")
+{
+    dictionary_column c;
+
+    for ( int i = 0; i != 20000; ++i )
+    {
+        c.push_back( std::string_view( std::to_string( i % 10000 ) ) );
+    }
+    c.push_back( std::string_view( std::string( 100000, 'x' ) ) );
+
+    dictionary_column const moved( std::move( c ) );
+
+    EXPECT( moved.dictionary().size() == 10001u );
+    EXPECT( ( moved[12345] == std::string_view( "2345" ) ) );
+    EXPECT( moved[20000]->size() == 100000u );
+    EXPECT( moved.memory_bytes() < 20001 * sizeof( optional<std::string> ) );
+}
+
+CASE( "dictionary_column: a moved-from column is empty and may be reused" "[dictionary]")
+{
+    dictionary_column c;
+
+    c.push_back( std::string_view( "a" ) );
+    c.push_back( nullopt );
+    {
+        dictionary_column const d( std::move( c ) );
+
+        EXPECT( d.size() == 2u );
+        EXPECT( ( d[0] == std::string_view( "a" ) ) );
+    }
+
+    EXPECT( c.empty() );
+    EXPECT( c.dictionary().empty() );
+    EXPECT( c.memory_bytes() == 0u );
+
+    c.push_back( std::string_view( "x" ) );
+    c.push_back( std::string_view( "a" ) );
+
+    EXPECT( c.size() == 2u );
+    EXPECT( ( c[0] == std::string_view( "x" ) ) );
+    EXPECT( ( c[1] == std::string_view( "a" ) ) );
+
+    dictionary_column e;
+    e.push_back( std::string_view( "e" ) );
+    e = std::move( c );
+
+    EXPECT( c.empty() );
+    c.push_back( std::string_view( "y" ) );
+
+    EXPECT( ( e[0] == std::string_view( "x" ) ) );
+    EXPECT( ( c[0] == std::string_view( "y" ) ) );
+}
+
+} // anonymous namespace
+
+#endif // optfun_CPP17_OR_GREATER
+
+// end of file
@@ -0,0 +1,165 @@
+//
+// Copyright 2014-2017 by Martin Moene
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+#include "optional-fun-main.t.hpp"
+#include "nonstd/optional-fun-fields.hpp"
+
+#if optfun_CPP17_OR_GREATER
+
+#include <cstdint>
+#include <string>
+#include <type_traits>
+
+using namespace nonstd;
+
+namespace {
+
+//
+// Optional fields:
+//
+
+using record = optional_fields< double, int, bool, double, std::int16_t, bool, double, int >;
+
+struct record_of_optionals
+{
+    optional<double>       a;
+    optional<int>          b;
+    optional<bool>         c;
+    optional<double>       d;
+    optional<std::int16_t> e;
+    optional<bool>         f;
+    optional<double>       g;
+    optional<int>          h;
+};
+
+// counts its live instances:
+
+struct counted
+{
+    static int live;
+
+    explicit counted( std::string s_ ) : s( std::move( s_ ) ) { ++live; }
+    counted( counted const & other ) : s( other.s ) { ++live; }
+    counted( counted && other ) noexcept : s( std::move( other.s ) ) { ++live; }
+    ~counted() { --live; }
+
+    counted & operator=( counted const & ) = default;
+
+    friend bool operator==( counted const & a, counted const & b ) { return a.s == b.s; }
+
+    std::string s;
+};
+
+int counted::live = 0;
+
+// throws on copy:
+
+struct boom
+{
+    boom() = default;
+    boom( boom const & ) { throw 42; }
+    boom & operator=( boom const & ) = default;
+
+    friend bool operator==( boom const &, boom const & ) { return true; }
+};
+
+CASE( "optional_fields: one presence mask and values by alignment, instead of a flag and padding per field" "[fields]")
+{
+    EXPECT( sizeof( record ) < sizeof( record_of_optionals ) );
+    EXPECT( sizeof( record ) == 3 * sizeof( double ) + 2 * sizeof( int ) + sizeof( std::int16_t ) + 3 * sizeof( bool ) + 1 + 2 );
+    EXPECT( sizeof( record::mask_type ) == 1u );
+    EXPECT( std::is_trivially_copyable_v< record > );
+    EXPECT( sizeof( optional_fields< int, int, int, int, int, int, int, int, int > ) == 9 * sizeof( int ) + sizeof( int ) );
+}
+
+CASE( "optional_fields: fields are optional references for the adaptors" "[fields]")
+{
+    record r( 1.5, nullopt, true, nullopt, std::int16_t( 7 ), nullopt, nullopt, 42 );
+
+    EXPECT( 3.0 == ( r.field<0>() | map( []( double x ) { return 2 * x; } ) ).value() );
+    EXPECT_NOT( ( r.field<1>() | map( []( int x ) { return 2 * x; } ) ).has_value() );
+    EXPECT( 5 == ( r.field<1>() | or_( 5 ) ) );
+    EXPECT( 43 == ( r.field<7>() | and_then( []( int x ) { return optional<int>( x + 1 ); } ) ).value() );
+
+    *r.field<7>() = 41;
+
+    EXPECT( 41 == *r.field<7>() );
+    EXPECT( r.has_value<2>() );
+    EXPECT_NOT( r.has_value<3>() );
+}
+
+CASE( "optional_fields: all_of is a single mask compare" "[fields]")
+{
+    record r( 1.5, nullopt, true, nullopt, std::int16_t( 7 ), nullopt, nullopt, 42 );
+
+    EXPECT( ( r.presence() == record::mask<0, 2, 4, 7> ) );
+    EXPECT( ( r.all_of( record::mask<0, 2, 7> ) ) );
+    EXPECT_NOT( ( r.all_of( record::mask<0, 1> ) ) );
+    EXPECT( ( r.any_of( record::mask<1, 2> ) ) );
+    EXPECT_NOT( ( r.any_of( record::mask<1, 3, 5, 6> ) ) );
+
+    r.emplace<1>( 3 );
+    r.reset<0>();
+
+    EXPECT( ( r.all_of( record::mask<1, 2, 4, 7> ) ) );
+    EXPECT_NOT( r.has_value<0>() );
+}
+
+CASE( "optional_fields: only present fields are constructed, copied and destroyed" "[fields]")
+{
+    using fields = optional_fields< counted, int, counted >;
+
+    EXPECT_NOT( std::is_trivially_copyable_v< fields > );
+    {
+        fields a( counted( "a" ), 1, nullopt );
+
+        EXPECT( counted::live == 1 );
+
+        fields b( a );
+        fields c( std::move( b ) );
+
+        EXPECT( counted::live == 3 );
+        EXPECT( ( a == c ) );
+
+        c.emplace<2>( "z" );
+        a = c;
+
+        EXPECT( counted::live == 5 );
+        EXPECT( "z" == a.field<2>()->s );
+
+        a.reset<0>();
+
+        EXPECT( counted::live == 4 );
+        EXPECT( ( a != c ) );
+    }
+    EXPECT( counted::live == 0 );
+}
+
+CASE( "optional_fields: a field that throws on copy leaves no other field behind" "[fields]")
+{
+    using fields = optional_fields< counted, boom, counted >;
+    {
+        fields a( counted( "a" ), nullopt, counted( "c" ) );
+        a.emplace<1>();
+        fields b( counted( "b" ), nullopt, nullopt );
+
+        EXPECT( counted::live == 3 );
+
+        EXPECT_THROWS( fields{ a } );
+        EXPECT( counted::live == 3 );
+
+        EXPECT_THROWS( b = a );
+        EXPECT( counted::live == 2 );
+        EXPECT( b.presence() == 0u );
+    }
+    EXPECT( counted::live == 0 );
+}
+
+} // anonymous namespace
+
+#endif // optfun_CPP17_OR_GREATER
+
+// end of file
@@ -32,6 +32,8 @@ CASE( "optional-fun-lite configuration" "[.config]" )
     optfun_PRESENT( optfun_USES_BOOST_OPTIONAL );
     optfun_PRESENT( optfun_USES_OPTIONAL_LITE );
     optfun_PRESENT( optfun_USES_STD_OPTIONAL );
+    optfun_PRESENT( optfun_CONFIG_NO_EXCEPTIONS );
+    optfun_PRESENT( optfun_CONFIG_INSTRUMENT );
 }
 
 CASE( "__cplusplus" "[.stdc++]" )
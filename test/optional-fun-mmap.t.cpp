@@ -0,0 +1,220 @@
+//
+// Copyright 2014-2017 by Martin Moene
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+#include "optional-fun-main.t.hpp"
+#include "nonstd/optional-fun-mmap.hpp"
+
+#if optfun_CPP17_OR_GREATER
+
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#if defined(_WIN32)
+# include <process.h>
+# define optfun_getpid  _getpid
+#else
+# include <unistd.h>
+# define optfun_getpid  getpid
+#endif
+
+using namespace nonstd;
+
+namespace {
+
+//
+// Nullable column files:
+//
+
+// a file per process, so that test runs in parallel do not share it:
+
+std::string const path = ( std::filesystem::temp_directory_path()
+    / ( "optional-fun-mmap.t." + std::to_string( optfun_getpid() ) + ".col" ) ).string();
+
+// remove the file at the end of a case:
+
+struct scoped_file
+{
+    ~scoped_file() { std::remove( path.c_str() ); }
+};
+
+std::vector< optional<int> > some_column( std::size_t n )
+{
+    std::vector< optional<int> > result;
+
+    for ( std::size_t i = 0; i != n; ++i )
+    {
+        result.push_back( i % 3 == 1 ? optional<int>() : optional<int>( static_cast<int>( i ) ) );
+    }
+    return result;
+}
+
+CASE( "column file: round trip of a range of optionals" "[mmap]")
+{
+    scoped_file file;
+    std::vector< optional<int> > const v = some_column( 1000 );
+
+    EXPECT_NOT( write_column( path, v ) );
+
+    std::error_code ec;
+    optional< mapped_column<int> > const c = map_column<int>( path, ec );
+
+    EXPECT_NOT( ec );
+    EXPECT( c.has_value() );
+    if ( ! c ) return;
+
+    EXPECT( c->size() == v.size() );
+    EXPECT( c->null_count() == 333u );
+    EXPECT( ( std::vector< optional<int> >( c->begin(), c->end() ) == v ) );
+    EXPECT( 6 == ( (*c)[3] | map( []( int x ) { return 2 * x; } ) ).value() );
+    EXPECT_NOT( ( (*c)[4] | map( []( int x ) { return 2 * x; } ) ).has_value() );
+}
+
+CASE( "column file: values are read in place from the mapping" "[mmap]")
+{
+    scoped_file file;
+
+    EXPECT_NOT( write_column( path, some_column( 100 ) ) );
+
+    std::error_code ec;
+    optional< mapped_column<int> > const c = map_column<int>( path, ec );
+
+    EXPECT( c.has_value() );
+    if ( ! c ) return;
+
+    auto const base   = reinterpret_cast<std::uintptr_t>( c->file_data() );
+    auto const values = reinterpret_cast<std::uintptr_t>( c->view().values() );
+    auto const bitmap = reinterpret_cast<std::uintptr_t>( c->view().validity() );
+
+    EXPECT( values == base + 64 );
+    EXPECT( bitmap == base + 64 + 448 );
+    EXPECT( c->file_size() == 64u + 448u + 64u );
+}
+
+CASE( "column file: range stages take the view" "[mmap]")
+{
+    scoped_file file;
+    std::vector< optional<int> > const v = some_column( 130 );
+
+    EXPECT_NOT( write_column( path, v ) );
+
+    std::error_code ec;
+    optional< mapped_column<int> > const c = map_column<int>( path, ec );
+
+    EXPECT( c.has_value() );
+    if ( ! c ) return;
+
+    EXPECT( ( c->view() | sum_present() ) == ( v | sum_present() ) );
+    EXPECT( ( c->view() | count_present() ) == ( v | count_present() ) );
+}
+
+CASE( "column file: all present omits the validity bitmap" "[mmap]")
+{
+    scoped_file file;
+    std::vector< optional<double> > const v = { 1.5, 2.5, 3.5 };
+
+    EXPECT_NOT( write_column( path, v ) );
+
+    std::error_code ec;
+    optional< mapped_column<double> > const c = map_column<double>( path, ec );
+
+    EXPECT( c.has_value() );
+    if ( ! c ) return;
+
+    EXPECT( c->null_count() == 0u );
+    EXPECT( c->view().validity() == nullptr );
+    EXPECT( ( std::vector< optional<double> >( c->begin(), c->end() ) == v ) );
+}
+
+CASE( "column file: write a nullable_view, and an empty column" "[mmap]")
+{
+    scoped_file file;
+    std::int64_t const values[]   = { 7, 0, 9 };
+    std::uint8_t const validity[] = { 0x05 };
+
+    EXPECT_NOT( write_column( path, nullable_view<std::int64_t>( values, validity, 3 ) ) );
+
+    std::error_code ec;
+    optional< mapped_column<std::int64_t> > const c = map_column<std::int64_t>( path, ec );
+
+    EXPECT( c.has_value() );
+    if ( ! c ) return;
+
+    EXPECT( c->null_count() == 1u );
+    EXPECT( ( std::vector< optional<std::int64_t> >( c->begin(), c->end() ) == std::vector< optional<std::int64_t> >{ 7, nullopt, 9 } ) );
+
+    EXPECT_NOT( write_column( path, std::vector< optional<std::int64_t> >() ) );
+
+    optional< mapped_column<std::int64_t> > const e = map_column<std::int64_t>( path, ec );
+
+    EXPECT( e.has_value() );
+    if ( ! e ) return;
+
+    EXPECT( e->empty() );
+    EXPECT( ( e->begin() == e->end() ) );
+}
+
+CASE( "column file: map_column reports a missing file, another type, a truncated file" "[mmap]")
+{
+    scoped_file file;
+    std::error_code ec;
+
+    std::remove( path.c_str() );
+    EXPECT_NOT( map_column<int>( path, ec ).has_value() );
+    EXPECT( ( ec == std::errc::no_such_file_or_directory ) );
+
+    EXPECT_NOT( write_column( path, some_column( 10 ) ) );
+
+    EXPECT_NOT( map_column<unsigned>( path, ec ).has_value() );
+    EXPECT( ( ec == column_errc::type_mismatch ) );
+    EXPECT_NOT( map_column<float>( path, ec ).has_value() );
+    EXPECT( ( ec == column_errc::type_mismatch ) );
+
+    std::FILE * f = std::fopen( path.c_str(), "wb" );
+    std::fputs( "not a column file, yet long enough to hold a column file header....", f );
+    std::fclose( f );
+
+    EXPECT_NOT( map_column<int>( path, ec ).has_value() );
+    EXPECT( ( ec == column_errc::bad_magic ) );
+
+    std::vector<char> bytes( 64 + 64 );
+    EXPECT_NOT( write_column( path, some_column( 100 ) ) );
+
+    f = std::fopen( path.c_str(), "rb" );
+    std::size_t const n = std::fread( bytes.data(), 1, bytes.size(), f );
+    std::fclose( f );
+
+    f = std::fopen( path.c_str(), "wb" );
+    std::fwrite( bytes.data(), 1, n, f );
+    std::fclose( f );
+
+    EXPECT_NOT( map_column<int>( path, ec ).has_value() );
+    EXPECT( ( ec == column_errc::truncated ) );
+}
+
+CASE( "column file: write_column reports a failure to open or to write" "[mmap]")
+{
+    std::string const missing = ( std::filesystem::temp_directory_path() / "optional-fun-mmap.t.missing" / "c.col" ).string();
+
+    EXPECT( ( write_column( missing, some_column( 10 ) ) == std::errc::no_such_file_or_directory ) );
+
+#if ! defined(_WIN32)
+    if ( std::FILE * const full = std::fopen( "/dev/full", "wb" ) )
+    {
+        std::fclose( full );
+
+        EXPECT( write_column( "/dev/full", some_column( 10000 ) ) );
+    }
+#endif
+}
+
+} // anonymous namespace
+
+#endif // optfun_CPP17_OR_GREATER
+
+// end of file
@@ -0,0 +1,64 @@
+// Copyright 2017-2018 by Martin Moene
+//
+// https://github.com/martinmoene/optional-fun-lite
+//
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+// Test optional-fun-lite compiled with exceptions disabled, e.g. via -fno-exceptions.
+// lest requires exceptions, so this test is self-contained.
+
+#include optfun_OPTIONAL_HEADER
+#include "nonstd/optional-fun.hpp"
+
+#include <iostream>
+
+#if ! optfun_CONFIG_NO_EXCEPTIONS
+# error Expecting optfun_CONFIG_NO_EXCEPTIONS to be 1: compile with exceptions disabled.
+#endif
+
+#define EXPECT( expr ) \
+    ( (expr) ? (void)0 : (void)( ++failures, std::cerr << __FILE__ << "(" << __LINE__ << "): failed: " << #expr << "\n" ) )
+
+using namespace nonstd;
+
+namespace {
+
+int failures = 0;
+
+int  double_int( int   arg   ) { return 2 * arg; }
+void voider_int( int /*arg*/ ) {}
+int  seven() { return 7; }
+
+optional<int> double_opt( int   arg   ) { return 2 * arg; }
+optional<int> fail_opt  ( int /*arg*/ ) { return nullopt; }
+
+} // anonymous namespace
+
+int main()
+{
+    EXPECT( 42 == *(optional<int>(21) | map( double_int )) );
+    EXPECT(        (optional<int>(21) | map( voider_int )).has_value() );
+    EXPECT( !      (optional<int>(  ) | map( double_int )).has_value() );
+
+    EXPECT( 14 ==  (optional<int>( 7) | map_or( double_int, 42 )) );
+    EXPECT( 42 ==  (optional<int>(  ) | map_or( double_int, 42 )) );
+
+    EXPECT( 14 == *(optional<int>( 7) | map_branchless( double_int )) );
+    EXPECT( 42 ==  (optional<int>(  ) | map_or_branchless( double_int, 42 )) );
+
+    EXPECT(  7 ==  (optional<int>(  ) | map_or_else( double_int, seven )) );
+
+    EXPECT( 42 == *(optional<int>(21) | and_then( double_opt )) );
+    EXPECT( !      (optional<int>(21) | and_then( fail_opt ).likely()).has_value() );
+
+    EXPECT(  7 == *(optional<int>(  ) | or_else( seven )) );
+    EXPECT( 42 == *(optional<int>( 7) | and_( 42 )) );
+    EXPECT( 42 ==  (optional<int>(  ) | or_( 42 )) );
+
+    std::cout << ( failures ? "failed" : "passed" ) << ": optional-fun-lite without exceptions\n";
+
+    return failures;
+}
+
+// end of file
@@ -0,0 +1,201 @@
+//
+// Copyright 2014-2017 by Martin Moene
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+#include "optional-fun-main.t.hpp"
+#include "nonstd/optional-fun-packed.hpp"
+
+#if optfun_CPP17_OR_GREATER
+
+#include <cstdint>
+#include <vector>
+
+using namespace nonstd;
+
+namespace {
+
+//
+// Packed optional array:
+//
+
+enum class flag : std::uint8_t { off, on, beta, gamma };
+
+std::vector< optional<bool> > tri_state( std::size_t n )
+{
+    std::vector< optional<bool> > result( n );
+
+    for ( std::size_t i = 0; i != n; ++i )
+    {
+        if ( i % 3 != 0 )
+        {
+            result[i] = i % 5 < 2;
+        }
+    }
+    return result;
+}
+
+std::vector< optional<flag> > flags( std::size_t n )
+{
+    std::vector< optional<flag> > result( n );
+
+    for ( std::size_t i = 0; i != n; ++i )
+    {
+        if ( i % 4 != 0 )
+        {
+            result[i] = static_cast<flag>( i % 3 );
+        }
+    }
+    return result;
+}
+
+// packed result agrees with the stage applied to each element:
+
+template< typename P, typename D, typename S >
+bool same_as_each( P const & packed, D const & dense, S const & s )
+{
+    bool ok = packed.size() == dense.size();
+
+    for ( std::size_t i = 0; ok && i != dense.size(); ++i )
+    {
+        ok = packed[i] == optional< typename P::value_type::value_type >( dense[i] | s );
+    }
+    return ok;
+}
+
+CASE( "packed_optional_array: optional<bool> in 2 bits per element" "[packed]")
+{
+    auto const dense = tri_state( 1000 );
+
+    packed_optional_array const a( dense );
+
+    EXPECT( a.size() == 1000u );
+    EXPECT( a.words().size() == ( 1000u + 31 ) / 32 );
+    EXPECT( ( std::vector< optional<bool> >( a.begin(), a.end() ) == dense ) );
+    EXPECT( a.count() == 666u );
+}
+
+CASE( "packed_optional_array: proxy reference converts, assigns and pipes like an optional" "[packed]")
+{
+    packed_optional_array<bool> a( 40 );
+
+    a[33] = true;
+    a[34] = false;
+    a[35] = a[33];
+
+    optional<bool> const o = a[33];
+
+    EXPECT( o.value() );
+    EXPECT( a[35].has_value() );
+    EXPECT_NOT( a[32].has_value() );
+    EXPECT_NOT( a[34].get().value() );
+    EXPECT( 1 == ( a[33] | map( []( bool b ) { return b ? 1 : 0; } ) ).value() );
+
+    a[33] = nullopt;
+
+    EXPECT_NOT( a[33].has_value() );
+    EXPECT( a.count() == 2u );
+}
+
+CASE( "packed_optional_array: map evaluates f once per distinct value" "[packed]")
+{
+    auto const dense = flags( 500 );
+
+    packed_optional_array<flag> const a( dense );
+
+    int calls = 0;
+    auto const bump = map( [&]( flag f ) { ++calls; return static_cast<flag>( static_cast<int>( f ) + 1 ); } );
+
+    packed_optional_array<flag> const b = a | bump;
+
+    EXPECT( calls == 3 );
+    EXPECT( same_as_each( b, dense, bump ) );
+}
+
+CASE( "packed_optional_array: map to another type, and_then" "[packed]")
+{
+    auto const dense = flags( 300 );
+
+    packed_optional_array<flag> const a( dense );
+
+    auto const is_on = map( []( flag f ) { return f == flag::on; } );
+    auto const known = and_then( []( flag f ) { return f == flag::beta ? optional<bool>() : optional<bool>( f == flag::on ); } );
+
+    EXPECT( same_as_each( a | is_on, dense, is_on ) );
+    EXPECT( same_as_each( a | known, dense, known ) );
+}
+
+CASE( "packed_optional_array: and_ and or_ with a value, an optional or another array" "[packed]")
+{
+    auto const dense = tri_state( 200 );
+
+    packed_optional_array<bool> const a( dense );
+
+    EXPECT( same_as_each( a | and_( false ), dense, and_( false ) ) );
+    EXPECT( same_as_each( a | or_( true ), dense, or_( true ) ) );
+    EXPECT( ( ( a | or_( optional<bool>() ) ) == a ) );
+    EXPECT( ( a | or_( true ) ).count() == a.size() );
+
+    std::vector< optional<bool> > other( 200 );
+    for ( std::size_t i = 0; i != other.size(); ++i )
+    {
+        other[i] = i % 2 == 0 ? optional<bool>( i % 4 == 0 ) : optional<bool>();
+    }
+
+    packed_optional_array<bool> const b( other );
+    packed_optional_array<bool> const a_and_b = a | and_( b );
+    packed_optional_array<bool> const a_or_b  = a | or_ ( b );
+
+    bool ok = true;
+    for ( std::size_t i = 0; i != dense.size(); ++i )
+    {
+        ok = ok && a_and_b[i] == ( dense[i] ? other[i] : optional<bool>() );
+        ok = ok && a_or_b [i] == ( dense[i] ? dense[i] : other[i] );
+    }
+    EXPECT( ok );
+}
+
+CASE( "packed_optional_array: values up to 2^Bits - 2 fit in a field" "[packed]")
+{
+    packed_optional_array<unsigned> a( 3 );
+
+    a[0] = 14u;
+    a[1] = 0u;
+    a[2] = nullopt;
+
+    EXPECT( ( a.get( 0 ) == optional<unsigned>( 14u ) ) );
+    EXPECT( ( a.get( 1 ) == optional<unsigned>( 0u ) ) );
+    EXPECT_NOT( a.get( 2 ).has_value() );
+
+    auto const b = a | map( []( unsigned x ) { return 14u - x; } );
+
+    EXPECT( ( b.get( 0 ) == optional<unsigned>( 0u ) ) );
+    EXPECT( ( b.get( 1 ) == optional<unsigned>( 14u ) ) );
+    EXPECT_NOT( b.get( 2 ).has_value() );
+}
+
+CASE( "packed_optional_array: 8-bit fields for larger enumerations" "[packed]")
+{
+    std::vector< optional<std::uint8_t> > dense( 100 );
+    for ( std::size_t i = 0; i != dense.size(); ++i )
+    {
+        if ( i % 7 != 0 )
+        {
+            dense[i] = static_cast<std::uint8_t>( i );
+        }
+    }
+
+    packed_optional_array<std::uint8_t, 8> const a( dense );
+
+    auto const half = map( []( std::uint8_t x ) { return static_cast<std::uint8_t>( x / 2 ); } );
+
+    EXPECT( a.words().size() == 13u );
+    EXPECT( same_as_each( a | half, dense, half ) );
+}
+
+} // anonymous namespace
+
+#endif // optfun_CPP17_OR_GREATER
+
+// end of file
@@ -0,0 +1,137 @@
+//
+// Copyright 2014-2017 by Martin Moene
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+#include "optional-fun-main.t.hpp"
+#include "nonstd/optional-fun-parse.hpp"
+
+#if optfun_CPP17_OR_GREATER
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using namespace nonstd;
+
+namespace {
+
+//
+// Parse:
+//
+
+using time_point = std::chrono::system_clock::time_point;
+
+time_point utc( std::int64_t seconds_since_epoch, std::int64_t ms = 0 )
+{
+    return time_point( std::chrono::duration_cast<time_point::duration>( std::chrono::seconds( seconds_since_epoch ) + std::chrono::milliseconds( ms ) ) );
+}
+
+CASE( "parse_value: integers of the whole text, nullopt otherwise" "[parse]")
+{
+    EXPECT( ( parse_value<int>( "42" ) == 42 ) );
+    EXPECT( ( parse_value<int>( "-7" ) == -7 ) );
+    EXPECT( ( parse_value<std::int64_t>( "9007199254740993" ) == std::int64_t( 9007199254740993 ) ) );
+
+    EXPECT_NOT( parse_value<int>( "" ).has_value() );
+    EXPECT_NOT( parse_value<int>( "4x" ).has_value() );
+    EXPECT_NOT( parse_value<int>( " 4" ).has_value() );
+    EXPECT_NOT( parse_value<int>( "99999999999" ).has_value() );
+    EXPECT_NOT( parse_value<unsigned>( "-1" ).has_value() );
+    EXPECT_NOT( parse_value<std::int8_t>( "128" ).has_value() );
+}
+
+CASE( "parse_value: floating point and bool" "[parse]")
+{
+    EXPECT( ( parse_value<double>( "2.5" ) == 2.5 ) );
+    EXPECT( ( parse_value<double>( "-1e3" ) == -1000.0 ) );
+    EXPECT( ( parse_value<float>( "0.25" ) == 0.25f ) );
+    EXPECT_NOT( parse_value<double>( "2.5." ).has_value() );
+    EXPECT_NOT( parse_value<double>( "" ).has_value() );
+    EXPECT_NOT( parse_value<double>( "+2.5" ).has_value() );
+    EXPECT_NOT( parse_value<double>( "0x1p3" ).has_value() );
+
+    EXPECT( ( parse_value<bool>( "true" ) == true ) );
+    EXPECT( ( parse_value<bool>( "0" ) == false ) );
+    EXPECT_NOT( parse_value<bool>( "yes" ).has_value() );
+}
+
+CASE( "parse_value: ISO 8601 timestamps" "[parse]")
+{
+    EXPECT( ( parse_value<time_point>( "1970-01-01" ) == utc( 0 ) ) );
+    EXPECT( ( parse_value<time_point>( "2000-03-01T00:00:00Z" ) == utc( 951868800 ) ) );
+    EXPECT( ( parse_value<time_point>( "2024-02-29 12:34:56.789" ) == utc( 1709210096, 789 ) ) );
+    EXPECT( ( parse_value<time_point>( "2024-02-29T14:34:56+02:00" ) == utc( 1709210096 ) ) );
+    EXPECT( ( parse_value<time_point>( "1969-12-31T23:59:59Z" ) == utc( -1 ) ) );
+
+    EXPECT_NOT( parse_value<time_point>( "2023-02-29" ).has_value() );
+    EXPECT_NOT( parse_value<time_point>( "2024-13-01" ).has_value() );
+    EXPECT_NOT( parse_value<time_point>( "2024-01-01T24:00:00" ).has_value() );
+    EXPECT_NOT( parse_value<time_point>( "2024-01-01T10:00" ).has_value() );
+    EXPECT_NOT( parse_value<time_point>( "2024-01-01T10:00:00." ).has_value() );
+    EXPECT_NOT( parse_value<time_point>( "2024-01-01T10:00:00Zulu" ).has_value() );
+}
+
+CASE( "parse_value: a timestamp outside the range of the clock is nullopt" "[parse]")
+{
+    using std::chrono::seconds;
+
+    auto const representable = []( std::int64_t s )
+    {
+        return std::chrono::duration_cast<seconds>( time_point::duration::min() ) <= seconds( s )
+            && seconds( s ) < std::chrono::duration_cast<seconds>( time_point::duration::max() );
+    };
+
+    std::int64_t const dates[] = { -11676096000, 10413792000, 253402214400 };
+    char const * const texts[] = { "1600-01-01", "2300-01-01", "9999-12-31" };
+
+    for ( std::size_t i = 0; i != 3; ++i )
+    {
+        optional<time_point> const t = parse_value<time_point>( texts[i] );
+
+        EXPECT( t.has_value() == representable( dates[i] ) );
+
+        if ( t.has_value() )
+        {
+            EXPECT( ( *t == utc( dates[i] ) ) );
+        }
+    }
+
+    EXPECT( parse_value<time_point>( "1677-09-21T00:12:44Z" ).has_value() );
+    EXPECT( parse_value<time_point>( "2262-04-11T23:47:15.999999999Z" ).has_value() );
+}
+
+CASE( "parse: and_then stage over optional text" "[parse]")
+{
+    optional<std::string_view> const field( "21" );
+    optional<std::string_view> const bad( "2l" );
+    optional<std::string_view> const none;
+
+    EXPECT( ( ( field | parse<int>() | map( []( int x ) { return 2 * x; } ) ) == 42 ) );
+    EXPECT_NOT( ( bad  | parse<int>() ).has_value() );
+    EXPECT_NOT( ( none | parse<int>() ).has_value() );
+    EXPECT( ( optional<std::string>( "1.5" ) | parse<double>() | or_( 0.0 ) ) == 1.5 );
+
+    auto const chain = parse<int>() | filter( []( int x ) { return x > 0; } );
+
+    EXPECT( ( ( field | chain ) == 21 ) );
+    EXPECT( ( ( field | and_then( parse_value<long> ) ) == 21L ) );
+}
+
+CASE( "parse_all: a column of fields at once" "[parse]")
+{
+    std::vector< optional<std::string_view> > const fields = { std::string_view( "1" ), nullopt, std::string_view( "x" ), std::string_view( "-4" ) };
+    std::vector< std::string_view > const texts = { "0.5", "1e-1", "" };
+
+    EXPECT( ( ( fields | parse_all<int>() ) == std::vector< optional<int> >{ 1, nullopt, nullopt, -4 } ) );
+    EXPECT( ( parse_all<double>( texts ) == std::vector< optional<double> >{ 0.5, 0.1, nullopt } ) );
+}
+
+} // anonymous namespace
+
+#endif // optfun_CPP17_OR_GREATER
+
+// end of file
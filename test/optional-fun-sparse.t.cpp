@@ -0,0 +1,173 @@
+//
+// Copyright 2014-2017 by Martin Moene
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+#include "optional-fun-main.t.hpp"
+#include "nonstd/optional-fun-sparse.hpp"
+
+#if optfun_CPP17_OR_GREATER
+
+#include <cstdint>
+#include <vector>
+
+using namespace nonstd;
+
+namespace {
+
+//
+// Sparse optional vector:
+//
+
+// mostly empty: i present if i % 7 == 3 or in a dense run of [1000, 1100):
+
+std::vector< optional<int> > mostly_empty( std::size_t n )
+{
+    std::vector< optional<int> > result( n );
+
+    for ( std::size_t i = 0; i != n; ++i )
+    {
+        if ( i % 7 == 3 || ( i >= 1000 && i < 1100 ) )
+        {
+            result[i] = static_cast<int>( i );
+        }
+    }
+    return result;
+}
+
+CASE( "rank_select_bitmap: rank and select agree with a scan, across words and blocks" "[sparse]")
+{
+    rank_select_bitmap bits;
+
+    for ( std::size_t i = 0; i != 5000; ++i )
+    {
+        bits.push_back( i % 7 == 3 || ( i >= 1000 && i < 1100 ) || i == 4999 );
+    }
+
+    std::size_t ones = 0;
+    bool ok = true;
+
+    for ( std::size_t i = 0; i != bits.size(); ++i )
+    {
+        ok = ok && bits.rank( i ) == ones;
+
+        if ( bits.test( i ) )
+        {
+            ok = ok && bits.select( ones ) == i;
+            ++ones;
+        }
+    }
+
+    EXPECT( ok );
+    EXPECT( ones == bits.count() );
+    EXPECT( bits.rank( bits.size() ) == bits.count() );
+    EXPECT( bits.select( bits.count() - 1 ) == 4999u );
+}
+
+CASE( "rank_select_bitmap: from words, the same as pushed bit by bit" "[sparse]")
+{
+    rank_select_bitmap pushed;
+    std::vector<std::uint64_t> words( 20 );
+
+    for ( std::size_t i = 0; i != 1234; ++i )
+    {
+        bool const bit = i % 5 == 0 || i > 1200;
+
+        pushed.push_back( bit );
+        words[ i / 64 ] |= std::uint64_t( bit ) << ( i % 64 );
+    }
+
+    words[19] = ~std::uint64_t( 0 );   // beyond size, ignored
+
+    rank_select_bitmap const built( words, 1234 );
+
+    EXPECT( built.count() == pushed.count() );
+    EXPECT( built.rank( 1000 ) == pushed.rank( 1000 ) );
+    EXPECT( built.select( 200 ) == pushed.select( 200 ) );
+    EXPECT( built.select( built.count() - 1 ) == 1233u );
+}
+
+CASE( "sparse_optional_vector: elements and iteration match the dense optionals" "[sparse]")
+{
+    auto const dense = mostly_empty( 3000 );
+
+    sparse_optional_vector<int> const v( dense );
+
+    EXPECT( v.size() == dense.size() );
+    EXPECT( v.count() == v.values().size() );
+    EXPECT( 3 == v[3].value() );
+    EXPECT( 1042 == v[1042].value() );
+    EXPECT_NOT( v[4].has_value() );
+    EXPECT( ( std::vector< optional<int> >( v.begin(), v.end() ) == dense ) );
+}
+
+CASE( "sparse_optional_vector: stores only the present values" "[sparse]")
+{
+    std::vector< optional<double> > dense( 100000 );
+    dense[ 17 ] = 1.0;
+    dense[ 99999 ] = 2.0;
+
+    sparse_optional_vector const v( dense );
+
+    EXPECT( v.count() == 2u );
+    EXPECT( v.memory_bytes() < dense.size() / 4 );
+}
+
+CASE( "sparse_optional_vector: present() visits the present elements only, in order" "[sparse]")
+{
+    auto const dense = mostly_empty( 3000 );
+
+    sparse_optional_vector<int> const v( dense );
+
+    std::size_t n = 0;
+    bool ok = true;
+
+    for ( auto const [index, value] : v.present() )
+    {
+        ok = ok && dense[ index ] == value;
+        ++n;
+    }
+
+    EXPECT( ok );
+    EXPECT( n == v.count() );
+
+    sparse_optional_vector<int> const none( std::vector< optional<int> >( 200 ) );
+
+    EXPECT( ( none.present().begin() == none.present().end() ) );
+}
+
+CASE( "sparse_optional_vector: map, map_or and and_then invoke f on present values only" "[sparse]")
+{
+    auto const dense = mostly_empty( 2000 );
+
+    sparse_optional_vector<int> const v( dense );
+
+    std::size_t calls = 0;
+
+    sparse_optional_vector<long> const twice = v | map( [&]( int x ) { ++calls; return 2L * x; } );
+
+    EXPECT( calls == v.count() );
+    EXPECT( 2084L == twice[1042].value() );
+    EXPECT_NOT( twice[4].has_value() );
+
+    std::vector<int> const filled = v | map_or( []( int x ) { return -x; }, 0 );
+
+    EXPECT( filled.size() == v.size() );
+    EXPECT( -3 == filled[3] );
+    EXPECT(  0 == filled[4] );
+
+    auto const even = v | and_then( []( int x ) { return x % 2 == 0 ? optional<int>( x / 2 ) : optional<int>(); } );
+
+    EXPECT( even.size() == v.size() );
+    EXPECT( 5 == even[10].value() );
+    EXPECT_NOT( even[3].has_value() );
+    EXPECT( even.count() == even.presence().count() );
+    EXPECT( even.presence().select( 0 ) == 10u );
+}
+
+} // anonymous namespace
+
+#endif // optfun_CPP17_OR_GREATER
+
+// end of file
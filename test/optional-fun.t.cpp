@@ -10,6 +10,9 @@
 
 #include "optional-fun-main.t.hpp"
 
+#include <cmath>
+#include <limits>
+
 using namespace nonstd;
 
 namespace {
@@ -51,6 +54,22 @@ CASE( "optional map_or(f): " "[functional]")
     EXPECT( 42 == (optional<int>(   ) | map_or( double_int, 42 )) );
 }
 
+double halve_double( double arg ) { return arg / 2; }
+
+CASE( "optional map_branchless(f): " "[functional]")
+{
+    EXPECT( 14  == (optional<int>   ( 7 ) | map_branchless( double_int   )).value() );
+    EXPECT( 3.5 == (optional<double>( 7 ) | map_branchless( halve_double )).value() );
+    EXPECT_NOT(    (optional<int>   (   ) | map_branchless( double_int   )).has_value() );
+    EXPECT_NOT(    (optional<double>(   ) | map_branchless( halve_double )).has_value() );
+}
+
+CASE( "optional map_or_branchless(f, u): " "[functional]")
+{
+    EXPECT( 14 == (optional<int>( 7 ) | map_or_branchless( double_int, 42 )) );
+    EXPECT( 42 == (optional<int>(   ) | map_or_branchless( double_int, 42 )) );
+}
+
 int seven() { return 7; }
 
 CASE( "optional map_or_else(f): " "[functional]")
@@ -105,10 +124,1088 @@ CASE( "optional or_(rhs): " "[functional]")
     EXPECT( 42 == (optional<int>( ) | or_( 42 )) );
 }
 
+bool is_even( int arg ) { return arg % 2 == 0; }
+
+CASE( "optional filter(p): " "[functional]")
+{
+    EXPECT(  42 == (optional<int>(42) | filter( is_even )).value() );
+    EXPECT_NOT(    (optional<int>(21) | filter( is_even )).has_value() );
+    EXPECT_NOT(    (optional<int>(  ) | filter( is_even )).has_value() );
+}
+
 //CASE( "optional take(): " "[functional]")
 //{
 //}
 
+CASE( "optional named(name): stage name does not change the result" "[functional]")
+{
+    EXPECT(  42 == (optional<int>(21) | map( double_int ).named( "double" )).value() );
+    EXPECT(   7 == (optional<int>(  ) | map_or( double_int, 7 ).named( "double-or-7" )) );
+    EXPECT_NOT(    (optional<int>(21) | and_then( fail_opt ).named( "fail" )).has_value() );
+}
+
+CASE( "optional likely(), unlikely(): presence hint does not change the result" "[functional]")
+{
+    EXPECT(  42 == (optional<int>(21) | map( double_int ).likely()).value() );
+    EXPECT_NOT(    (optional<int>(  ) | map( double_int ).unlikely()).has_value() );
+    EXPECT(  14 == (optional<int>( 7) | map_or( double_int, 42 ).unlikely()) );
+    EXPECT(  42 == (optional<int>(  ) | map_or( double_int, 42 ).likely()) );
+    EXPECT(   7 == (optional<int>(  ) | map_or_else( double_int, seven ).likely()) );
+    EXPECT(  42 == (optional<int>(21) | and_then( double_opt ).likely().named( "double" )).value() );
+    EXPECT(  42 == (optional<int>(21) | then( double_opt ).unlikely()).value() );
+    EXPECT(   7 == (optional<int>(  ) | or_else( fun_or_else_nonvoid ).likely()).value() );
+    EXPECT(  42 == (optional<int>( 7) | and_( 42 ).unlikely()).value() );
+    EXPECT(  42 == (optional<int>(  ) | or_( 42 ).likely()) );
+}
+
+// functor that counts its copies:
+
+struct twice_counted
+{
+    typedef int result_type;
+
+    static int copies;
+
+    twice_counted() {}
+    twice_counted( twice_counted const & ) { ++copies; }
+
+    int operator()( int arg ) const { return 2 * arg; }
+};
+
+int twice_counted::copies = 0;
+
+CASE( "optional function_ref<R(A)>: adaptors call the callable without copying it" "[functional]")
+{
+    twice_counted const twice;
+    twice_counted::copies = 0;
+
+    EXPECT( 42 == (optional<int>(21) | map( function_ref<int(int)>( twice ) )).value() );
+    EXPECT( 42 == (optional<int>(21) | map( function_ref<int(int)>( double_int ) )).value() );
+    EXPECT( 42 == (optional<int>(21) | and_then( function_ref<optional<int>(int)>( double_opt ) )).value() );
+    EXPECT(  7 == (optional<int>(  ) | or_else( function_ref<int()>( seven ) )).value() );
+    EXPECT(  7 == (optional<int>(  ) | map_or_else( function_ref<int(int)>( twice ), function_ref<int()>( seven ) )) );
+    EXPECT(  0 == twice_counted::copies );
+}
+
+CASE( "optional function_ref<R(A)>: keeps a function pointer by value" "[functional]")
+{
+    int (*p)(int) = double_int;
+
+    function_ref<int(int)> const from_pointer( p );
+    function_ref<int(int)> const from_temporary( &double_int );
+
+    p = 0;
+
+    EXPECT( 42 == (optional<int>(21) | map( from_pointer )).value() );
+    EXPECT( 42 == (optional<int>(21) | map( from_temporary )).value() );
+}
+
+#if optfun_CPP11_OR_GREATER
+CASE( "optional operator|: applying a stage does not copy its callable" "[functional]")
+{
+    twice_counted const twice;
+
+    auto const stage = map( twice );
+    twice_counted::copies = 0;
+
+    EXPECT( 42 == (optional<int>(21) | stage).value() );
+    EXPECT( 42 == (optional<int>(21) | stage).value() );
+    EXPECT(  0 == twice_counted::copies );
+}
+#endif
+
+// nested structures to project:
+
+struct inner { int c; int twice() const { return 2 * c; } };
+struct outer { inner b; optional<inner> maybe_b; };
+
+outer make_outer( int c )
+{
+    outer result;
+    result.b.c = c;
+    result.maybe_b = result.b;
+    return result;
+}
+
+int  inner_c ( inner const & x ) { return x.c; }
+void inner_inc( inner & x ) { ++x.c; }
+
+inner make_inner() { inner result; result.c = 42; return result; }
+
+CASE( "optional get(&C::m): projects members as optional references, without a copy" "[functional]")
+{
+    optional<outer> o = make_outer( 7 );
+
+    EXPECT( 7 == *(o | get( &outer::b ) | get( &inner::c )) );
+    EXPECT( &o->b == &*(o | get( &outer::b )) );
+    EXPECT( &o->b.c == &*(o | get( &outer::b ) | get( &inner::c )) );
+    EXPECT_NOT( (optional<outer>() | get( &outer::b ) | get( &inner::c )).has_value() );
+}
+
+CASE( "optional get(&C::m): projections are as const as the input" "[functional]")
+{
+    optional<outer> o = make_outer( 7 );
+    optional<outer> const & co = o;
+
+    *(o | get( &outer::b ) | get( &inner::c )) = 9;
+
+    EXPECT( 9 == o->b.c );
+    EXPECT( 9 == *(co | get( &outer::b ) | get( &inner::c )) );
+}
+
+CASE( "optional get_opt(&C::m): projects optional members, empty if either is empty" "[functional]")
+{
+    optional<outer> o = make_outer( 7 );
+
+    EXPECT( &*o->maybe_b == &*(o | get_opt( &outer::maybe_b )) );
+    EXPECT( 7 == *(o | get_opt( &outer::maybe_b ) | get( &inner::c )) );
+
+    o->maybe_b = nullopt;
+
+    EXPECT_NOT( (o | get_opt( &outer::maybe_b )).has_value() );
+    EXPECT_NOT( (optional<outer>() | get_opt( &outer::maybe_b )).has_value() );
+}
+
+#if optfun_CPP11_OR_GREATER
+CASE( "optional get(&C::m), get_opt(&C::m): of a temporary yield an optional of the member" "[functional]")
+{
+    EXPECT( (std::is_same< optional<int>, decltype( optional<outer>( make_outer( 7 ) ) | get( &outer::b ) | get( &inner::c ) ) >::value) );
+    EXPECT( (std::is_same< optional<inner>, decltype( optional<outer>( make_outer( 7 ) ) | get_opt( &outer::maybe_b ) ) >::value) );
+
+    EXPECT( 7 == (optional<outer>( make_outer( 7 ) ) | get( &outer::b ) | get( &inner::c )).value() );
+    EXPECT( 8 == (optional<outer>( make_outer( 8 ) ) | get_opt( &outer::maybe_b )).value().c );
+}
+#endif
+
+CASE( "optional map(&C::m): projects a data member or calls a member function" "[functional]")
+{
+    optional<inner> const o = make_inner();
+
+    EXPECT( 42 == (o | map( &inner::c )).value() );
+    EXPECT( 84 == (o | map( &inner::twice )).value() );
+    EXPECT( 84 == (o | map_or( &inner::twice, 0 )) );
+}
+
+CASE( "optional optional_ref: adaptors take it in place of an optional" "[functional]")
+{
+    optional<outer> o = make_outer( 7 );
+
+    EXPECT( 7 == (o | get( &outer::b ) | map( inner_c )).value() );
+    EXPECT( 7 == (o | get( &outer::b ) | map_or( inner_c, 42 )) );
+    EXPECT( 7 == (o | get( &outer::b ) | get( &inner::c ) | or_( 42 )) );
+    EXPECT( 7 == (o | get( &outer::b ) | or_else( make_inner )).value().c );
+    EXPECT( 42 == (optional<outer>() | get( &outer::b ) | map_or( inner_c, 42 )) );
+
+    (void)( o | get( &outer::b ) | map( inner_inc ) );
+
+    EXPECT( 8 == o->b.c );
+}
+
+//
+// Stored pipelines:
+//
+
+#if optfun_CPP17_OR_GREATER
+
+auto const inc  = []( int arg ) { return arg + 1; };
+auto const half = []( int arg ) { return arg % 2 ? optional<int>() : optional<int>( arg / 2 ); };
+auto const zero = []() { return 0; };
+
+#if optfun_HAVE_NO_UNIQUE_ADDRESS && ! optfun_CONFIG_INSTRUMENT
+
+static_assert( std::is_empty_v< decltype( map( inc ) ) >, "stateless stage takes no room" );
+static_assert( std::is_empty_v< decltype( map( inc ).likely() ) >, "stateless hinted stage takes no room" );
+static_assert( std::is_empty_v< decltype( map_or_else( inc, zero ) ) >, "stateless stage takes no room" );
+static_assert( std::is_empty_v< decltype( map( inc ) | and_then( half ) | or_else( zero ) ) >, "pipeline of stateless stages takes no room" );
+
+static_assert( sizeof( map( double_int ) ) == sizeof( &double_int ), "stage takes the room of its callable" );
+static_assert( sizeof( map( double_int ) | map( inc ) | and_then( half ) ) == sizeof( &double_int ), "pipeline takes the room of its stateful stages" );
+
+#endif
+
+CASE( "optional composed: a | b of stages applies a, then b" "[functional]")
+{
+    auto const p = map( inc ) | and_then( half ) | or_else( zero );
+
+    EXPECT( 11 == (optional<int>(21) | p).value() );
+    EXPECT(  0 == (optional<int>(20) | p).value() );
+    EXPECT(  0 == (optional<int>(  ) | p).value() );
+}
+
+CASE( "optional composed: a pipeline ending in map_or yields a plain value" "[functional]")
+{
+    auto const p = map( inc ) | map_or( double_int, 42 );
+
+    EXPECT( 44 == (optional<int>(21) | p) );
+    EXPECT( 42 == (optional<int>(  ) | p) );
+}
+
+CASE( "optional pipeline: holds a chain chosen at runtime" "[functional]")
+{
+    pipeline<int, int> p;
+
+    EXPECT_NOT( bool( p ) );
+    EXPECT_NOT( (optional<int>(21) | p).has_value() );
+
+    for ( bool const halve : { false, true } )
+    {
+        p = halve ? pipeline<int, int>( map( inc ) | and_then( half ) ) : pipeline<int, int>( map( inc ) | filter( is_even ) );
+
+        EXPECT( bool( p ) );
+        EXPECT( p.is_inline() );
+        EXPECT( (halve ? 11 : 22) == (optional<int>(21) | p).value() );
+        EXPECT_NOT( (optional<int>(20) | p).has_value() );
+        EXPECT_NOT( (optional<int>(  ) | p).has_value() );
+    }
+}
+
+CASE( "optional pipeline: a chain larger than its capacity lives on the heap" "[functional]")
+{
+    pipeline<int, int, sizeof( void * )> const p = map( double_int ) | map( double_int ) | map( inc );
+
+    EXPECT_NOT( p.is_inline() );
+    EXPECT( 85 == (optional<int>(21) | p).value() );
+}
+
+CASE( "optional pipeline: copy and move, inline and on the heap" "[functional]")
+{
+    pipeline<int, int>                    a = map( double_int );
+    pipeline<int, int, sizeof( void * )> b = map( double_int ) | map( double_int );
+
+    pipeline<int, int>                    a2( a );
+    pipeline<int, int, sizeof( void * )> b2( b );
+
+    EXPECT( 42 == (optional<int>(21) | a2).value() );
+    EXPECT( 84 == (optional<int>(21) | b2).value() );
+
+    pipeline<int, int>                    a3( std::move( a ) );
+    pipeline<int, int, sizeof( void * )> b3( std::move( b ) );
+
+    EXPECT_NOT( bool( a ) );
+    EXPECT_NOT( bool( b ) );
+    EXPECT( 42 == (optional<int>(21) | a3).value() );
+    EXPECT( 84 == (optional<int>(21) | b3).value() );
+
+    a = a3;
+    b = std::move( b3 );
+
+    EXPECT( 42 == (optional<int>(21) | a).value() );
+    EXPECT( 84 == (optional<int>(21) | b).value() );
+}
+
+CASE( "optional pipeline: composes with stages on either side" "[functional]")
+{
+    pipeline<int, int> const p = map( inc );
+
+    EXPECT( 44 == (optional<int>(21) | ( p | map( double_int ) )).value() );
+    EXPECT( 43 == (optional<int>(21) | ( map( double_int ) | p )).value() );
+}
+
+CASE( "optional pipeline: apply(in, out) evaluates a batch, also in place" "[functional]")
+{
+    pipeline<int, int> const p = map( inc ) | and_then( half );
+
+    std::vector< optional<int> > v = { 21, 20, nullopt, 3 };
+    std::vector< optional<int> > out( v.size() );
+
+    p.apply( v, out );
+
+    EXPECT( ( out == std::vector< optional<int> >{ 11, nullopt, nullopt, 2 } ) );
+
+    p.apply( v, v );
+
+    EXPECT( ( v == out ) );
+}
+
+#endif // optfun_CPP17_OR_GREATER
+
+//
+// Null-skipping aggregates:
+//
+
+#if optfun_CPP17_OR_GREATER
+
+std::vector< optional<int> > some_ints()
+{
+    return { 3, nullopt, -2, nullopt, 7 };
+}
+
+CASE( "aggregate: count_present(), sum_present() skip empty optionals" "[aggregate]")
+{
+    std::vector< optional<int> > const v = some_ints();
+
+    EXPECT( 3u == (v | count_present()) );
+    EXPECT(  8 == (v | sum_present()) );
+    EXPECT(  8 == sum_present()( v ) );
+}
+
+CASE( "aggregate: min_present(), max_present(), mean_present() of present values" "[aggregate]")
+{
+    std::vector< optional<int> > const v = some_ints();
+
+    EXPECT( -2 == (v | min_present()).value() );
+    EXPECT(  7 == (v | max_present()).value() );
+    EXPECT( 8.0 / 3 == (v | mean_present()).value() );
+}
+
+CASE( "aggregate: min_present(), max_present(), mean_present() are empty without present values" "[aggregate]")
+{
+    std::vector< optional<int> > const none( 3 );
+
+    EXPECT( 0u == (none | count_present()) );
+    EXPECT(  0 == (none | sum_present()) );
+    EXPECT_NOT( (none | min_present() ).has_value() );
+    EXPECT_NOT( (none | max_present() ).has_value() );
+    EXPECT_NOT( (none | mean_present()).has_value() );
+}
+
+CASE( "aggregate: min_present(), max_present() of infinite values" "[aggregate]")
+{
+    double const inf = std::numeric_limits<double>::infinity();
+
+    std::vector< optional<double> > const pos{ inf, nullopt, inf };
+    std::vector< optional<double> > const neg{ -inf, nullopt };
+
+    EXPECT(  inf == (pos | min_present()).value() );
+    EXPECT(  inf == (pos | max_present()).value() );
+    EXPECT( -inf == (neg | min_present()).value() );
+    EXPECT( -inf == (neg | max_present()).value() );
+}
+
+CASE( "aggregate: min_present(), max_present() are NaN if a present value is NaN" "[aggregate]")
+{
+    double const nan = std::numeric_limits<double>::quiet_NaN();
+
+    std::vector< optional<double> > const v{ 1.0, nan, -1.0, nullopt };
+
+    EXPECT( std::isnan( (v | min_present()).value() ) );
+    EXPECT( std::isnan( (v | max_present()).value() ) );
+
+    std::vector<double>       const values{ 1.0, nan, -1.0 };
+    std::vector<std::uint8_t> const skip_nan{ 5 };
+
+    EXPECT( std::isnan( (nullable_view<double>( values.data(), nullptr, 3 ) | min_present()).value() ) );
+    EXPECT( -1.0 == (nullable_view<double>( values.data(), skip_nan.data(), 3 ) | min_present()).value() );
+}
+
+CASE( "aggregate: fold_present(op, init) folds present values from the left" "[aggregate]")
+{
+    std::vector< optional<int> > const v = some_ints();
+
+    EXPECT( -42 == (v | fold_present( []( int a, int x ) { return a * x; }, 1 )) );
+    EXPECT( "3,-2,7," == (v | fold_present( []( std::string a, int x ) { return a + std::to_string( x ) + ","; }, std::string() )) );
+}
+
+CASE( "aggregate: nullable_view - values with validity bitmap, in 64-bit words and tail" "[aggregate]")
+{
+    std::vector<int>          values( 150 );
+    std::vector<std::uint8_t> validity( ( values.size() + 7 ) / 8 );
+
+    int         sum   = 0;
+    std::size_t count = 0;
+
+    for ( std::size_t i = 0; i != values.size(); ++i )
+    {
+        values[i] = static_cast<int>( i );
+
+        // all present in the first word, none in the second, every third in the rest:
+        bool const present = i < 64 || ( i >= 128 && i % 3 == 0 );
+
+        if ( present )
+        {
+            validity[ i / 8 ] = static_cast<std::uint8_t>( validity[ i / 8 ] | ( 1u << ( i % 8 ) ) );
+            sum += values[i];
+            ++count;
+        }
+    }
+
+    nullable_view<int> const view( values.data(), validity.data(), values.size() );
+
+    EXPECT( count == (view | count_present()) );
+    EXPECT( sum   == (view | sum_present()) );
+    EXPECT(   0   == (view | min_present()).value() );
+    EXPECT( 147   == (view | max_present()).value() );
+    EXPECT( sum   == (view | fold_present( std::plus<>(), 0 )) );
+}
+
+CASE( "aggregate: nullable_view - null bitmap means all present" "[aggregate]")
+{
+    int const values[] = { 1, 2, 3, 4 };
+
+    nullable_view<int> const view( values, nullptr, 4 );
+
+    EXPECT(  4u == (view | count_present()) );
+    EXPECT( 10  == (view | sum_present()) );
+    EXPECT( 2.5 == (view | mean_present()).value() );
+    EXPECT(  3  == view[2].value() );
+}
+
+CASE( "aggregate: nullable_view - random-access iteration yields optionals" "[aggregate]")
+{
+    int          const values[]   = { 1, 2, 3, 4 };
+    std::uint8_t const validity[] = { 0x0b };
+
+    nullable_view<int> const view( values, validity, 4 );
+
+    std::vector< optional<int> > v( view.begin(), view.end() );
+
+    EXPECT( ( v == std::vector< optional<int> >{ 1, 2, nullopt, 4 } ) );
+    EXPECT( view.end() - view.begin() == 4 );
+    EXPECT( 4 == view.begin()[3].value() );
+    EXPECT_NOT( ( *( view.begin() + 2 ) ).has_value() );
+}
+
+//
+// Collect:
+//
+
+CASE( "collect: all present yields optional container of the values" "[collect]")
+{
+    std::vector< optional<int> > const v = { 1, 2, 3 };
+
+    EXPECT( ( (std::vector<int>{ 1, 2, 3 }) == (v | collect()).value() ) );
+    EXPECT( ( (std::vector<int>{ 1, 2, 3 }) == collect( v ).value() ) );
+}
+
+CASE( "collect: an empty optional yields nullopt" "[collect]")
+{
+    EXPECT_NOT( (some_ints() | collect()).has_value() );
+    EXPECT_NOT( (collect< small_vector<int, 4> >( some_ints() )).has_value() );
+}
+
+CASE( "collect: reserves once for a sized range" "[collect]")
+{
+    std::vector< optional<int> > const v( 100, optional<int>( 7 ) );
+
+    std::vector<int> const r = (v | collect()).value();
+
+    EXPECT( r.size()     == 100u );
+    EXPECT( r.capacity() == 100u );
+}
+
+CASE( "collect: moves values out of an rvalue range" "[collect]")
+{
+    std::vector< optional< std::unique_ptr<int> > > v;
+    v.emplace_back( std::make_unique<int>( 1 ) );
+    v.emplace_back( std::make_unique<int>( 2 ) );
+
+    optional< std::vector< std::unique_ptr<int> > > const r = std::move( v ) | collect();
+
+    EXPECT( 2u == r.value().size() );
+    EXPECT(  2 == *r.value()[1] );
+}
+
+CASE( "collect: copies values out of an rvalue view" "[collect]")
+{
+    struct view
+    {
+        optional<std::string> * first, * last;
+
+        optional<std::string> * begin() const { return first; }
+        optional<std::string> * end()   const { return last;  }
+    };
+
+    std::vector< optional<std::string> > v = { std::string( 40, 'a' ), std::string( 40, 'b' ) };
+
+    optional< std::vector<std::string> > const r = view{ v.data(), v.data() + v.size() } | collect();
+
+    EXPECT( 2u == r.value().size() );
+    EXPECT( std::string( 40, 'b' ) == r.value()[1] );
+    EXPECT( std::string( 40, 'b' ) == v[1].value() );
+}
+
+CASE( "collect: into small_vector, inline and on the heap" "[collect]")
+{
+    std::vector< optional<int> > const v3 = { 1, 2, 3 };
+    std::vector< optional<int> > const v5 = { 1, 2, 3, 4, 5 };
+
+    small_vector<int, 4> const r3 = (v3 | collect< small_vector<int, 4> >()).value();
+    small_vector<int, 4> const r5 = (v5 | collect< small_vector<int, 4> >()).value();
+
+    EXPECT(    r3.is_inline() );
+    EXPECT_NOT( r5.is_inline() );
+    EXPECT( ( (small_vector<int, 4>{ 1, 2, 3 }) == r3 ) );
+    EXPECT( ( (small_vector<int, 4>{ 1, 2, 3, 4, 5 }) == r5 ) );
+}
+
+CASE( "collect: from nullable_view" "[collect]")
+{
+    int          const values[]   = { 1, 2, 3 };
+    std::uint8_t const all[]      = { 0x07 };
+    std::uint8_t const some[]     = { 0x05 };
+
+    EXPECT( ( (std::vector<int>{ 1, 2, 3 }) == (nullable_view<int>( values, all, 3 ) | collect()).value() ) );
+    EXPECT_NOT( (nullable_view<int>( values, some, 3 ) | collect()).has_value() );
+}
+
+CASE( "small_vector: grows from inline storage to the heap" "[collect]")
+{
+    small_vector<std::string, 2> v;
+
+    v.push_back( "a" );
+    v.push_back( "b" );
+    EXPECT( v.is_inline() );
+
+    v.push_back( v[0] );
+    EXPECT_NOT( v.is_inline() );
+    EXPECT( v.size() == 3u );
+    EXPECT( v[2] == "a" );
+}
+
+CASE( "small_vector: copy and move, inline and on the heap" "[collect]")
+{
+    small_vector<std::string, 2> a = { "a" };
+    small_vector<std::string, 2> b = { "a", "b", "c" };
+
+    small_vector<std::string, 2> ac( a );
+    small_vector<std::string, 2> bc( b );
+
+    EXPECT( ( ac == a ) );
+    EXPECT( ( bc == b ) );
+
+    small_vector<std::string, 2> am( std::move( ac ) );
+    small_vector<std::string, 2> bm( std::move( bc ) );
+
+    EXPECT( ( am == a ) );
+    EXPECT( ( bm == b ) );
+    EXPECT( ac.empty() );
+    EXPECT( bc.empty() );
+
+    am = bm;
+    EXPECT( ( am == b ) );
+
+    bm = std::move( a );
+    EXPECT( ( bm == (small_vector<std::string, 2>{ "a" }) ) );
+    EXPECT( bm.is_inline() );
+}
+
+//
+// Stream compaction:
+//
+
+CASE( "compact_values: writes present values densely, and their indices" "[compact]")
+{
+    std::vector< optional<int> > const v = some_ints();
+
+    int           out[5] = {};
+    std::uint32_t idx[5] = {};
+
+    EXPECT( 3u == compact_values( v, out, idx ) );
+    EXPECT(  3 == out[0] );
+    EXPECT( -2 == out[1] );
+    EXPECT(  7 == out[2] );
+    EXPECT( 0u == idx[0] );
+    EXPECT( 2u == idx[1] );
+    EXPECT( 4u == idx[2] );
+}
+
+CASE( "compact_values: non-trivially copyable values" "[compact]")
+{
+    std::vector< optional<std::string> > const v = { std::string( "a" ), nullopt, std::string( "c" ) };
+
+    std::string out[3];
+
+    EXPECT( 2u == compact_values( v, out ) );
+    EXPECT( "a" == out[0] );
+    EXPECT( "c" == out[1] );
+}
+
+template< typename T >
+bool compacts_like_scalar( std::size_t n, unsigned seed )
+{
+    std::vector<T>            values( n );
+    std::vector<std::uint8_t> validity( ( n + 7 ) / 8 );
+
+    std::vector<T>             expect_values;
+    std::vector<std::uint32_t> expect_indices;
+
+    for ( std::size_t i = 0; i != n; ++i )
+    {
+        seed = seed * 1103515245u + 12345u;
+
+        values[i] = static_cast<T>( i * 3 );
+
+        if ( ( seed >> 16 ) % 3 != 0 )
+        {
+            validity[ i / 8 ] = static_cast<std::uint8_t>( validity[ i / 8 ] | ( 1u << ( i % 8 ) ) );
+            expect_values.push_back( values[i] );
+            expect_indices.push_back( static_cast<std::uint32_t>( i ) );
+        }
+    }
+
+    std::vector<T>             out( n );
+    std::vector<std::uint32_t> idx( n );
+
+    std::size_t const k = compact_values( nullable_view<T>( values.data(), validity.data(), n ), out.data(), idx.data() );
+
+    out.resize( k );
+    idx.resize( k );
+
+    return out == expect_values && idx == expect_indices;
+}
+
+CASE( "compact_values: nullable_view of 4-byte and 8-byte values, vector path and tail" "[compact]")
+{
+    EXPECT( compacts_like_scalar<std::int32_t>( 203, 1u ) );
+    EXPECT( compacts_like_scalar<float       >( 203, 2u ) );
+    EXPECT( compacts_like_scalar<std::int64_t>( 203, 3u ) );
+    EXPECT( compacts_like_scalar<double      >( 203, 4u ) );
+    EXPECT( compacts_like_scalar<std::int16_t>( 203, 5u ) );
+}
+
+CASE( "values(): stage yields present values" "[compact]")
+{
+    int const values_[] = { 1, 2, 3, 4 };
+
+    EXPECT( ( (some_ints() | values()) == std::vector<int>{ 3, -2, 7 } ) );
+    EXPECT( ( (some_ints() | values< small_vector<int, 4> >()) == small_vector<int, 4>{ 3, -2, 7 } ) );
+    EXPECT( ( (nullable_view<int>( values_, nullptr, 4 ) | values()) == std::vector<int>{ 1, 2, 3, 4 } ) );
+}
+
+//
+// Coalesce:
+//
+
+CASE( "coalesce(a, b, ...): first present optional" "[coalesce]")
+{
+    optional<int> const none;
+
+    EXPECT( 1 == coalesce( optional<int>( 1 ), optional<int>( 2 ) ).value() );
+    EXPECT( 2 == coalesce( none, optional<int>( 2 ), optional<int>( 3 ) ).value() );
+    EXPECT_NOT( coalesce( none, none, none ).has_value() );
+}
+
+CASE( "coalesce(a, b, ..., value): plain value if the last alternative is a value" "[coalesce]")
+{
+    optional<int> const none;
+
+    int const r = coalesce( none, none, 42 );
+
+    EXPECT( 42 == r );
+    EXPECT(  7 == coalesce( optional<int>( 7 ), 42 ) );
+}
+
+CASE( "coalesce(a, lazy(f), ...): thunks are called only if reached" "[coalesce]")
+{
+    int calls = 0;
+
+    auto const thunk = lazy( [&]() { ++calls; return optional<int>( 5 ); } );
+
+    EXPECT( 1 == coalesce( optional<int>( 1 ), thunk, 9 ) );
+    EXPECT( 0 == calls );
+
+    EXPECT( 5 == coalesce( optional<int>(), thunk, 9 ) );
+    EXPECT( 1 == calls );
+
+    EXPECT( 9 == coalesce( optional<int>(), lazy( [](){ return optional<int>(); } ), lazy( [](){ return 9; } ) ) );
+}
+
+CASE( "coalesce_columns(out, validity, a, b, ...): per element first present of columns" "[coalesce]")
+{
+    std::size_t const n = 70;
+
+    std::vector<int> a( n ), b( n ), c( n ), out( n );
+    std::vector<std::uint8_t> va( 9 ), vb( 9 ), vout( 9 );
+
+    for ( std::size_t i = 0; i != n; ++i )
+    {
+        a[i] = 100 + static_cast<int>( i );
+        b[i] = 200 + static_cast<int>( i );
+        c[i] = 300 + static_cast<int>( i );
+
+        if ( i % 2 == 0 ) va[ i / 8 ] = static_cast<std::uint8_t>( va[ i / 8 ] | ( 1u << ( i % 8 ) ) );
+        if ( i % 3 == 0 ) vb[ i / 8 ] = static_cast<std::uint8_t>( vb[ i / 8 ] | ( 1u << ( i % 8 ) ) );
+    }
+
+    nullable_view<int> const ab = coalesce_columns( out.data(), vout.data()
+        , nullable_view<int>( a.data(), va.data(), n ), nullable_view<int>( b.data(), vb.data(), n ) );
+
+    EXPECT( 100 == ab[0].value() );
+    EXPECT( 203 == ab[3].value() );
+    EXPECT_NOT( ab[1].has_value() );
+    EXPECT( 168 == ab[68].value() );
+    EXPECT( 269 == ab[69].value() );
+    EXPECT( 0 == ( vout[8] >> 6 ) );
+
+    nullable_view<int> const abc = coalesce_columns( out.data(), vout.data()
+        , nullable_view<int>( a.data(), va.data(), n ), nullable_view<int>( b.data(), vb.data(), n ), nullable_view<int>( c.data(), nullptr, n ) );
+
+    EXPECT( n   == (abc | count_present()) );
+    EXPECT( 301 == abc[1].value() );
+    EXPECT( 203 == abc[3].value() );
+}
+
+//
+// Gap filling:
+//
+
+std::vector< optional<int> > gappy()
+{
+    return { nullopt, 1, nullopt, nullopt, nullopt, 5, nullopt, 7, nullopt };
+}
+
+std::string str( std::vector< optional<int> > const & v )
+{
+    std::string result;
+    for ( auto const & o : v )
+        result += o ? std::to_string( *o ) : std::string( "-" );
+    return result;
+}
+
+CASE( "fill_forward(): carries the last value forward into gaps of at most max_gap elements" "[fill]")
+{
+    EXPECT( "-11115577" == str( gappy() | fill_forward() ) );
+    EXPECT( "-11115577" == str( gappy() | fill_forward( 3 ) ) );
+    EXPECT( "-1---5577" == str( gappy() | fill_forward( 1 ) ) );
+    EXPECT( "-1---5-7-" == str( gappy() | fill_forward( 0 ) ) );
+}
+
+CASE( "fill_backward(): carries the next value backward into gaps of at most max_gap elements" "[fill]")
+{
+    EXPECT( "11555577-" == str( gappy() | fill_backward() ) );
+    EXPECT( "11555577-" == str( gappy() | fill_backward( 3 ) ) );
+    EXPECT( "11---577-" == str( gappy() | fill_backward( 1 ) ) );
+}
+
+CASE( "fill_with(f): fills gaps of at most max_gap elements with f(before, after, offset, length)" "[fill]")
+{
+    auto const lerp = []( optional<int> const & a, optional<int> const & b, std::size_t k, std::size_t n ) -> optional<int>
+    {
+        if ( ! a || ! b )
+            return nullopt;
+        return *a + ( *b - *a ) * static_cast<int>( k + 1 ) / static_cast<int>( n + 1 );
+    };
+
+    EXPECT( "-1234567-" == str( gappy() | fill_with( lerp ) ) );
+    EXPECT( "-1---567-" == str( gappy() | fill_with( lerp, 2 ) ) );
+}
+
+std::vector< optional<int> > to_optionals( nullable_view<int> const & view )
+{
+    std::vector< optional<int> > result;
+    for ( std::size_t i = 0; i != view.size(); ++i )
+        result.push_back( view[i] );
+    return result;
+}
+
+CASE( "fill_column(out, validity, view, stage): fills values with validity bitmap" "[fill]")
+{
+    std::size_t const n = 200;
+
+    std::vector<int>          x( n ), out( n );
+    std::vector<std::uint8_t> bits( ( n + 7 ) / 8 ), obits( ( n + 7 ) / 8 );
+    std::vector< optional<int> > v( n );
+
+    for ( std::size_t i = 0; i != n; ++i )
+    {
+        x[i] = static_cast<int>( i );
+
+        // present runs and gaps of varying length, crossing words:
+        if ( ( i / 7 ) % 3 == 0 || i % 61 == 0 )
+        {
+            bits[ i / 8 ] = static_cast<std::uint8_t>( bits[ i / 8 ] | ( 1u << ( i % 8 ) ) );
+            v[i] = x[i];
+        }
+    }
+
+    nullable_view<int> const view( x.data(), bits.data(), n );
+
+    for ( std::size_t max_gap : { std::size_t( 0 ), std::size_t( 3 ), std::size_t( 13 ), std::size_t( 100 ) } )
+    {
+        std::vector< optional<int> > const fwd = v | fill_forward( max_gap );
+        std::vector< optional<int> > const bwd = v | fill_backward( max_gap );
+
+        EXPECT( ( fwd == to_optionals( fill_column( out.data(), obits.data(), view, fill_forward( max_gap ) ) ) ) );
+        EXPECT( ( bwd == (view | fill_backward( max_gap )) ) );
+        EXPECT( ( bwd == to_optionals( fill_column( out.data(), obits.data(), view, fill_backward( max_gap ) ) ) ) );
+    }
+}
+
+CASE( "forward_filler, backward_filler: fill a stream like the stages" "[fill]")
+{
+    for ( std::size_t max_gap : { std::size_t( 0 ), std::size_t( 1 ), std::size_t( 2 ), std::size_t( 3 ), (std::numeric_limits<std::size_t>::max)() } )
+    {
+        std::vector< optional<int> > fwd, bwd;
+
+        forward_filler<int>  ff( max_gap );
+        backward_filler<int> bf( max_gap );
+
+        for ( auto const & o : gappy() )
+        {
+            ff.push( o, [&]( optional<int> const & r ) { fwd.push_back( r ); } );
+            bf.push( o, [&]( optional<int> const & r ) { bwd.push_back( r ); } );
+        }
+        ff.flush( [&]( optional<int> const & r ) { fwd.push_back( r ); } );
+        bf.flush( [&]( optional<int> const & r ) { bwd.push_back( r ); } );
+
+        EXPECT( str( gappy() | fill_forward ( max_gap ) ) == str( fwd ) );
+        EXPECT( str( gappy() | fill_backward( max_gap ) ) == str( bwd ) );
+    }
+}
+
+#if optfun_HAVE_MEMORY_RESOURCE
+
+//
+// Memory resource of a chain:
+//
+
+class counting_resource : public std::pmr::memory_resource
+{
+public:
+    int allocations = 0;
+
+private:
+    void * do_allocate( std::size_t bytes, std::size_t align ) override
+    {
+        ++allocations;
+        return std::pmr::new_delete_resource()->allocate( bytes, align );
+    }
+
+    void do_deallocate( void * p, std::size_t bytes, std::size_t align ) override
+    {
+        std::pmr::new_delete_resource()->deallocate( p, bytes, align );
+    }
+
+    bool do_is_equal( std::pmr::memory_resource const & other ) const noexcept override
+    {
+        return this == &other;
+    }
+};
+
+// fail any allocation from the default resource while in scope:
+
+struct no_default_resource
+{
+    std::pmr::memory_resource * previous = std::pmr::set_default_resource( std::pmr::null_memory_resource() );
+
+    ~no_default_resource() { std::pmr::set_default_resource( previous ); }
+};
+
+std::pmr::string long_text( int x )
+{
+    return std::pmr::string( "a text beyond the small string buffer: " ) + char( '0' + x );
+}
+
+std::pmr::string long_text_current( int x )
+{
+    std::pmr::string result( "a text beyond the small string buffer: ?", current_resource() );
+    result.back() = char( '0' + x );
+    return result;
+}
+
+std::pmr::string long_text_in( int x, resource_allocator alloc )
+{
+    std::pmr::string result( "a text beyond the small string buffer: ", alloc );
+    result += char( '0' + x );
+    return result;
+}
+
+CASE( "with_resource(r): moves the payload of map(f) into r" "[resource]")
+{
+    counting_resource r;
+    no_default_resource guard;
+
+    optional<std::pmr::string> s = optional<int>( 7 ) | with_resource( &r ) | map( long_text_current );
+
+    EXPECT( s.has_value() );
+    EXPECT( s->back() == '7' );
+    EXPECT( s->get_allocator().resource() == &r );
+    EXPECT( r.allocations == 1 );
+}
+
+CASE( "with_resource(r): copies a payload of map(f) from elsewhere into r" "[resource]")
+{
+    counting_resource r;
+
+    optional<std::pmr::string> s = optional<int>( 7 ) | with_resource( &r ) | map( long_text );
+
+    EXPECT( s.has_value() );
+    EXPECT( s->back() == '7' );
+    EXPECT( s->get_allocator().resource() == &r );
+    EXPECT( r.allocations == 1 );
+}
+
+CASE( "with_resource(r): f(x, resource_allocator) builds its payload in r" "[resource]")
+{
+    counting_resource r;
+    no_default_resource guard;
+
+    optional<std::pmr::string> s = optional<int>( 3 ) | with_resource( &r )
+        | map( long_text_in )
+        | and_then( []( std::pmr::string const & t, resource_allocator alloc ) { return optional<std::pmr::string>( std::pmr::string( t, alloc ) + "!" ); } );
+
+    EXPECT( s.has_value() );
+    EXPECT( s->back() == '!' );
+    EXPECT( s->get_allocator().resource() == &r );
+    EXPECT( r.allocations > 0 );
+}
+
+CASE( "with_resource(r): an empty optional short-circuits without allocating" "[resource]")
+{
+    counting_resource r;
+
+    optional<std::pmr::string> s = optional<int>() | with_resource( &r ) | map( long_text_in );
+
+    EXPECT_NOT( s.has_value() );
+    EXPECT( r.allocations == 0 );
+}
+
+CASE( "with_resource(r): a non-optional result ends the chain, in r" "[resource]")
+{
+    counting_resource r;
+    std::pmr::string const none( "none" );
+
+    std::pmr::string s = optional<int>( 5 ) | with_resource( &r ) | map_or( long_text, none );
+
+    EXPECT( s.back() == '5' );
+    EXPECT( s.get_allocator().resource() == &r );
+}
+
+CASE( "with_resource(r): f(x, resource_allocator) gets an allocator only in a chain" "[resource]")
+{
+    counting_resource r;
+
+    std::pmr::memory_resource * seen = nullptr;
+    auto const spy = [&]( int x, resource_allocator alloc ) { seen = alloc.resource(); return x; };
+
+    (void)( optional<int>( 1 ) | with_resource( &r ) | map( spy ) );
+
+    EXPECT( seen == &r );
+    EXPECT( current_resource() == std::pmr::get_default_resource() );
+
+    auto const arity = []( auto const &... xs ) { return sizeof...( xs ); };
+
+    EXPECT( 1u == (optional<int>( 1 ) | map( arity )).value() );
+    EXPECT( 2u == (optional<int>( 1 ) | with_resource( &r ) | map( arity )).get().value() );
+}
+
+#endif // optfun_HAVE_MEMORY_RESOURCE
+
+#endif // optfun_CPP17_OR_GREATER
+
+//
+// Instrumentation:
+//
+
+#if optfun_CPP17_OR_GREATER && optfun_CONFIG_INSTRUMENT
+
+instrument::stage_stats stats_of( char const * name )
+{
+    std::vector<instrument::stage_stats> const all = instrument::snapshot();
+
+    for ( std::size_t i = 0; i != all.size(); ++i )
+    {
+        if ( all[i].name == name )
+            return all[i];
+    }
+    return instrument::stage_stats();
+}
+
+CASE( "instrument: counts applications, short-circuits and empty results per stage" "[instrument]")
+{
+    instrument::reset();
+
+    for ( int i = 0; i < 10; ++i )
+    {
+        optional<int> o = i % 2 ? optional<int>( i ) : optional<int>();
+
+        (void)( o
+            | map( double_int ).named( "t-double" )
+            | and_then( [](int x) { return x > 10 ? optional<int>( x ) : optional<int>(); } ).named( "t-filter" ) );
+    }
+
+    instrument::stage_stats const dbl = stats_of( "t-double" );
+    instrument::stage_stats const flt = stats_of( "t-filter" );
+
+    EXPECT( dbl.calls   == 10u );
+    EXPECT( dbl.skipped ==  5u );
+    EXPECT( dbl.ran()   ==  5u );
+    EXPECT( dbl.empty   ==  5u );
+
+    EXPECT( flt.calls   == 10u );
+    EXPECT( flt.skipped ==  5u );
+    EXPECT( flt.empty   ==  8u );
+}
+
+CASE( "instrument: or_else short-circuits on a present input, map_or_else never" "[instrument]")
+{
+    instrument::reset();
+
+    for ( int i = 0; i < 10; ++i )
+    {
+        optional<int> o = i % 5 ? optional<int>( i ) : optional<int>();
+
+        (void)( o
+            | or_else( [] { return optional<int>( 0 ); } ).named( "t-or-else" )
+            | or_( 1 ).named( "t-or" ) );
+
+        (void)( o | map_or_else( double_int, [] { return 0; } ).named( "t-map-or-else" ) );
+    }
+
+    instrument::stage_stats const oe = stats_of( "t-or-else" );
+
+    EXPECT( oe.calls   == 10u );
+    EXPECT( oe.skipped ==  8u );
+    EXPECT( oe.ran()   ==  2u );
+    EXPECT( oe.empty   ==  0u );
+
+    EXPECT( stats_of( "t-or" ).skipped == 10u );
+    EXPECT( stats_of( "t-map-or-else" ).calls   == 10u );
+    EXPECT( stats_of( "t-map-or-else" ).skipped ==  0u );
+}
+
+CASE( "instrument: unnamed stages are counted under their kind" "[instrument]")
+{
+    instrument::reset();
+
+    (void)( optional<int>(7) | map_or( double_int, 42 ) );
+
+    EXPECT( stats_of( "map_or" ).calls == 1u );
+    EXPECT( stats_of( "map_or" ).empty == 0u );
+}
+
+CASE( "instrument: presence hint keeps the stage name" "[instrument]")
+{
+    instrument::reset();
+
+    (void)( optional<int>(7) | map( double_int ).named( "t-hinted" ).likely() );
+    (void)( optional<int>(7) | then( double_opt ).named( "t-then" ).unlikely() );
+
+    EXPECT( stats_of( "t-hinted" ).calls == 1u );
+    EXPECT( stats_of( "t-then"   ).calls == 1u );
+}
+
+CASE( "instrument: a stage name need not outlive the stage" "[instrument]")
+{
+    instrument::reset();
+
+    for ( int i = 0; i < 2; ++i )
+    {
+        std::string name = "t-built-" + std::to_string( i );
+        auto const stage = map( double_int ).named( name.c_str() );
+        name.assign( name.size(), 'x' );
+
+        (void)( optional<int>(7) | stage );
+    }
+
+    EXPECT( stats_of( "t-built-0" ).calls == 1u );
+    EXPECT( stats_of( "t-built-1" ).calls == 1u );
+}
+
+CASE( "instrument: dump writes a row per stage" "[instrument]")
+{
+    instrument::reset();
+
+    (void)( optional<int>(7) | map( double_int ).named( "t-dump" ) );
+
+    std::ostringstream os;
+    instrument::dump( os );
+
+    EXPECT( os.str().find( "t-dump\t1\t1\t0\t0\t" ) != std::string::npos );
+}
+
+#endif // optfun_CONFIG_INSTRUMENT
+
 //
 // Negative tests:
 //